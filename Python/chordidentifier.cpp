@@ -0,0 +1,403 @@
+// Python bindings to the chord engine, see README.md
+//
+// Event arrays are read in place through the buffer protocol (NumPy arrays, array.array,
+// memoryviews, including strided views such as the columns of a structured array), the
+// analysis runs with the GIL released, and the results are returned as arrays that expose
+// their memory the same way, so numpy.asarray() on them doesn't copy either.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "ChordAnalysis.h"
+
+namespace
+{
+    //==============================================================================
+    // read only, one dimensional array owning memory from std::malloc
+    struct ResultArray
+    {
+        PyObject_HEAD
+        void* data;
+        Py_ssize_t length;
+        Py_ssize_t itemSize;
+        const char* format;
+    };
+
+    void deallocResultArray (PyObject* self)
+    {
+        std::free (reinterpret_cast<ResultArray*>(self)->data);
+        Py_TYPE (self)->tp_free (self);
+    }
+
+    int getResultBuffer (PyObject* self, Py_buffer* view, int flags)
+    {
+        auto array = reinterpret_cast<ResultArray*>(self);
+        if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE)
+        {
+            PyErr_SetString (PyExc_BufferError, "result arrays are read only");
+            view->obj = nullptr;
+            return -1;
+        }
+        Py_INCREF (self);
+        view->obj = self;
+        view->buf = array->data;
+        view->len = array->length * array->itemSize;
+        view->readonly = 1;
+        view->itemsize = array->itemSize;
+        view->format = (flags & PyBUF_FORMAT) == PyBUF_FORMAT ? const_cast<char*>(array->format) : nullptr;
+        view->ndim = 1;
+        view->shape = (flags & PyBUF_ND) == PyBUF_ND ? &array->length : nullptr;
+        view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &array->itemSize : nullptr;
+        view->suboffsets = nullptr;
+        view->internal = nullptr;
+        return 0;
+    }
+
+    Py_ssize_t getResultLength (PyObject* self)
+    {
+        return reinterpret_cast<ResultArray*>(self)->length;
+    }
+
+    PyObject* getResultItem (PyObject* self, Py_ssize_t index)
+    {
+        auto array = reinterpret_cast<ResultArray*>(self);
+        if (index < 0 || index >= array->length)
+        {
+            PyErr_SetString (PyExc_IndexError, "index out of range");
+            return nullptr;
+        }
+        switch (array->format[0])
+        {
+            case 'd': return PyFloat_FromDouble (static_cast<double*>(array->data)[index]);
+            case 'H': return PyLong_FromLong (static_cast<uint16_t*>(array->data)[index]);
+            default:  return PyLong_FromLong (static_cast<int8_t*>(array->data)[index]);
+        }
+    }
+
+    PyBufferProcs resultBufferProcs = { getResultBuffer, nullptr };
+
+    PySequenceMethods resultSequenceMethods = { getResultLength, nullptr, nullptr, getResultItem };
+
+    PyTypeObject resultArrayType = { PyVarObject_HEAD_INIT (nullptr, 0) };
+
+    // takes ownership of data
+    PyObject* createResultArray (void* data, Py_ssize_t length, Py_ssize_t itemSize, const char* format)
+    {
+        auto array = PyObject_New (ResultArray, &resultArrayType);
+        if (array == nullptr)
+        {
+            std::free (data);
+            return nullptr;
+        }
+        array->data = data;
+        array->length = length;
+        array->itemSize = itemSize;
+        array->format = format;
+        return reinterpret_cast<PyObject*>(array);
+    }
+
+    //==============================================================================
+    // a one dimensional buffer of numbers, read element by element in whatever format it has
+    struct Column
+    {
+        Py_buffer view {};
+        bool acquired = false;
+
+        ~Column()
+        {
+            if (acquired)
+            {
+                PyBuffer_Release (&view);
+            }
+        }
+
+        // formats lists the struct codes accepted, name is used in errors
+        bool acquire (PyObject* object, const char* formats, const char* name)
+        {
+            if (PyObject_GetBuffer (object, &view, PyBUF_RECORDS_RO) < 0)
+            {
+                return false;
+            }
+            acquired = true;
+
+            // a leading byte order or alignment character is only valid if it means native
+            const char* format = view.format != nullptr ? view.format : "B";
+            if (format[0] == '@' || format[0] == '=' || format[0] == '<')
+            {
+                ++format;
+            }
+            code = format[0];
+            if (view.ndim != 1 || code == 0 || format[1] != 0 || std::strchr (formats, code) == nullptr)
+            {
+                PyErr_Format (PyExc_TypeError, "%s must be a one dimensional array of one of the types '%s'", name, formats);
+                return false;
+            }
+            length = view.shape[0];
+            stride = view.strides != nullptr ? view.strides[0] : view.itemsize;
+            return true;
+        }
+
+        long long getInteger (Py_ssize_t index) const
+        {
+            auto p = static_cast<const char*>(view.buf) + index * stride;
+            switch (code)
+            {
+                case '?': return *reinterpret_cast<const bool*>(p) ? 1 : 0;
+                case 'b': return *reinterpret_cast<const signed char*>(p);
+                case 'B': return *reinterpret_cast<const unsigned char*>(p);
+                case 'h': return *reinterpret_cast<const short*>(p);
+                case 'H': return *reinterpret_cast<const unsigned short*>(p);
+                case 'i': return *reinterpret_cast<const int*>(p);
+                case 'I': return *reinterpret_cast<const unsigned int*>(p);
+                case 'l': return *reinterpret_cast<const long*>(p);
+                case 'L': return static_cast<long long>(*reinterpret_cast<const unsigned long*>(p));
+                case 'q': return *reinterpret_cast<const long long*>(p);
+                case 'Q': return static_cast<long long>(*reinterpret_cast<const unsigned long long*>(p));
+                default:  return 0;
+            }
+        }
+
+        double getReal (Py_ssize_t index) const
+        {
+            auto p = static_cast<const char*>(view.buf) + index * stride;
+            return code == 'f' ? *reinterpret_cast<const float*>(p) : *reinterpret_cast<const double*>(p);
+        }
+
+        char code = 0;
+        Py_ssize_t length = 0;
+        Py_ssize_t stride = 0;
+    };
+
+    const char* const integerFormats = "?bBhHiIlLqQ";
+    const char* const realFormats = "fd";
+
+    //==============================================================================
+    struct Results
+    {
+        double* times;
+        uint16_t* chords;
+        int8_t* numerals;
+        Py_ssize_t length;
+        bool invalidNote;
+    };
+
+    // same as the app: events within window of the first one are a group, identified once,
+    // and a row is written whenever a group changes the notes that are sounding
+    void analyse (const Column& notes, const Column& on, const Column& times, int key, double window, Results& results)
+    {
+        int counts[128] = {};
+        uint64_t sounding[2] = {0, 0};
+        uint64_t identified[2] = {0, 0};
+        std::vector<int> chord;
+        chord.reserve (128);
+
+        const Py_ssize_t numEvents = notes.length;
+        for (Py_ssize_t i = 0; i < numEvents;)
+        {
+            const double start = times.getReal (i);
+            for (; i < numEvents && times.getReal (i) <= start + window; ++i)
+            {
+                const long long note = notes.getInteger (i);
+                if (note < 0 || note > 127)
+                {
+                    results.invalidNote = true;
+                    continue;
+                }
+                int& count = counts[note];
+                count = on.getInteger (i) != 0 ? count + 1 : (count > 0 ? count - 1 : 0);
+                const uint64_t bit = uint64_t (1) << (note % 64);
+                sounding[note / 64] = count > 0 ? (sounding[note / 64] | bit) : (sounding[note / 64] & ~bit);
+            }
+
+            if (sounding[0] == identified[0] && sounding[1] == identified[1])
+            {
+                continue;
+            }
+            identified[0] = sounding[0];
+            identified[1] = sounding[1];
+
+            chord.clear();
+            for (int note = 0; note < 128; ++note)
+            {
+                if ((sounding[note / 64] >> (note % 64)) & 1)
+                {
+                    chord.push_back (note);
+                }
+            }
+            auto result = ChordAnalysis::identify (chord, key);
+            results.times[results.length] = start;
+            results.chords[results.length] = ChordAnalysis::pack (result);
+            results.numerals[results.length] = static_cast<int8_t>(result.getNumeralId());
+            ++results.length;
+        }
+    }
+
+    bool parseKey (int key)
+    {
+        if (key < 1 || key > ChordAnalysis::numKeys)
+        {
+            PyErr_Format (PyExc_ValueError, "key must be 1-%d", ChordAnalysis::numKeys);
+            return false;
+        }
+        return true;
+    }
+
+    //==============================================================================
+    PyObject* analyseEvents (PyObject*, PyObject* args, PyObject* kwargs)
+    {
+        static const char* keywords[] = {"notes", "on", "times", "key", "window", nullptr};
+        PyObject* notesObject = nullptr;
+        PyObject* onObject = nullptr;
+        PyObject* timesObject = nullptr;
+        int key = 0;
+        double window = 0.0;
+        if (! PyArg_ParseTupleAndKeywords (args, kwargs, "OOOi|d", const_cast<char**>(keywords),
+                                           &notesObject, &onObject, &timesObject, &key, &window)
+            || ! parseKey (key))
+        {
+            return nullptr;
+        }
+
+        Column notes, on, times;
+        if (! notes.acquire (notesObject, integerFormats, "notes")
+            || ! on.acquire (onObject, integerFormats, "on")
+            || ! times.acquire (timesObject, realFormats, "times"))
+        {
+            return nullptr;
+        }
+        if (notes.length != on.length || notes.length != times.length)
+        {
+            PyErr_SetString (PyExc_ValueError, "notes, on and times must have the same length");
+            return nullptr;
+        }
+
+        // there can't be more rows than events, the unused end is given back afterwards
+        const size_t capacity = static_cast<size_t>(notes.length > 0 ? notes.length : 1);
+        Results results { static_cast<double*>(std::malloc (capacity * sizeof (double))),
+                          static_cast<uint16_t*>(std::malloc (capacity * sizeof (uint16_t))),
+                          static_cast<int8_t*>(std::malloc (capacity * sizeof (int8_t))),
+                          0, false };
+        if (results.times == nullptr || results.chords == nullptr || results.numerals == nullptr)
+        {
+            std::free (results.times);
+            std::free (results.chords);
+            std::free (results.numerals);
+            return PyErr_NoMemory();
+        }
+
+        Py_BEGIN_ALLOW_THREADS
+        analyse (notes, on, times, key, window > 0.0 ? window : 0.0, results);
+        Py_END_ALLOW_THREADS
+
+        if (results.invalidNote)
+        {
+            std::free (results.times);
+            std::free (results.chords);
+            std::free (results.numerals);
+            PyErr_SetString (PyExc_ValueError, "notes must be 0-127");
+            return nullptr;
+        }
+
+        const size_t length = static_cast<size_t>(results.length > 0 ? results.length : 1);
+        auto shrink = [length] (void* data, size_t itemSize)
+        {
+            auto shrunk = std::realloc (data, length * itemSize);
+            return shrunk != nullptr ? shrunk : data;
+        };
+        auto timesArray = createResultArray (shrink (results.times, sizeof (double)), results.length, sizeof (double), "d");
+        auto chordsArray = createResultArray (shrink (results.chords, sizeof (uint16_t)), results.length, sizeof (uint16_t), "H");
+        auto numeralsArray = createResultArray (shrink (results.numerals, sizeof (int8_t)), results.length, sizeof (int8_t), "b");
+        if (timesArray == nullptr || chordsArray == nullptr || numeralsArray == nullptr)
+        {
+            Py_XDECREF (timesArray);
+            Py_XDECREF (chordsArray);
+            Py_XDECREF (numeralsArray);
+            return nullptr;
+        }
+        return Py_BuildValue ("(NNN)", timesArray, chordsArray, numeralsArray);
+    }
+
+    PyObject* getChordText (PyObject*, PyObject* args)
+    {
+        unsigned int chord = 0;
+        int key = 0;
+        if (! PyArg_ParseTuple (args, "Ii", &chord, &key) || ! parseKey (key))
+        {
+            return nullptr;
+        }
+
+        // figures are written on one line, e.g. "V65"
+        auto result = ChordAnalysis::unpack (static_cast<uint16_t>(chord));
+        std::string text = ChordAnalysis::getNumeralText (result, key);
+        for (auto c = result.figures; result.valid && *c != 0; ++c)
+        {
+            if (*c != '\n')
+            {
+                text += *c;
+            }
+        }
+        return PyUnicode_FromString (text.c_str());
+    }
+
+    PyObject* getNumeralText (PyObject*, PyObject* args)
+    {
+        int numeral = 0;
+        int key = 0;
+        if (! PyArg_ParseTuple (args, "ii", &numeral, &key) || ! parseKey (key))
+        {
+            return nullptr;
+        }
+        if (numeral < 0 || numeral >= ChordAnalysis::numNumerals)
+        {
+            return PyUnicode_FromString ("");
+        }
+        auto spelling = ChordAnalysis::spell (numeral / 2, numeral % 2, key);
+        return PyUnicode_FromString ((std::string (spelling.accidental) + spelling.numeral).c_str());
+    }
+
+    PyObject* getKeyName (PyObject*, PyObject* args)
+    {
+        int key = 0;
+        if (! PyArg_ParseTuple (args, "i", &key) || ! parseKey (key))
+        {
+            return nullptr;
+        }
+        return PyUnicode_FromString (ChordAnalysis::getKeyName (key));
+    }
+
+    PyMethodDef methods[] =
+    {
+        {"analyze", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(analyseEvents)), METH_VARARGS | METH_KEYWORDS,
+         "analyze(notes, on, times, key, window=0.0) -> (times, chords, numerals)\n\n"
+         "Identifies the chords formed by note events in key (1-30). notes, on and times are\n"
+         "one dimensional arrays of the same length, read without copying. Events within window\n"
+         "seconds of the first one of a group are identified together. One row is returned for\n"
+         "every group that changed the sounding notes: its time (float64), the packed chord\n"
+         "(uint16, 0 if not identified) and the numeral id (int8, -1 if not identified)."},
+        {"chord_text", getChordText, METH_VARARGS, "chord_text(chord, key) -> roman numeral with quality and figures, e.g. 'V65'"},
+        {"numeral_text", getNumeralText, METH_VARARGS, "numeral_text(numeral, key) -> roman numeral, e.g. 'bVII'"},
+        {"key_name", getKeyName, METH_VARARGS, "key_name(key) -> name of key 1-30, e.g. 'a minor'"},
+        {nullptr, nullptr, 0, nullptr}
+    };
+
+    PyModuleDef moduleDefinition = { PyModuleDef_HEAD_INIT, "chordidentifier", "Chord Identifier engine", -1, methods };
+}
+
+PyMODINIT_FUNC PyInit_chordidentifier()
+{
+    resultArrayType.tp_name = "chordidentifier.ResultArray";
+    resultArrayType.tp_basicsize = sizeof (ResultArray);
+    resultArrayType.tp_dealloc = deallocResultArray;
+    resultArrayType.tp_as_buffer = &resultBufferProcs;
+    resultArrayType.tp_as_sequence = &resultSequenceMethods;
+    resultArrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+    resultArrayType.tp_doc = "read only array of results, use numpy.asarray() or memoryview() to read it";
+    if (PyType_Ready (&resultArrayType) < 0)
+    {
+        return nullptr;
+    }
+    return PyModule_Create (&moduleDefinition);
+}
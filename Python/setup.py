@@ -0,0 +1,26 @@
+# builds the chordidentifier extension module from the engine sources, see README.md
+#
+#   pip install ./Python
+#   python Python/setup.py build_ext --inplace
+
+import os
+import sys
+from setuptools import setup, Extension
+
+here = os.path.dirname(os.path.abspath(__file__))
+source = os.path.join(here, "..", "Source")
+
+setup(
+    name="chordidentifier",
+    version="1.0",
+    description="Chord Identifier engine",
+    ext_modules=[
+        Extension(
+            "chordidentifier",
+            sources=[os.path.join(here, "chordidentifier.cpp"), os.path.join(source, "ChordAnalysis.cpp")],
+            include_dirs=[source],
+            language="c++",
+            extra_compile_args=["/std:c++17"] if sys.platform == "win32" else ["-std=c++17", "-O2"],
+        )
+    ],
+)
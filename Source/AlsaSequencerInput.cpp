@@ -0,0 +1,346 @@
+#include "AlsaSequencerInput.h"
+
+#if JUCE_LINUX
+
+#include <alsa/asoundlib.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // largest message passed on, longer sysex is dropped
+    const int maxMessageSize = 256;
+
+    // how long the thread blocks before checking if it should stop, in milliseconds
+    const int pollTimeout = 100;
+
+    // stack the thread touches and locks before reading anything, so it never faults on it
+    const size_t lockedStackSize = 64 * 1024;
+
+    // a fixed size name, so sources can be added on the input thread without allocating
+    struct Source
+    {
+        int client;
+        int port;
+        char name[96];
+    };
+}
+
+//==============================================================================
+struct AlsaSequencerInput::Pimpl
+{
+    ~Pimpl()
+    {
+        if (decoder != nullptr)
+        {
+            snd_midi_event_free (decoder);
+        }
+        if (sequencer != nullptr)
+        {
+            snd_seq_close (sequencer);
+        }
+    }
+
+    // the kernel timestamps events with the real time of the queue, this is the
+    // getMillisecondCounterHiRes() time (in seconds) at which the queue was at zero
+    double getTime (const snd_seq_event_t& event) const
+    {
+        if ((event.flags & SND_SEQ_TIME_STAMP_MASK) != SND_SEQ_TIME_STAMP_REAL)
+        {
+            return juce::Time::getMillisecondCounterHiRes() * 0.001;
+        }
+        return queueStart + event.time.time.tv_sec + event.time.time.tv_nsec * 1.0e-9;
+    }
+
+    // index of the source with the address, -1 if it isn't one
+    int findSource (const snd_seq_addr_t& address) const
+    {
+        const int count = numSources.load (std::memory_order_relaxed);
+        for (int i = 0; i < count; ++i)
+        {
+            if (sources[i].client == address.client && sources[i].port == address.port)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // the index of the source with the address, added if it is new, -1 if there are too many
+    // only called by open() and then the input thread, the infos are on the stack so it doesn't allocate
+    int addSource (const snd_seq_addr_t& address)
+    {
+        const int found = findSource (address);
+        const int count = numSources.load (std::memory_order_relaxed);
+        if (found >= 0 || count == maxSources)
+        {
+            return found;
+        }
+
+        snd_seq_client_info_t* clientInfo;
+        snd_seq_port_info_t* portInfo;
+        snd_seq_client_info_alloca (&clientInfo);
+        snd_seq_port_info_alloca (&portInfo);
+        auto& source = sources[count];
+        source.client = address.client;
+        source.port = address.port;
+        if (snd_seq_get_any_client_info (sequencer, address.client, clientInfo) >= 0
+            && snd_seq_get_any_port_info (sequencer, address.client, address.port, portInfo) >= 0)
+        {
+            std::snprintf (source.name, sizeof (source.name), "%s: %s", snd_seq_client_info_get_name (clientInfo), snd_seq_port_info_get_name (portInfo));
+        } else
+        {
+            std::snprintf (source.name, sizeof (source.name), "%d:%d", address.client, address.port);
+        }
+        // readers on other threads see the source filled in once they see the count
+        numSources.store (count + 1, std::memory_order_release);
+        return count;
+    }
+
+    // connects a port to ours if it can be read from, and isn't a system port or our own
+    bool connect (int fromClient, int fromPort)
+    {
+        if (fromClient == SND_SEQ_CLIENT_SYSTEM || fromClient == client)
+        {
+            return false;
+        }
+        snd_seq_port_info_t* portInfo;
+        snd_seq_port_info_alloca (&portInfo);
+        if (snd_seq_get_any_port_info (sequencer, fromClient, fromPort, portInfo) < 0)
+        {
+            return false;
+        }
+        const unsigned int capability = snd_seq_port_info_get_capability (portInfo);
+        const unsigned int readable = SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ;
+        if ((capability & readable) != readable || (capability & SND_SEQ_PORT_CAP_NO_EXPORT) != 0)
+        {
+            return false;
+        }
+        return snd_seq_connect_from (sequencer, port, fromClient, fromPort) >= 0;
+    }
+
+    snd_seq_t* sequencer = nullptr;
+    snd_midi_event_t* decoder = nullptr;
+    int client = -1;
+    int port = -1;
+    int queue = -1;
+    double queueStart = 0.0;
+
+    // sources are only added, by one thread at a time
+    Source sources[maxSources];
+    std::atomic<int> numSources { 0 };
+    std::vector<pollfd> descriptors;
+    juce::uint8 message[maxMessageSize];
+};
+
+//==============================================================================
+AlsaSequencerInput::AlsaSequencerInput (Callback& c)
+  : juce::Thread ("ALSA MIDI input"), pimpl (std::make_unique<Pimpl>()), callback (c)
+{
+}
+
+AlsaSequencerInput::~AlsaSequencerInput()
+{
+    stop();
+}
+
+bool AlsaSequencerInput::open (const juce::String& clientName)
+{
+    stop();
+    pimpl = std::make_unique<Pimpl>();
+    auto& p = *pimpl;
+
+    if (snd_seq_open (&p.sequencer, "default", SND_SEQ_OPEN_DUPLEX, SND_SEQ_NONBLOCK) < 0)
+    {
+        p.sequencer = nullptr;
+        return false;
+    }
+    snd_seq_set_client_name (p.sequencer, clientName.toRawUTF8());
+    p.client = snd_seq_client_id (p.sequencer);
+
+    // the port timestamps what it receives with the real time of a queue of its own
+    p.queue = snd_seq_alloc_named_queue (p.sequencer, clientName.toRawUTF8());
+    snd_seq_port_info_t* portInfo = nullptr;
+    snd_seq_port_info_malloc (&portInfo);
+    snd_seq_port_info_set_name (portInfo, "Input");
+    snd_seq_port_info_set_capability (portInfo, SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE);
+    snd_seq_port_info_set_type (portInfo, SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+    snd_seq_port_info_set_timestamping (portInfo, 1);
+    snd_seq_port_info_set_timestamp_real (portInfo, 1);
+    snd_seq_port_info_set_timestamp_queue (portInfo, p.queue);
+    const bool created = p.queue >= 0 && snd_seq_create_port (p.sequencer, portInfo) >= 0;
+    p.port = snd_seq_port_info_get_port (portInfo);
+    snd_seq_port_info_free (portInfo);
+    if (! created || snd_midi_event_new (maxMessageSize, &p.decoder) < 0)
+    {
+        pimpl = std::make_unique<Pimpl>();
+        return false;
+    }
+    // every message is passed on with its status byte
+    snd_midi_event_no_status (p.decoder, 1);
+
+    snd_seq_start_queue (p.sequencer, p.queue, nullptr);
+    snd_seq_drain_output (p.sequencer);
+    snd_seq_queue_status_t* status = nullptr;
+    snd_seq_queue_status_malloc (&status);
+    snd_seq_get_queue_status (p.sequencer, p.queue, status);
+    auto queueTime = snd_seq_queue_status_get_real_time (status);
+    p.queueStart = juce::Time::getMillisecondCounterHiRes() * 0.001 - (queueTime->tv_sec + queueTime->tv_nsec * 1.0e-9);
+    snd_seq_queue_status_free (status);
+
+    // the announce port tells us about ports that appear and connections made later
+    snd_seq_connect_from (p.sequencer, p.port, SND_SEQ_CLIENT_SYSTEM, SND_SEQ_PORT_SYSTEM_ANNOUNCE);
+
+    // every port that can be read from, except the system ports and our own
+    snd_seq_client_info_t* clientInfo = nullptr;
+    snd_seq_client_info_malloc (&clientInfo);
+    snd_seq_port_info_malloc (&portInfo);
+    snd_seq_client_info_set_client (clientInfo, -1);
+    while (snd_seq_query_next_client (p.sequencer, clientInfo) >= 0)
+    {
+        const int client = snd_seq_client_info_get_client (clientInfo);
+        snd_seq_port_info_set_client (portInfo, client);
+        snd_seq_port_info_set_port (portInfo, -1);
+        while (snd_seq_query_next_port (p.sequencer, portInfo) >= 0)
+        {
+            const int port = snd_seq_port_info_get_port (portInfo);
+            if (p.connect (client, port))
+            {
+                p.addSource (*snd_seq_port_info_get_addr (portInfo));
+            }
+        }
+    }
+    snd_seq_port_info_free (portInfo);
+    snd_seq_client_info_free (clientInfo);
+
+    p.descriptors.resize (static_cast<size_t>(snd_seq_poll_descriptors_count (p.sequencer, POLLIN)));
+    snd_seq_poll_descriptors (p.sequencer, p.descriptors.data(), static_cast<unsigned int>(p.descriptors.size()), POLLIN);
+    return true;
+}
+
+int AlsaSequencerInput::getNumSources() const
+{
+    return pimpl->numSources.load (std::memory_order_acquire);
+}
+
+juce::String AlsaSequencerInput::getSourceName (int index) const
+{
+    return juce::String (juce::CharPointer_UTF8 (pimpl->sources[index].name));
+}
+
+juce::String AlsaSequencerInput::getAddress() const
+{
+    return juce::String (pimpl->client) + ":" + juce::String (pimpl->port);
+}
+
+void AlsaSequencerInput::start (int priority)
+{
+    if (pimpl->sequencer == nullptr || isThreadRunning())
+    {
+        return;
+    }
+    realtimePriority = priority;
+    started.reset();
+    startThread();
+    started.wait (1000);
+}
+
+void AlsaSequencerInput::stop()
+{
+    stopThread (pollTimeout * 10);
+}
+
+bool AlsaSequencerInput::isRealtime() const
+{
+    return realtime;
+}
+
+bool AlsaSequencerInput::isMemoryLocked() const
+{
+    return memoryLocked;
+}
+
+void AlsaSequencerInput::run()
+{
+    auto& p = *pimpl;
+
+    if (realtimePriority > 0)
+    {
+        sched_param parameters {};
+        parameters.sched_priority = juce::jlimit (sched_get_priority_min (SCHED_FIFO), sched_get_priority_max (SCHED_FIFO), realtimePriority);
+        realtime = pthread_setschedparam (pthread_self(), SCHED_FIFO, &parameters) == 0;
+    }
+
+    // the stack is touched before it is locked, so its pages are there to lock
+    char stack[lockedStackSize];
+    std::memset (stack, 0, sizeof (stack));
+    memoryLocked = mlock (stack, sizeof (stack)) == 0
+                && mlock (&p, sizeof (p)) == 0
+                && mlock (p.descriptors.data(), p.descriptors.size() * sizeof (pollfd)) == 0;
+    started.signal();
+
+    while (! threadShouldExit())
+    {
+        if (poll (p.descriptors.data(), static_cast<nfds_t>(p.descriptors.size()), pollTimeout) <= 0)
+        {
+            continue;
+        }
+
+        // events come out of the buffer libasound allocated when the sequencer was opened
+        snd_seq_event_t* event = nullptr;
+        int remaining = 0;
+        do
+        {
+            remaining = snd_seq_event_input (p.sequencer, &event);
+            if (remaining < 0 || event == nullptr)
+            {
+                // -ENOSPC means the kernel dropped events when the buffer overran, carry on
+                break;
+            }
+            if (event->type == SND_SEQ_EVENT_PORT_START)
+            {
+                p.connect (event->data.addr.client, event->data.addr.port);
+                continue;
+            }
+            if (event->type == SND_SEQ_EVENT_PORT_SUBSCRIBED)
+            {
+                // a port connected to ours from outside gets its source before it plays anything
+                auto& connection = event->data.connect;
+                if (connection.dest.client == p.client && connection.dest.port == p.port)
+                {
+                    p.addSource (connection.sender);
+                }
+                continue;
+            }
+            if (event->source.client == SND_SEQ_CLIENT_SYSTEM)
+            {
+                continue;
+            }
+
+            // events can also come from a port we missed the subscription of
+            const int source = p.addSource (event->source);
+            if (source < 0)
+            {
+                continue;
+            }
+            const long size = snd_midi_event_decode (p.decoder, p.message, maxMessageSize, event);
+            snd_midi_event_reset_decode (p.decoder);
+            if (size > 0)
+            {
+                callback.handleSequencerMessage (source, p.message, static_cast<int>(size), p.getTime (*event));
+            }
+        }
+        while (remaining > 0);
+    }
+
+    munlock (stack, sizeof (stack));
+    munlock (&p, sizeof (p));
+    munlock (p.descriptors.data(), p.descriptors.size() * sizeof (pollfd));
+}
+
+#endif
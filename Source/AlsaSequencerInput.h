@@ -0,0 +1,82 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_LINUX
+
+#include <atomic>
+#include <memory>
+
+//==============================================================================
+/*
+    Reads MIDI straight from the ALSA sequencer on Linux, on a thread of its own, instead of
+    going through juce::MidiInput.
+
+    One sequencer client with a single input port is connected to every readable port, so
+    each source is told apart by its address. Ports that appear later are connected too, and a
+    port connected from outside (e.g. with aconnect) becomes a new source when it is
+    subscribed or sends its first event, up to maxSources. The port asks the kernel to timestamp events as
+    they arrive, so the time handed on is when the event was received, not when the thread
+    got round to reading it.
+
+    The thread can run with realtime (SCHED_FIFO) priority and locks its stack and buffers in
+    memory. Nothing is allocated once it is running, so the callback must not allocate either.
+*/
+class AlsaSequencerInput : private juce::Thread
+{
+public:
+    class Callback
+    {
+    public:
+        virtual ~Callback() = default;
+
+        // called on the input thread, time uses the same clock as getMillisecondCounterHiRes()
+        // (in seconds), source is the index of the port the message came from
+        virtual void handleSequencerMessage (int source, const juce::uint8* data, int size, double time) = 0;
+    };
+
+    explicit AlsaSequencerInput (Callback& c);
+    ~AlsaSequencerInput() override;
+
+    // creates the client and connects every readable port to it, returns false if the
+    // sequencer can't be opened (no snd-seq module, or not Linux)
+    bool open (const juce::String& clientName);
+
+    static const int maxSources = 64;
+
+    // sources connected so far, it only grows, and can be called from any thread
+    int getNumSources() const;
+
+    juce::String getSourceName (int index) const;
+
+    // "client:port" of the input port, for connecting more sources with aconnect
+    juce::String getAddress() const;
+
+    // priority is the SCHED_FIFO priority (1-99), or 0 to keep normal scheduling
+    // returns once the thread has set its priority and locked its memory
+    void start (int priority);
+
+    void stop();
+
+    // false if the thread was refused realtime priority (no rtprio in limits.conf), or
+    // couldn't lock its memory (memlock limit), it still runs without them
+    bool isRealtime() const;
+
+    bool isMemoryLocked() const;
+
+private:
+    void run() override;
+
+    struct Pimpl;
+    std::unique_ptr<Pimpl> pimpl;
+
+    Callback& callback;
+    int realtimePriority = 0;
+    std::atomic<bool> realtime { false };
+    std::atomic<bool> memoryLocked { false };
+    juce::WaitableEvent started;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AlsaSequencerInput)
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include "ArpeggioAccumulator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    // energy below which a pitch class is no longer part of the chord
+    const double threshold = 0.25;
+
+    // however often a note is repeated, it lasts at most log (8) / log (4) = 1.5 windows after
+    // it stops, so the previous chord doesn't linger once the pattern changes
+    const double maxEnergy = 2.0;
+}
+
+ArpeggioAccumulator::ArpeggioAccumulator()
+{
+    setWindow (0.75);
+}
+
+void ArpeggioAccumulator::setWindow (double seconds)
+{
+    window = std::max (0.001, seconds);
+    decayRate = std::log (1.0 / threshold) / window;
+}
+
+double ArpeggioAccumulator::getWindow() const
+{
+    return window;
+}
+
+void ArpeggioAccumulator::add (const NoteEvent& event)
+{
+    if (event.note < 0 || event.note > 127)
+    {
+        return;
+    }
+    auto& pitchClass = pitchClasses[static_cast<size_t>(event.note % 12)];
+
+    if (event.on)
+    {
+        // a lower note takes over as the lowest, and so does any note once the lowest is no longer recent
+        if (event.note <= pitchClass.lowest || event.time >= pitchClass.lowestExpiry || ! isActive (pitchClass, event.time))
+        {
+            pitchClass.lowest = event.note;
+            pitchClass.lowestExpiry = std::numeric_limits<double>::infinity();
+        }
+        update (pitchClass, std::min (maxEnergy, getEnergy (pitchClass, event.time) + 1.0), event.time);
+        ++pitchClass.held;
+    } else if (pitchClass.held > 0)
+    {
+        // held notes don't decay, so the energy decays from at least one note's worth on release
+        update (pitchClass, std::max (1.0, getEnergy (pitchClass, event.time)), event.time);
+        --pitchClass.held;
+        if (event.note == pitchClass.lowest)
+        {
+            pitchClass.lowestExpiry = event.time + window;
+        }
+    }
+}
+
+void ArpeggioAccumulator::reset()
+{
+    pitchClasses = {};
+}
+
+uint16_t ArpeggioAccumulator::getPitchClasses (double time) const
+{
+    uint16_t mask = 0;
+    for (size_t i = 0; i < pitchClasses.size(); ++i)
+    {
+        if (isActive (pitchClasses[i], time))
+        {
+            mask |= static_cast<uint16_t>(1 << i);
+        }
+    }
+    return mask;
+}
+
+int ArpeggioAccumulator::getBass (double time) const
+{
+    int bass = 128;
+    for (auto& pitchClass : pitchClasses)
+    {
+        if (isActive (pitchClass, time))
+        {
+            bass = std::min (bass, pitchClass.lowest);
+        }
+    }
+    return bass < 128 ? bass : -1;
+}
+
+void ArpeggioAccumulator::getNotes (double time, std::vector<int>& notes) const
+{
+    notes.clear();
+    const int bass = getBass (time);
+    if (bass < 0)
+    {
+        return;
+    }
+    const uint16_t mask = getPitchClasses (time);
+    notes.push_back (bass);
+    for (int interval = 1; interval < 12; ++interval)
+    {
+        if ((mask >> ((bass + interval) % 12)) & 1)
+        {
+            notes.push_back (bass + interval);
+        }
+    }
+}
+
+bool ArpeggioAccumulator::isActive (const PitchClass& pitchClass, double time) const
+{
+    return pitchClass.held > 0 || time < pitchClass.expiry;
+}
+
+double ArpeggioAccumulator::getEnergy (const PitchClass& pitchClass, double time) const
+{
+    if (pitchClass.held > 0)
+    {
+        return pitchClass.energy;
+    }
+    return pitchClass.energy * std::exp (-decayRate * std::max (0.0, time - pitchClass.time));
+}
+
+void ArpeggioAccumulator::update (PitchClass& pitchClass, double energy, double time)
+{
+    pitchClass.energy = energy;
+    pitchClass.time = time;
+    pitchClass.expiry = time + std::log (energy / threshold) / decayRate;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "OnsetGrouper.h"
+
+//==============================================================================
+// Recognises broken chords (arpeggios, Alberti bass, picked guitar chords), whose notes are
+// never held down together, by remembering what was played recently.
+//
+// Each pitch class has an energy that a note on adds one to (up to two), and that decays
+// exponentially once no note of the pitch class is held. The decay is applied lazily from the
+// timestamps when an event arrives, and the time the energy will fall below the threshold is
+// stored, so an event costs one exp() and reading the pitch classes at any time is a
+// comparison per pitch class. A single note counts for the window after it was released,
+// notes repeated in the pattern for up to half a window longer. The bass is the lowest recent
+// note: each pitch class keeps its lowest note until a window after it was released, then
+// takes the next one played, so the bass follows the pattern when the chord changes. Fixed
+// size, never allocates.
+class ArpeggioAccumulator
+{
+public:
+    ArpeggioAccumulator();
+
+    // seconds a single note still counts after it was released
+    void setWindow (double seconds);
+
+    double getWindow() const;
+
+    void add (const NoteEvent& event);
+
+    // forgets every note
+    void reset();
+
+    // bit i is set if pitch class i is held or was played within the window before time
+    uint16_t getPitchClasses (double time) const;
+
+    // lowest recent note of those pitch classes, -1 if there are none
+    int getBass (double time) const;
+
+    // the bass and one note for each other pitch class above it, in ascending order, so they
+    // can be identified as if they were held together
+    void getNotes (double time, std::vector<int>& notes) const;
+
+private:
+    struct PitchClass
+    {
+        double energy = 0.0;
+        // time energy was last updated
+        double time = 0.0;
+        // time energy falls below the threshold, if nothing is held
+        double expiry = 0.0;
+        int held = 0;
+        int lowest = 0;
+        // the lowest note stops being recent a window after it was released
+        double lowestExpiry = 0.0;
+    };
+
+    bool isActive (const PitchClass& pitchClass, double time) const;
+
+    // energy at time, with the decay since it was last updated
+    double getEnergy (const PitchClass& pitchClass, double time) const;
+
+    void update (PitchClass& pitchClass, double energy, double time);
+
+    std::array<PitchClass, 12> pitchClasses;
+    double window = 0.0;
+    // per second, so that one note decays to the threshold in the window
+    double decayRate = 0.0;
+};
@@ -0,0 +1,738 @@
+#include "ChordAnalysis.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <tuple>
+
+namespace
+{
+    // array used to convert key number to a scale degree that is easier to work with
+    const int keyToScaleDegree[30] = {0, 9, 7, 4, 2, 11, 9, 6, 4, 1, 11, 8, 6, 3, 1, 10, 5, 2, 10, 7, 3, 0, 8, 5, 1, 10, 6, 3, 11, 8};
+
+    //-----------------------------Chord Database-----------------------------
+    const std::unordered_map<std::vector<int>, Chord, VectorHasher> chordDb =
+    {
+        {std::vector<int> {4, 7}, Chord::MajTriadRoot},
+        {std::vector<int> {3, 8}, Chord::MajTriadFirst},
+        {std::vector<int> {5, 9}, Chord::MajTriadSecond},
+        {std::vector<int> {3, 7}, Chord::MinTriadRoot},
+        {std::vector<int> {4, 9}, Chord::MinTriadFirst},
+        {std::vector<int> {4, 8}, Chord::AugTriadRoot},
+        {std::vector<int> {3, 6}, Chord::DimTriadRoot},
+        {std::vector<int> {3, 9}, Chord::DimTriadFirst},
+        {std::vector<int> {4, 7, 10}, Chord::SeventhRoot},
+        {std::vector<int> {3, 6, 8}, Chord::SeventhFirst},
+        {std::vector<int> {3, 5, 9}, Chord::SeventhSecond},
+        {std::vector<int> {2, 6, 9}, Chord::SeventhThird},
+        {std::vector<int> {3, 6, 9}, Chord::DimSeventh},
+        {std::vector<int> {3, 6, 10}, Chord::HalfDimSeventhRoot},
+        {std::vector<int> {3, 7, 9}, Chord::HalfDimSeventhFirst},
+        {std::vector<int> {4, 6, 9}, Chord::HalfDimSeventhSecond},
+        {std::vector<int> {2, 5, 8}, Chord::HalfDimSeventhThird},
+        {std::vector<int> {3, 7, 10}, Chord::MinSeventhRoot},
+        {std::vector<int> {4, 7, 9}, Chord::MinSeventhFirst},
+        {std::vector<int> {3, 5, 8}, Chord::MinSeventhSecond},
+        {std::vector<int> {2, 5, 9}, Chord::MinSeventhThird}
+    };
+
+    const char* const keyNames[30] =
+    {
+        "C major", "a minor", "G major", "e minor", "D major", "b minor", "A major", "f\xe2\x99\xaf minor",
+        "E major", "c\xe2\x99\xaf minor", "B major", "g\xe2\x99\xaf minor", "F\xe2\x99\xaf major", "d\xe2\x99\xaf minor",
+        "C\xe2\x99\xaf major", "a\xe2\x99\xaf minor", "F major", "d minor", "B\xe2\x99\xad major", "g minor",
+        "E\xe2\x99\xad major", "c minor", "A\xe2\x99\xad major", "f minor", "D\xe2\x99\xad major", "b\xe2\x99\xad minor",
+        "G\xe2\x99\xad major", "e\xe2\x99\xad minor", "C\xe2\x99\xad major", "a\xe2\x99\xad minor"
+    };
+
+    // every string a ChordResult can point to, so that results can be packed as indices
+    const char* const allFigures[7] = {"", "6", "6\n4", "7", "6\n5", "4\n3", "4\n2"};
+    const char* const allQualities[4] = {"", "o", "+", "\xc3\xb8"};
+
+    template <size_t size>
+    int indexOf (const char* const (&strings)[size], const char* s)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (std::strcmp (strings[i], s) == 0)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return 0;
+    }
+
+    // how each chord is drawn, indexed by Chord
+    // rootOffset is the distance in semitones from the bass up to the root
+    struct ChordInfo
+    {
+        int rootOffset;
+        bool capital;
+        const char* figures;
+        const char* quality;
+    };
+
+    const ChordInfo chordInfo[ChordAnalysis::numChordTypes] =
+    {
+        {0, true,  "",     ""},             // MajTriadRoot
+        {8, true,  "6",    ""},             // MajTriadFirst
+        {5, true,  "6\n4", ""},             // MajTriadSecond
+        {0, false, "",     ""},             // MinTriadRoot
+        {9, false, "6",    ""},             // MinTriadFirst
+        {0, true,  "",     "+"},            // AugTriadRoot
+        {0, false, "",     "o"},            // DimTriadRoot
+        {9, false, "6",    "o"},            // DimTriadFirst
+        {0, true,  "7",    ""},             // SeventhRoot
+        {8, true,  "6\n5", ""},             // SeventhFirst
+        {5, true,  "4\n3", ""},             // SeventhSecond
+        {2, true,  "4\n2", ""},             // SeventhThird
+        {0, false, "",     "o"},            // DimSeventh (handled separately)
+        {0, false, "7",    "\xc3\xb8"},     // HalfDimSeventhRoot
+        {9, false, "6\n5", "\xc3\xb8"},     // HalfDimSeventhFirst
+        {6, false, "4\n3", "\xc3\xb8"},     // HalfDimSeventhSecond
+        {2, false, "4\n2", "\xc3\xb8"},     // HalfDimSeventhThird
+        {0, false, "7",    ""},             // MinSeventhRoot
+        {9, false, "6\n5", ""},             // MinSeventhFirst
+        {5, false, "4\n3", ""},             // MinSeventhSecond
+        {2, false, "4\n2", ""}              // MinSeventhThird
+    };
+
+    // semitones from the root up to the third, fifth and seventh (-1 for triads), indexed by Chord
+    struct ChordTones
+    {
+        int third;
+        int fifth;
+        int seventh;
+    };
+
+    const ChordTones chordTones[ChordAnalysis::numChordTypes] =
+    {
+        {4, 7, -1}, {4, 7, -1}, {4, 7, -1},                 // major triads
+        {3, 7, -1}, {3, 7, -1},                             // minor triads
+        {4, 8, -1},                                         // augmented triad
+        {3, 6, -1}, {3, 6, -1},                             // diminished triads
+        {4, 7, 10}, {4, 7, 10}, {4, 7, 10}, {4, 7, 10},     // sevenths
+        {3, 6, 9},                                          // diminished seventh
+        {3, 6, 10}, {3, 6, 10}, {3, 6, 10}, {3, 6, 10},     // half diminished sevenths
+        {3, 7, 10}, {3, 7, 10}, {3, 7, 10}, {3, 7, 10}      // minor sevenths
+    };
+
+    // chordDb flattened into a table indexed by interval mask, -1 where there is no chord
+    // so that identification doesn't need to allocate or hash a vector
+    const std::array<int8_t, 4096>& getMaskTable()
+    {
+        static const std::array<int8_t, 4096> table = []
+        {
+            std::array<int8_t, 4096> t;
+            t.fill (-1);
+            for (auto& entry : chordDb)
+            {
+                int mask = 0;
+                for (auto interval : entry.first)
+                {
+                    mask |= 1 << interval;
+                }
+                t[static_cast<size_t>(mask)] = static_cast<int8_t>(entry.second);
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    // every chord type on every bass pitch class identified in every key, packed,
+    // so the results in all keys are one row of the table
+    using KeyRow = std::array<uint16_t, ChordAnalysis::numKeys>;
+
+    const std::array<std::array<KeyRow, 12>, ChordAnalysis::numChordTypes>& getKeyTable()
+    {
+        static const auto table = []
+        {
+            std::array<std::array<KeyRow, 12>, ChordAnalysis::numChordTypes> t;
+            for (auto& entry : chordDb)
+            {
+                uint16_t mask = 0;
+                for (auto interval : entry.first)
+                {
+                    mask |= static_cast<uint16_t>(1 << interval);
+                }
+                for (int bass = 0; bass < 12; ++bass)
+                {
+                    for (int key = 1; key <= ChordAnalysis::numKeys; ++key)
+                    {
+                        t[static_cast<size_t>(entry.second)][static_cast<size_t>(bass)][static_cast<size_t>(key - 1)]
+                            = ChordAnalysis::pack (ChordAnalysis::identify (mask, bass, key));
+                    }
+                }
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    // pitch classes of the major and harmonic minor scales as bit masks
+    const int majorScaleMask = 0xab5;
+    const int minorScaleMask = 0x9ad;
+
+    // every distinct set of pitch classes a chord can have, indexed by each of its subsets, so
+    // the chords a partial set of notes can grow into are one lookup away
+    // sets[offsets[m]] to sets[offsets[m + 1]] are the chords containing pitch class mask m
+    struct SupersetIndex
+    {
+        std::array<uint16_t, 4097> offsets;
+        std::vector<uint16_t> sets;
+    };
+
+    const SupersetIndex& getSupersetIndex()
+    {
+        static const SupersetIndex index = []
+        {
+            std::vector<uint16_t> chords;
+            std::array<bool, 4096> seen {};
+            for (auto& entry : chordDb)
+            {
+                for (int bass = 0; bass < 12; ++bass)
+                {
+                    uint16_t pitchClasses = static_cast<uint16_t>(1 << bass);
+                    for (auto interval : entry.first)
+                    {
+                        pitchClasses |= static_cast<uint16_t>(1 << ((bass + interval) % 12));
+                    }
+                    if (! seen[pitchClasses])
+                    {
+                        seen[pitchClasses] = true;
+                        chords.push_back (pitchClasses);
+                    }
+                }
+            }
+
+            // counted first, so the sets of each subset can be laid out next to each other
+            SupersetIndex result;
+            std::array<uint16_t, 4097> counts {};
+            for (auto chord : chords)
+            {
+                for (uint16_t subset = chord; subset != 0; subset = static_cast<uint16_t>((subset - 1) & chord))
+                {
+                    ++counts[subset];
+                }
+            }
+            result.offsets[0] = 0;
+            for (size_t m = 0; m < 4096; ++m)
+            {
+                result.offsets[m + 1] = static_cast<uint16_t>(result.offsets[m] + counts[m]);
+            }
+            result.sets.resize (result.offsets[4096]);
+            auto next = result.offsets;
+            for (auto chord : chords)
+            {
+                for (uint16_t subset = chord; subset != 0; subset = static_cast<uint16_t>((subset - 1) & chord))
+                {
+                    result.sets[next[subset]++] = chord;
+                }
+            }
+            return result;
+        }();
+        return index;
+    }
+
+    // how common a chord on each chromatic degree is, 0 for the most common (I, V, IV, ii, vi, iii, vii)
+    const int majorDegreeRank[12] = {0, 9, 3, 9, 5, 2, 9, 1, 9, 4, 9, 6};
+    const int minorDegreeRank[12] = {0, 9, 3, 5, 9, 2, 9, 1, 4, 9, 7, 6};
+
+    int countPitchClasses (uint16_t mask)
+    {
+        int count = 0;
+        for (; mask != 0; mask &= static_cast<uint16_t>(mask - 1))
+        {
+            ++count;
+        }
+        return count;
+    }
+}
+
+//==============================================================================
+int ChordResult::getSymbolId() const
+{
+    return valid ? chromaticDegree * ChordAnalysis::numChordTypes + static_cast<int>(chord) : -1;
+}
+
+int ChordResult::getNumeralId() const
+{
+    return valid ? chromaticDegree * 2 + (capital ? 1 : 0) : -1;
+}
+
+//==============================================================================
+int ChordAnalysis::getTonic (int key)
+{
+    return keyToScaleDegree[key - 1];
+}
+
+bool ChordAnalysis::isMajor (int key)
+{
+    return key % 2;
+}
+
+uint16_t ChordAnalysis::getIntervalMask (const std::vector<int>& notes)
+{
+    uint16_t mask = 0;
+    for (size_t i = 1; i < notes.size(); ++i)
+    {
+        // exclude the unison (which forms an interval of 0)
+        int interval = (notes[i] - notes[0]) % 12;
+        if (interval != 0)
+        {
+            mask |= static_cast<uint16_t>(1 << interval);
+        }
+    }
+    return mask;
+}
+
+int ChordAnalysis::getChordType (uint16_t intervalMask)
+{
+    return getMaskTable()[intervalMask & 0xfff];
+}
+
+ChordResult ChordAnalysis::identify (const std::vector<int>& notes, int key)
+{
+    // return if chord has less than 3 notes
+    if (notes.size() < 3)
+    {
+        return {};
+    }
+    return identify (getIntervalMask (notes), notes[0], key);
+}
+
+ChordResult ChordAnalysis::identify (uint16_t intervalMask, int bassNote, int key)
+{
+    ChordResult result;
+
+    // return if no key is set, or if we cannot find the chord
+    if (key < 1 || key > numKeys)
+    {
+        return result;
+    }
+    int type = getMaskTable()[intervalMask & 0xfff];
+    if (type < 0)
+    {
+        return result;
+    }
+
+    auto& info = chordInfo[type];
+    int chromaticDegree = bassNote + 12 - getTonic (key);
+
+    result.chord = static_cast<Chord>(type);
+    result.capital = info.capital;
+    result.figures = info.figures;
+    result.quality = info.quality;
+    result.chromaticDegree = (chromaticDegree + info.rootOffset) % 12;
+
+    switch (result.chord)
+    {
+        case Chord::MajTriadSecond:
+            if (result.chromaticDegree == 0)
+            {
+                // cadential 6-4 is a V chord
+                result.chromaticDegree = 7;
+            }
+            break;
+        case Chord::DimSeventh:
+            // only the leading tone diminished seventh is supported, in any inversion
+            switch (chromaticDegree % 12)
+            {
+                case 11:
+                    result.figures = "7";
+                    break;
+                case 2:
+                    result.figures = "6\n5";
+                    break;
+                case 5:
+                    result.figures = "4\n3";
+                    break;
+                case 8:
+                    result.figures = "4\n2";
+                    break;
+                default:
+                    return result;
+            }
+            result.chromaticDegree = 11;
+            break;
+        default:
+            break;
+    }
+
+    result.valid = true;
+    return result;
+}
+
+std::array<ChordResult, ChordAnalysis::numKeys> ChordAnalysis::identifyInAllKeys (uint16_t intervalMask, int bassNote)
+{
+    std::array<ChordResult, numKeys> results;
+    int type = getMaskTable()[intervalMask & 0xfff];
+    if (type < 0)
+    {
+        return results;
+    }
+
+    auto& row = getKeyTable()[static_cast<size_t>(type)][static_cast<size_t>(bassNote % 12)];
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        results[i] = unpack (row[i]);
+    }
+    return results;
+}
+
+std::array<ChordResult, ChordAnalysis::numKeys> ChordAnalysis::identifyInAllKeys (const std::vector<int>& notes)
+{
+    if (notes.size() < 3)
+    {
+        return {};
+    }
+    return identifyInAllKeys (getIntervalMask (notes), notes[0]);
+}
+
+bool ChordAnalysis::isDiatonic (const ChordResult& result, int key)
+{
+    if (! result.valid || key < 1 || key > numKeys)
+    {
+        return false;
+    }
+
+    const int scale = isMajor (key) ? majorScaleMask : minorScaleMask;
+    auto& tones = chordTones[static_cast<int>(result.chord)];
+    for (auto interval : {0, tones.third, tones.fifth, tones.seventh})
+    {
+        if (interval >= 0 && ((scale >> ((result.chromaticDegree + interval) % 12)) & 1) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<ChordAnalysis::Prediction> ChordAnalysis::predict (const std::vector<int>& notes, int key, size_t maxPredictions)
+{
+    std::vector<Prediction> predictions;
+    if (notes.empty() || key < 1 || key > numKeys)
+    {
+        return predictions;
+    }
+    uint16_t played = 0;
+    for (auto note : notes)
+    {
+        played |= static_cast<uint16_t>(1 << (note % 12));
+    }
+    // a single pitch class could become almost anything
+    if (countPitchClasses (played) < 2)
+    {
+        return predictions;
+    }
+
+    auto& index = getSupersetIndex();
+    const int bass = notes[0] % 12;
+    for (size_t i = index.offsets[played]; i < index.offsets[played + 1]; ++i)
+    {
+        const uint16_t chord = index.sets[i];
+        if (chord == played)
+        {
+            continue;
+        }
+        // the missing notes are added above the bass
+        uint16_t intervalMask = 0;
+        for (int pitchClass = 0; pitchClass < 12; ++pitchClass)
+        {
+            if (((chord >> pitchClass) & 1) != 0 && pitchClass != bass)
+            {
+                intervalMask |= static_cast<uint16_t>(1 << ((pitchClass - bass + 12) % 12));
+            }
+        }
+        auto result = identify (intervalMask, notes[0], key);
+        if (result.valid)
+        {
+            predictions.push_back ({ result, static_cast<uint16_t>(chord & ~played) });
+        }
+    }
+
+    auto& degreeRank = isMajor (key) ? majorDegreeRank : minorDegreeRank;
+    auto rank = [key, &degreeRank] (const Prediction& p)
+    {
+        return std::make_tuple (isDiatonic (p.result, key) ? 0 : 1, countPitchClasses (p.missing),
+                                degreeRank[p.result.chromaticDegree], p.result.getSymbolId());
+    };
+    std::sort (predictions.begin(), predictions.end(), [&rank] (const Prediction& a, const Prediction& b) { return rank (a) < rank (b); });
+    if (predictions.size() > maxPredictions)
+    {
+        predictions.resize (maxPredictions);
+    }
+    return predictions;
+}
+
+std::vector<int> ChordAnalysis::getRelatedKeys (int key)
+{
+    std::vector<int> keys;
+    if (key < 1 || key > numKeys)
+    {
+        return keys;
+    }
+    const int fifths = getFifths (key);
+    for (int f : {fifths, fifths + 1, fifths - 1})
+    {
+        for (bool major : {isMajor (key), ! isMajor (key)})
+        {
+            int related = getKeyFromFifths (f, major);
+            if (related != 0)
+            {
+                keys.push_back (related);
+            }
+        }
+    }
+    return keys;
+}
+
+std::string ChordAnalysis::getPivotText (const std::array<ChordResult, numKeys>& results, int key)
+{
+    if (key < 1 || key > numKeys || ! isDiatonic (results[static_cast<size_t>(key - 1)], key))
+    {
+        return {};
+    }
+
+    // keys are named by their tonic only, with capitals for major keys
+    auto shortName = [] (int k)
+    {
+        std::string name = getKeyName (k);
+        return name.substr (0, name.find (' '));
+    };
+
+    std::string text;
+    int numKeysUsed = 0;
+    for (auto related : getRelatedKeys (key))
+    {
+        auto& result = results[static_cast<size_t>(related - 1)];
+        if (isDiatonic (result, related))
+        {
+            text += (text.empty() ? "" : " = ") + getNumeralText (result, related) + " in " + shortName (related);
+            ++numKeysUsed;
+        }
+    }
+    // a chord that belongs to no other key is not a pivot
+    return numKeysUsed > 1 ? text : std::string();
+}
+
+ChordAnalysis::Spelling ChordAnalysis::spell (int chromaticDegree, bool capital, int key)
+{
+    // draws a capital roman numeral depending on chord having major or minor third
+    // for 3, 8 semitones (minor third and sixth), draw a flat if key is major
+    // for 4, 9 semitones (major third and sixth), draw a sharp if key is minor
+    // for 6 semitones, it forms a dim. fifth for sharp keys (including C major/a minor),
+    // otherwise for flat keys it forms a aug. fourth
+
+    static const char* const upper[7] = {"I", "II", "III", "IV", "V", "VI", "VII"};
+    static const char* const lower[7] = {"i", "ii", "iii", "iv", "v", "vi", "vii"};
+    static const char* const flat = "\xe2\x99\xad";
+    static const char* const sharp = "\xe2\x99\xaf";
+
+    const bool major = isMajor (key);
+    auto numeral = [capital] (int degree) { return capital ? upper[degree] : lower[degree]; };
+
+    switch (chromaticDegree)
+    {
+        case 0:
+            return {numeral (0), ""};
+        case 1:
+            return {numeral (1), flat};
+        case 2:
+            return {numeral (1), ""};
+        case 3:
+            return {numeral (2), major ? flat : ""};
+        case 4:
+            return {numeral (2), major ? "" : sharp};
+        case 5:
+            return {numeral (3), ""};
+        case 6:
+            if (key > 15)  // flat keys
+            {
+                return {numeral (3), sharp};
+            }
+            return {numeral (4), flat};  // sharp keys
+        case 7:
+            return {numeral (4), ""};
+        case 8:
+            return {numeral (5), major ? flat : ""};
+        case 9:
+            return {numeral (5), major ? "" : sharp};
+        case 10:
+            return {numeral (6), flat};
+        case 11:
+            return {numeral (6), ""};
+        default:
+            return {"", ""};
+    }
+}
+
+const char* ChordAnalysis::getKeyName (int key)
+{
+    return key >= 1 && key <= numKeys ? keyNames[key - 1] : "";
+}
+
+int ChordAnalysis::getKeyFromName (const std::string& name)
+{
+    auto start = name.find_first_not_of (" \t");
+    if (start == std::string::npos)
+    {
+        return 0;
+    }
+    auto letter = name[start];
+    auto upper = static_cast<char>(std::toupper (static_cast<unsigned char>(letter)));
+    if (upper < 'A' || upper > 'G')
+    {
+        return 0;
+    }
+
+    size_t i = start + 1;
+    std::string accidental;
+    if (name.compare (i, 3, "\xe2\x99\xad") == 0 || name.compare (i, 3, "\xe2\x99\xaf") == 0)
+    {
+        accidental = name.substr (i, 3);
+        i += 3;
+    } else if (i < name.size() && (name[i] == 'b' || name[i] == '#'))
+    {
+        accidental = name[i] == 'b' ? "\xe2\x99\xad" : "\xe2\x99\xaf";
+        ++i;
+    }
+
+    // the case of the letter gives the mode unless it is spelled out
+    bool major = letter == upper;
+    auto mode = name.substr (i);
+    if (mode.find ("minor") != std::string::npos)
+    {
+        major = false;
+    } else if (mode.find ("major") != std::string::npos)
+    {
+        major = true;
+    } else if (mode.find_first_not_of (" \t") != std::string::npos)
+    {
+        return 0;
+    }
+
+    auto spelled = std::string (1, major ? upper : static_cast<char>(std::tolower (static_cast<unsigned char>(upper))))
+                       + accidental + (major ? " major" : " minor");
+    for (int k = 1; k <= numKeys; ++k)
+    {
+        if (spelled == keyNames[k - 1])
+        {
+            return k;
+        }
+    }
+    return 0;
+}
+
+int ChordAnalysis::getFifths (int key)
+{
+    // keys come in major/minor pairs, sharp keys first
+    int pair = (key - 1) / 2;
+    return pair <= 7 ? pair : 7 - pair;
+}
+
+int ChordAnalysis::getKeyFromFifths (int fifths, bool major)
+{
+    if (fifths < -7 || fifths > 7)
+    {
+        return 0;
+    }
+    int pair = fifths >= 0 ? fifths : 7 - fifths;
+    return pair * 2 + (major ? 1 : 2);
+}
+
+uint16_t ChordAnalysis::pack (const ChordResult& result)
+{
+    if (! result.valid)
+    {
+        return 0;
+    }
+    // bit 0: valid, 1-5: chord, 6-9: degree, 10: capital, 11-13: figures, 14-15: quality
+    return static_cast<uint16_t>(1
+                                 | static_cast<int>(result.chord) << 1
+                                 | result.chromaticDegree << 6
+                                 | (result.capital ? 1 : 0) << 10
+                                 | indexOf (allFigures, result.figures) << 11
+                                 | indexOf (allQualities, result.quality) << 14);
+}
+
+ChordResult ChordAnalysis::unpack (uint16_t packed)
+{
+    ChordResult result;
+    if ((packed & 1) == 0)
+    {
+        return result;
+    }
+    result.valid = true;
+    result.chord = static_cast<Chord>((packed >> 1) & 0x1f);
+    result.chromaticDegree = (packed >> 6) & 0xf;
+    result.capital = (packed >> 10) & 1;
+    result.figures = allFigures[(packed >> 11) & 0x7];
+    result.quality = allQualities[(packed >> 14) & 0x3];
+    return result;
+}
+
+ChordResult ChordAnalysis::fromSymbolId (int symbolId)
+{
+    ChordResult result;
+    if (symbolId < 0 || symbolId >= numSymbols)
+    {
+        return result;
+    }
+    auto& info = chordInfo[symbolId % numChordTypes];
+    result.valid = true;
+    result.chord = static_cast<Chord>(symbolId % numChordTypes);
+    result.chromaticDegree = symbolId / numChordTypes;
+    result.capital = info.capital;
+    result.figures = result.chord == Chord::DimSeventh ? "7" : info.figures;
+    result.quality = info.quality;
+    return result;
+}
+
+int ChordAnalysis::getInversion (const ChordResult& result)
+{
+    if (! result.valid)
+    {
+        return -1;
+    }
+    // indexed like allFigures
+    static const int inversions[7] = {0, 1, 2, 0, 1, 2, 3};
+    return inversions[indexOf (allFigures, result.figures)];
+}
+
+ChordAnalysis::ToneFunction ChordAnalysis::getToneFunction (const ChordResult& result, int key, int pitchClass)
+{
+    if (! result.valid || key < 1 || key > numKeys)
+    {
+        return ToneFunction::none;
+    }
+
+    auto& tones = chordTones[static_cast<int>(result.chord)];
+    int interval = ((pitchClass - getTonic (key) - result.chromaticDegree) % 12 + 12) % 12;
+    if (interval == 0)
+    {
+        return ToneFunction::root;
+    }
+    if (interval == tones.third)
+    {
+        return ToneFunction::third;
+    }
+    if (interval == tones.fifth)
+    {
+        return ToneFunction::fifth;
+    }
+    if (interval == tones.seventh)
+    {
+        return ToneFunction::seventh;
+    }
+    return ToneFunction::nonChord;
+}
+
+std::string ChordAnalysis::getNumeralText (const ChordResult& result, int key)
+{
+    if (! result.valid)
+    {
+        return {};
+    }
+    auto spelling = spell (result.chromaticDegree, result.capital, key);
+    return std::string (spelling.accidental) + spelling.numeral + result.quality;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ChordAnalysis holds the identification logic without any UI, so that it can be shared by
+// ChordComponent and anything else that needs to turn a set of notes into a roman numeral
+
+//==============================================================================
+
+//-----Chord Names-----
+enum class Chord : char
+{
+//-----Triads-----
+    MajTriadRoot,
+    MajTriadFirst,
+    MajTriadSecond,
+    MinTriadRoot,
+    MinTriadFirst,
+    AugTriadRoot,
+    DimTriadRoot,
+    DimTriadFirst,
+//------------------
+    SeventhRoot,
+    SeventhFirst,
+    SeventhSecond,
+    SeventhThird,
+    DimSeventh,
+    HalfDimSeventhRoot,
+    HalfDimSeventhFirst,
+    HalfDimSeventhSecond,
+    HalfDimSeventhThird,
+    MinSeventhRoot,
+    MinSeventhFirst,
+    MinSeventhSecond,
+    MinSeventhThird
+};
+
+// taken from https://stackoverflow.com/questions/20511347/a-good-hash-function-for-a-vector
+struct VectorHasher {
+    std::size_t operator() (const std::vector<int> &v) const
+    {
+        std::size_t seed = v.size();
+        for (auto& i : v)
+        {
+            seed ^= i + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+};
+
+//==============================================================================
+// result of identifying a chord in the context of a key
+struct ChordResult
+{
+    bool valid = false;
+
+    Chord chord = Chord::MajTriadRoot;
+
+    // distance of the root from the tonic in semitones (0-11)
+    int chromaticDegree = 0;
+
+    // capital roman numerals are used for chords with a major third
+    bool capital = false;
+
+    // figured bass, with each number on its own line ("" for root position triads)
+    const char* figures = "";
+
+    // "o", "+" or the half diminished sign in UTF-8 ("" for everything else)
+    const char* quality = "";
+
+    // id unique to the numeral, quality and inversion, -1 if the chord was not identified
+    int getSymbolId() const;
+
+    // id unique to the numeral only (degree and case), -1 if the chord was not identified
+    int getNumeralId() const;
+};
+
+//==============================================================================
+namespace ChordAnalysis
+{
+    const int numChordTypes = 21;
+    const int numSymbols = 12 * numChordTypes;
+    const int numNumerals = 24;
+    const int numKeys = 30;
+
+    // returns the pitch class of the tonic for key numbers 1-30
+    int getTonic (int key);
+
+    // odd key numbers are major, even are minor
+    bool isMajor (int key);
+
+    // bit i is set if the interval of i semitones above the bass is in the chord
+    // notes must be sorted in ascending order
+    uint16_t getIntervalMask (const std::vector<int>& notes);
+
+    // the Chord an interval mask forms (as an int), -1 if it isn't one of them
+    int getChordType (uint16_t intervalMask);
+
+    // identifies the chord formed by notes (sorted in ascending order) in the given key
+    ChordResult identify (const std::vector<int>& notes, int key);
+
+    // identifies a chord from its interval mask and bass note
+    ChordResult identify (uint16_t intervalMask, int bassNote, int key);
+
+    // results of identify() in every key at once (key 1 at index 0), read from a table of all
+    // chords in all keys instead of identifying the chord 30 times
+    std::array<ChordResult, numKeys> identifyInAllKeys (uint16_t intervalMask, int bassNote);
+
+    std::array<ChordResult, numKeys> identifyInAllKeys (const std::vector<int>& notes);
+
+    // true if every chord tone is in the scale of the key (harmonic minor for minor keys)
+    bool isDiatonic (const ChordResult& result, int key);
+
+    // a chord that a partial set of notes could become
+    struct Prediction
+    {
+        ChordResult result;
+        // pitch classes still to be played, bit i for pitch class i
+        uint16_t missing = 0;
+    };
+
+    // chords containing every pitch class of notes (sorted in ascending order, with at least two
+    // pitch classes), over the same bass, that aren't complete yet, most likely first: chords
+    // diatonic to the key, then the ones missing fewest notes, then the most common degrees
+    std::vector<Prediction> predict (const std::vector<int>& notes, int key, size_t maxPredictions);
+
+    // the key itself, its relative, and the keys a fifth above and below with their relatives
+    // (the closely related keys a modulation usually goes to)
+    std::vector<int> getRelatedKeys (int key);
+
+    // roman numeral and the accidental drawn to the left of it
+    struct Spelling
+    {
+        const char* numeral;
+        const char* accidental;
+    };
+
+    Spelling spell (int chromaticDegree, bool capital, int key);
+
+    // 0 for root position, 1-3 for first to third inversion (from the figures, so a cadential 6-4
+    // is a second inversion), -1 if result is not valid
+    int getInversion (const ChordResult& result);
+
+    // role of a pitch class in an identified chord
+    enum class ToneFunction : uint8_t
+    {
+        none,
+        root,
+        third,
+        fifth,
+        seventh,
+        nonChord
+    };
+
+    // none if result is not valid, nonChord if the pitch class isn't one of its chord tones
+    // a cadential 6-4 is treated as a V chord, so its sixth and fourth are non-chord tones
+    ToneFunction getToneFunction (const ChordResult& result, int key, int pitchClass);
+
+    // accidental, numeral and quality as one UTF-8 string, e.g. "viio" (without the figures)
+    std::string getNumeralText (const ChordResult& result, int key);
+
+    // a pivot chord read in the key and in every related key it is diatonic in,
+    // e.g. "vi in C = ii in G = iii in F", empty if it isn't diatonic in the key
+    std::string getPivotText (const std::array<ChordResult, numKeys>& results, int key);
+
+    // name of key numbers 1-30 in UTF-8, e.g. "C major" or "a minor"
+    // keys from 1-16 are sharp, 17-30 are flat
+    const char* getKeyName (int key);
+
+    // key number from a name like "E♭ major", "Eb major", "c# minor" or "Eb" (upper case for
+    // major and lower case for minor when the mode is left out), 0 if it isn't one
+    int getKeyFromName (const std::string& name);
+
+    // number of sharps (positive) or flats (negative) in the key signature
+    int getFifths (int key);
+
+    // key number from a key signature, the inverse of getFifths()
+    int getKeyFromFifths (int fifths, bool major);
+
+    // packs a result into 16 bits so it can be published through a single atomic
+    uint16_t pack (const ChordResult& result);
+
+    ChordResult unpack (uint16_t packed);
+
+    // the result a symbol id was taken from, invalid if it isn't one (0 to numSymbols - 1)
+    // the inversions of the diminished seventh share an id, which comes back in root position
+    ChordResult fromSymbolId (int symbolId);
+}
@@ -13,6 +13,9 @@ ChordComponent::ChordComponent()
     getLookAndFeel().setColour (juce::TextEditor::outlineColourId, juce::Colours::transparentBlack);
     
     setFonts();
+
+    // a held chord can come back in an inversion that has no chord type of its own
+    jassert (SecondaryFunctionAnalyzer::checkReinversions());
     
     // set up middle box to display scale degree in roman numerals
     initBox (&romanNumeralBox);
@@ -61,6 +64,7 @@ ChordComponent::~ChordComponent() {}
 
 void ChordComponent::resized()
 {
+    TRACE_SCOPE ("ChordComponent::resized");
     // This method is where you should set the bounds of any child
     // components that your component contains..
     
@@ -103,21 +107,102 @@ void ChordComponent::setKey (int k)
 {
     clearAll();
     key = k;
+    identifiedChord.clear();
+    progressionState = {};
+    secondaryFunctions.setKey (k);
+}
+
+const std::vector<int>& ChordComponent::getNotes() const
+{
+    return chord;
+}
+
+const ChordResult& ChordComponent::getResult() const
+{
+    return result;
+}
+
+int ChordComponent::getProgression() const
+{
+    return progressionState.match;
+}
+
+void ChordComponent::setPredicting (bool shouldPredict)
+{
+    predicting = shouldPredict;
+    // redraw without feeding the progression matcher again
+    if (! result.valid)
+    {
+        clearAll();
+        predict();
+    }
+}
+
+bool ChordComponent::isPredicting() const
+{
+    return predicting;
+}
+
+const ChordResult& ChordComponent::getPrediction() const
+{
+    return prediction;
+}
+
+void ChordComponent::applyNotes (const std::vector<NoteEvent>& events)
+{
+    for (auto& event : events)
+    {
+        if (event.on)
+        {
+            chord.insert (std::upper_bound (chord.begin(), chord.end(), event.note), event.note);
+        } else
+        {
+            auto range = std::equal_range (chord.begin(), chord.end(), event.note);
+            chord.erase (range.first, range.second);
+        }
+    }
+    if (chord != identifiedChord)
+    {
+        constructIntervals();
+    }
+}
+
+void ChordComponent::setNotes (const std::vector<int>& notes)
+{
+    chord = notes;
+    if (chord != identifiedChord)
+    {
+        constructIntervals();
+    }
+}
+
+void ChordComponent::loadProgressions (const juce::File& file)
+{
+    auto lines = file.loadFileAsString().toStdString();
+    majorProgressions.addPatterns (lines, true);
+    minorProgressions.addPatterns (lines, false);
+    majorProgressions.compile();
+    minorProgressions.compile();
 }
 
-void ChordComponent::addNote (int note)
+juce::File ChordComponent::getUserProgressionsFile()
 {
-    chord.emplace_back (note);
-    std::sort (chord.begin(), chord.end());
-    constructIntervals();
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+               .getChildFile ("Chord Identifier")
+               .getChildFile ("progressions.txt");
 }
 
-void ChordComponent::removeNote (int note)
+void ChordComponent::fillKeyList (juce::ComboBox& list)
 {
-    // removes note in a way that retains order
-    auto range = std::equal_range (chord.begin(), chord.end(), note);
-    chord.erase (range.first, range.second);
-    constructIntervals();
+    for (int k = 1; k <= ChordAnalysis::numKeys; ++k)
+    {
+        list.addItem (juce::String (juce::CharPointer_UTF8 (ChordAnalysis::getKeyName (k))), k);
+        // separate sharp and flat keys
+        if (k == 16)
+        {
+            list.addSeparator();
+        }
+    }
 }
 
 //===============================================================================
@@ -146,7 +231,8 @@ void ChordComponent::setFonts()
 
 void ChordComponent::clearAll()
 {
-    intervals.clear();
+    result = {};
+    prediction = {};
     numIntervals = 2;
     
     romanNumeralBox.setText (" ");
@@ -161,317 +247,108 @@ void ChordComponent::clearAll()
 
 void ChordComponent::constructIntervals()
 {
-    // clear all intervals and boxes to erase any previous chord data
+    TRACE_SCOPE ("constructIntervals");
+    // clear all boxes to erase any previous chord data
     clearAll();
+    identifiedChord = chord;
 
-    // return if chord has less than 3 notes
+    // return if chord has less than 3 notes, showing what it could become
     if (chord.size() < 3)
     {
+        predict();
+        return;
+    }
+    identify();
+    analyzeFunction();
+}
+
+void ChordComponent::identify()
+{
+    TRACE_SCOPE ("identify");
+    // return if we cannot find the chord, it might be one still being played
+    result = ChordAnalysis::identify (chord, key);
+    if (! result.valid)
+    {
+        predict();
         return;
     }
     
-    for (int bassNote = chord[0], i = 1; i < chord.size(); ++i)
+    drawChord (result, false);
+    
+    auto& progressions = ChordAnalysis::isMajor (key) ? majorProgressions : minorProgressions;
+    if (progressions.feed (progressionState, result) && onProgression != nullptr)
     {
-        int interval = (chord[i] - bassNote) % 12;
-        // add unique intervals to vector, excluding the unison (which forms an interval of 0)
-        if (interval != 0 && std::find (intervals.begin(), intervals.end(), interval) == intervals.end())
-        {
-            intervals.emplace_back (interval);
-        }
+        auto name = progressionState.match >= 0 ? progressions.getPattern (progressionState.match).name : std::string();
+        onProgression (juce::String::fromUTF8 (name.c_str()));
     }
-    std::sort (intervals.begin(), intervals.end());
-    identify();
 }
 
-void ChordComponent::identify()
+void ChordComponent::predict()
 {
-    // return if chord has less than 2 unique intervals, or if we cannot find the chord
-    if (intervals.size() < 2)
+    if (! predicting)
     {
         return;
     }
-    auto it = chordDb.find (intervals);
-    if (it == chordDb.end())
+    auto predictions = ChordAnalysis::predict (chord, key, 1);
+    if (! predictions.empty())
+    {
+        prediction = predictions.front().result;
+        drawChord (prediction, true);
+    }
+}
+
+void ChordComponent::analyzeFunction()
+{
+    secondaryLabels.clear();
+    secondaryFunctions.add (chord, secondaryLabels);
+    if (secondaryLabels.empty() || onSecondaryFunction == nullptr)
     {
         return;
     }
+    // the last applied chord decided, the others have already been followed by their resolution
+    // one that went elsewhere is only a guess at what it tonicizes, so it isn't shown
+    std::string text;
+    for (auto& label : secondaryLabels)
+    {
+        if (label.applied && label.resolved)
+        {
+            text = SecondaryFunctionAnalyzer::getText (label, key);
+        }
+    }
+    onSecondaryFunction (juce::String::fromUTF8 (text.c_str()));
+}
+
+void ChordComponent::drawChord (const ChordResult& chordResult, bool ghosted)
+{
+    // setting the text lays the boxes out again through onTextChange
+    TRACE_SCOPE ("drawChord");
+    drawRomanNum (chordResult.chromaticDegree, chordResult.capital);
+    if (*chordResult.figures != 0)
+    {
+        intervalBox.setText (chordResult.figures);
+    }
+    if (*chordResult.quality != 0)
+    {
+        diminishedBox.setText (juce::CharPointer_UTF8 (chordResult.quality));
+    }
     
-    int chromaticDegree = chord[0] + 12 - keyToScaleDegree[key - 1];
-    switch (it->second)
+    auto colour = getLookAndFeel().findColour (juce::TextEditor::textColourId);
+    if (ghosted)
     {
-        case Chord::MajTriadRoot:
-            drawRomanNum (chromaticDegree % 12, true);
-            break;
-        case Chord::MajTriadFirst:
-            drawRomanNum ((chromaticDegree + 8) % 12, true);
-            intervalBox.setText ("6");
-            break;
-        case Chord::MajTriadSecond:
-            if ((chromaticDegree + 5) % 12 == 0)
-            {
-                // cadential 6-4 is a V chord
-                drawRomanNum (7, true);
-            }
-            else
-            {
-                drawRomanNum ((chromaticDegree + 5) % 12, true);
-            }
-            intervalBox.setText ("6\n4");
-            break;
-        case Chord::MinTriadRoot:
-            drawRomanNum (chromaticDegree % 12, false);
-            break;
-        case Chord::MinTriadFirst:
-            drawRomanNum ((chromaticDegree + 9) % 12, false);
-            intervalBox.setText ("6");
-            break;
-        case Chord::AugTriadRoot:
-            drawRomanNum (chromaticDegree % 12, true);
-            diminishedBox.setText ("+");
-            break;
-        case Chord::DimTriadRoot:
-            drawRomanNum (chromaticDegree % 12, false);
-            diminishedBox.setText ("o");
-            break;
-        case Chord::DimTriadFirst:
-            drawRomanNum ((chromaticDegree + 9) % 12, false);
-            intervalBox.setText ("6");
-            diminishedBox.setText ("o");
-            break;
-        case Chord::SeventhRoot:
-            drawRomanNum (chromaticDegree % 12, true);
-            intervalBox.setText ("7");
-            break;
-        case Chord::SeventhFirst:
-            drawRomanNum ((chromaticDegree + 8) % 12, true);
-            intervalBox.setText ("6\n5");
-            break;
-        case Chord::SeventhSecond:
-            drawRomanNum ((chromaticDegree + 5) % 12, true);
-            intervalBox.setText ("4\n3");
-            break;
-        case Chord::SeventhThird:
-            drawRomanNum ((chromaticDegree + 2) % 12, true);
-            intervalBox.setText ("4\n2");
-            break;
-        case Chord::DimSeventh:
-            switch (chromaticDegree % 12)
-            {
-                case 11:
-                    intervalBox.setText ("7");
-                    break;
-                case 2:
-                    intervalBox.setText ("6\n5");
-                    break;
-                case 5:
-                    intervalBox.setText ("4\n3");
-                    break;
-                case 8:
-                    intervalBox.setText ("4\n2");
-                    break;
-                default:
-                    return;
-            }
-            drawRomanNum (11, false);
-            diminishedBox.setText ("o");
-            break;
-        case Chord::HalfDimSeventhRoot:
-            drawRomanNum (chromaticDegree % 12, false);
-            intervalBox.setText ("7");
-            diminishedBox.setText (juce::CharPointer_UTF8 ("\xc3\xb8"));
-            break;
-        case Chord::HalfDimSeventhFirst:
-            drawRomanNum ((chromaticDegree + 9) % 12, false);
-            intervalBox.setText ("6\n5");
-            diminishedBox.setText (juce::CharPointer_UTF8 ("\xc3\xb8"));
-            break;
-        case Chord::HalfDimSeventhSecond:
-            drawRomanNum ((chromaticDegree + 6) % 12, false);
-            intervalBox.setText ("4\n3");
-            diminishedBox.setText (juce::CharPointer_UTF8 ("\xc3\xb8"));
-            break;
-        case Chord::HalfDimSeventhThird:
-            drawRomanNum ((chromaticDegree + 2) % 12, false);
-            intervalBox.setText ("4\n2");
-            diminishedBox.setText (juce::CharPointer_UTF8 ("\xc3\xb8"));
-            break;
-        case Chord::MinSeventhRoot:
-            drawRomanNum (chromaticDegree % 12, false);
-            intervalBox.setText ("7");
-            break;
-        case Chord::MinSeventhFirst:
-            drawRomanNum ((chromaticDegree + 9) % 12, false);
-            intervalBox.setText ("6\n5");
-            break;
-        case Chord::MinSeventhSecond:
-            drawRomanNum ((chromaticDegree + 5) % 12, false);
-            intervalBox.setText ("4\n3");
-            break;
-        case Chord::MinSeventhThird:
-            drawRomanNum ((chromaticDegree + 2) % 12, false);
-            intervalBox.setText ("4\n2");
-            break;
-        default:
-            // should not be run
-            std::cerr << "Hash error";
-            exit(0);
-            break;
+        colour = colour.withAlpha (0.35f);
+    }
+    for (auto box : { &romanNumeralBox, &intervalBox, &accidentalBox, &diminishedBox })
+    {
+        box->applyColourToAllText (colour);
     }
 }
 
 void ChordComponent::drawRomanNum (const int chromaticDegree, const bool capital)
 {
-    // draws a capital roman numeral depending on chord having major or minor third
-    // for 3, 8 semitones (minor third and sixth), draw a flat if key is major
-    // for 4, 9 semitones (major third and sixth), draw a sharp if key is minor
-    // for 6 semitones, it forms a dim. fifth for sharp keys (including C major/a minor),
-    // otherwise for flat keys it forms a aug. fourth
-    
-    const bool major = key % 2;
-    
-    switch (chromaticDegree)
+    auto spelling = ChordAnalysis::spell (chromaticDegree, capital, key);
+    romanNumeralBox.setText (spelling.numeral);
+    if (*spelling.accidental != 0)
     {
-        case 0:
-            if (capital)
-            {
-                romanNumeralBox.setText ("I");
-            } else
-            {
-                romanNumeralBox.setText ("i");
-            }
-            break;
-        case 1:
-            if (capital)
-            {
-                romanNumeralBox.setText ("II");
-            } else
-            {
-                romanNumeralBox.setText ("ii");
-            }
-            accidentalBox.setText (juce::CharPointer_UTF8 ("\xe2\x99\xad"));
-            break;
-        case 2:
-            if (capital)
-            {
-                romanNumeralBox.setText ("II");
-            } else
-            {
-                romanNumeralBox.setText ("ii");
-            }
-            break;
-        case 3:
-            if (capital)
-            {
-                romanNumeralBox.setText ("III");
-            } else
-            {
-                romanNumeralBox.setText ("iii");
-            }
-            if (major)
-            {
-                accidentalBox.setText (juce::CharPointer_UTF8 ("\xe2\x99\xad"));
-                
-            }
-            break;
-        case 4:
-            if (capital)
-            {
-                romanNumeralBox.setText ("III");
-            } else
-            {
-                romanNumeralBox.setText ("iii");
-            }
-            if (!major)
-            {
-                accidentalBox.setText (juce::CharPointer_UTF8 ("\xe2\x99\xaf"));
-            }
-            break;
-        case 5:
-            if (capital)
-            {
-                romanNumeralBox.setText ("IV");
-            } else
-            {
-                romanNumeralBox.setText ("iv");
-            }
-            break;
-        case 6:
-            if (key > 15)  // flat keys
-            {
-                if (capital)
-                {
-                    romanNumeralBox.setText ("IV");
-                } else
-                {
-                    romanNumeralBox.setText ("iv");
-                }
-                accidentalBox.setText (juce::CharPointer_UTF8 ("\xe2\x99\xaf"));
-            } else  // sharp keys
-            {
-                if (capital)
-                {
-                    romanNumeralBox.setText ("V");
-                } else
-                {
-                    romanNumeralBox.setText ("v");
-                }
-                accidentalBox.setText (juce::CharPointer_UTF8 ("\xe2\x99\xad"));
-            }
-            break;
-        case 7:
-            if (capital)
-            {
-                romanNumeralBox.setText ("V");
-            } else
-            {
-                romanNumeralBox.setText ("v");
-            }
-            break;
-        case 8:
-            if (capital)
-            {
-                romanNumeralBox.setText ("VI");
-            } else
-            {
-                romanNumeralBox.setText ("vi");
-            }
-            if (major)
-            {
-                accidentalBox.setText (juce::CharPointer_UTF8 ("\xe2\x99\xad"));
-                
-            }
-            break;
-        case 9:
-            if (capital)
-            {
-                romanNumeralBox.setText ("VI");
-            } else
-            {
-                romanNumeralBox.setText ("vi");
-            }
-            if (!major)
-            {
-                accidentalBox.setText (juce::CharPointer_UTF8 ("\xe2\x99\xaf"));
-            }
-            break;
-        case 10:
-            if (capital)
-            {
-                romanNumeralBox.setText ("VII");
-            } else
-            {
-                romanNumeralBox.setText ("vii");
-            }
-            accidentalBox.setText (juce::CharPointer_UTF8 ("\xe2\x99\xad"));
-            break;
-        case 11:
-            if (capital)
-            {
-                romanNumeralBox.setText ("VII");
-            } else
-            {
-                romanNumeralBox.setText ("vii");
-            }
-            break;
+        accidentalBox.setText (juce::CharPointer_UTF8 (spelling.accidental));
     }
 }
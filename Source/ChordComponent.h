@@ -2,8 +2,13 @@
 
 #include <JuceHeader.h>
 #include <algorithm>
-#include <unordered_map>
+#include <functional>
 #include <vector>
+#include "ChordAnalysis.h"
+#include "OnsetGrouper.h"
+#include "ProgressionMatcher.h"
+#include "SecondaryFunctionAnalyzer.h"
+#include "Trace.h"
 
 // multiline TextEditor doesn't support getTextWidth(), so we need INTERVAL_WIDTH_TO_HEIGHT_RATIO
 // as an estimate for the interval width
@@ -15,49 +20,6 @@
 // font size and TextEditor height has a difference of 5
 #define FONT_SIZE_AND_HEIGHT_DIFF 5
 
-//==============================================================================
-
-//-----Chord Names-----
-enum class Chord : char
-{
-//-----Triads-----
-    MajTriadRoot,
-    MajTriadFirst,
-    MajTriadSecond,
-    MinTriadRoot,
-    MinTriadFirst,
-    AugTriadRoot,
-    DimTriadRoot,
-    DimTriadFirst,
-//------------------
-    SeventhRoot,
-    SeventhFirst,
-    SeventhSecond,
-    SeventhThird,
-    DimSeventh,
-    HalfDimSeventhRoot,
-    HalfDimSeventhFirst,
-    HalfDimSeventhSecond,
-    HalfDimSeventhThird,
-    MinSeventhRoot,
-    MinSeventhFirst,
-    MinSeventhSecond,
-    MinSeventhThird
-};
-
-// taken from https://stackoverflow.com/questions/20511347/a-good-hash-function-for-a-vector
-struct VectorHasher {
-    std::size_t operator() (const std::vector<int> &v) const
-    {
-        std::size_t seed = v.size();
-        for (auto& i : v)
-        {
-            seed ^= i + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-        }
-        return seed;
-    }
-};
-
 //==============================================================================
 class ChordComponent : public juce::Component
 {
@@ -71,9 +33,48 @@ public:
     
     void setKey (int k);
     
-    void addNote (int note);
+    // notes currently held, in ascending order
+    const std::vector<int>& getNotes() const;
+    
+    // result of the last identification (not valid if nothing is displayed)
+    const ChordResult& getResult() const;
+    
+    // index of the pattern completed by the last chord in the matcher for the key, -1 if none
+    int getProgression() const;
+    
+    // while predicting, notes that aren't a chord yet show the most likely chord they could
+    // become, ghosted, until it is complete
+    void setPredicting (bool shouldPredict);
+    
+    bool isPredicting() const;
+    
+    // chord shown ghosted (not valid if there is none)
+    const ChordResult& getPrediction() const;
+    
+    // applies a group of note ons and offs, then identifies the result once
+    void applyNotes (const std::vector<NoteEvent>& events);
     
-    void removeNote (int note);
+    // replaces the notes (in ascending order), e.g. with the ones an ArpeggioAccumulator heard,
+    // and identifies them if they changed
+    void setNotes (const std::vector<int>& notes);
+    
+    // loads user defined progression patterns, one per line in the form "name: ii V I"
+    // patterns are added to both the major and minor defaults
+    void loadProgressions (const juce::File& file);
+    
+    // progressions.txt in the app data folder
+    static juce::File getUserProgressionsFile();
+    
+    // adds all 30 keys to a ComboBox, with item ids matching the key numbers used by setKey()
+    static void fillKeyList (juce::ComboBox& list);
+    
+    // called with the name of the cadence or progression the last chord completed,
+    // or an empty string when the chord didn't complete one
+    std::function<void (const juce::String&)> onProgression;
+    
+    // called with the label of an applied chord (e.g. "V⁶⁵/V") once it has resolved, so while
+    // the chord it tonicizes sounds, or an empty string when a chord that isn't one is decided
+    std::function<void (const juce::String&)> onSecondaryFunction;
 
 private:
     void initBox (juce::TextEditor* box);
@@ -86,6 +87,15 @@ private:
     
     void identify();
     
+    // shows the most likely chord the notes could become, if predicting
+    void predict();
+    
+    // passes the chord to the secondary function analyzer and reports what it decides
+    void analyzeFunction();
+    
+    // fills the boxes, ghosted for a prediction
+    void drawChord (const ChordResult& chordResult, bool ghosted);
+    
     void drawRomanNum (const int scaleDegree, const bool capital);
     
     //=======================================
@@ -98,9 +108,6 @@ private:
     // default is 0 (no key is set)
     int key = 0;
     
-    // array used to convert key number to a scale degree that is easier to work with
-    const int keyToScaleDegree[30] = {0, 9, 7, 4, 2, 11, 9, 6, 4, 1, 11, 8, 6, 3, 1, 10, 5, 2, 10, 7, 3, 0, 8, 5, 1, 10, 6, 3, 11, 8};
-    
     // font size of the roman numeral
     // default is 135.0 for a window of 600x400
     float chordFontSize = 135.0;
@@ -112,34 +119,23 @@ private:
     // chord vector stores midi note numbers in order
     std::vector<int> chord;
     
-    // intervals vector stores unique intervals in semitones, also in order
-    std::vector<int> intervals;
-    
-    //-----------------------------Chord Database-----------------------------
-    const std::unordered_map<std::vector<int>, Chord, VectorHasher> chordDb =
-    {
-        {std::vector<int> {4, 7}, Chord::MajTriadRoot},
-        {std::vector<int> {3, 8}, Chord::MajTriadFirst},
-        {std::vector<int> {5, 9}, Chord::MajTriadSecond},
-        {std::vector<int> {3, 7}, Chord::MinTriadRoot},
-        {std::vector<int> {4, 9}, Chord::MinTriadFirst},
-        {std::vector<int> {4, 8}, Chord::AugTriadRoot},
-        {std::vector<int> {3, 6}, Chord::DimTriadRoot},
-        {std::vector<int> {3, 9}, Chord::DimTriadFirst},
-        {std::vector<int> {4, 7, 10}, Chord::SeventhRoot},
-        {std::vector<int> {3, 6, 8}, Chord::SeventhFirst},
-        {std::vector<int> {3, 5, 9}, Chord::SeventhSecond},
-        {std::vector<int> {2, 6, 9}, Chord::SeventhThird},
-        {std::vector<int> {3, 6, 9}, Chord::DimSeventh},
-        {std::vector<int> {3, 6, 10}, Chord::HalfDimSeventhRoot},
-        {std::vector<int> {3, 7, 9}, Chord::HalfDimSeventhFirst},
-        {std::vector<int> {4, 6, 9}, Chord::HalfDimSeventhSecond},
-        {std::vector<int> {2, 5, 8}, Chord::HalfDimSeventhThird},
-        {std::vector<int> {3, 7, 10}, Chord::MinSeventhRoot},
-        {std::vector<int> {4, 7, 9}, Chord::MinSeventhFirst},
-        {std::vector<int> {3, 5, 8}, Chord::MinSeventhSecond},
-        {std::vector<int> {2, 5, 9}, Chord::MinSeventhThird}
-    };
+    // notes that were last identified, so a group of events that leaves the chord unchanged
+    // (e.g. a note pressed and released within the onset window) doesn't identify it again
+    std::vector<int> identifiedChord;
+    
+    ChordResult result;
+    
+    bool predicting = false;
+    ChordResult prediction;
+    
+    // cadences and progressions are matched separately for major and minor keys
+    ProgressionMatcher majorProgressions = ProgressionMatcher::createDefault (true);
+    ProgressionMatcher minorProgressions = ProgressionMatcher::createDefault (false);
+    ProgressionMatcher::State progressionState;
+    
+    // applied chords are only labelled once the next chord shows where they resolve
+    SecondaryFunctionAnalyzer secondaryFunctions;
+    std::vector<SecondaryFunctionAnalyzer::Label> secondaryLabels;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChordComponent)
 };
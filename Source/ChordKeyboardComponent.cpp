@@ -0,0 +1,94 @@
+#include "ChordKeyboardComponent.h"
+
+//==============================================================================
+ChordKeyboardComponent::ChordKeyboardComponent (juce::MidiKeyboardState& state)
+  : juce::MidiKeyboardComponent (state, juce::MidiKeyboardComponent::horizontalKeyboard)
+{
+}
+
+void ChordKeyboardComponent::setChord (const std::vector<int>& notes, const ChordResult& result, int key)
+{
+    std::array<ChordAnalysis::ToneFunction, 128> newFunctions {};
+    for (auto note : notes)
+    {
+        if (note >= 0 && note < 128)
+        {
+            newFunctions[static_cast<size_t>(note)] = ChordAnalysis::getToneFunction (result, key, note % 12);
+        }
+    }
+
+    for (int note = 0; note < 128; ++note)
+    {
+        if (newFunctions[static_cast<size_t>(note)] != functions[static_cast<size_t>(note)])
+        {
+            repaint (getRectangleForKey (note).getSmallestIntegerContainer());
+        }
+    }
+    functions = newFunctions;
+}
+
+void ChordKeyboardComponent::paint (juce::Graphics& g)
+{
+    TRACE_SCOPE ("ChordKeyboardComponent::paint");
+    juce::MidiKeyboardComponent::paint (g);
+}
+
+juce::Colour ChordKeyboardComponent::getFunctionColour (ChordAnalysis::ToneFunction function)
+{
+    switch (function)
+    {
+        case ChordAnalysis::ToneFunction::root:
+            return juce::Colours::indianred;
+        case ChordAnalysis::ToneFunction::third:
+            return juce::Colours::orange;
+        case ChordAnalysis::ToneFunction::fifth:
+            return juce::Colours::mediumseagreen;
+        case ChordAnalysis::ToneFunction::seventh:
+            return juce::Colours::mediumpurple;
+        case ChordAnalysis::ToneFunction::nonChord:
+            return juce::Colours::darkgrey;
+        case ChordAnalysis::ToneFunction::none:
+        default:
+            return juce::Colours::transparentBlack;
+    }
+}
+
+void ChordKeyboardComponent::drawWhiteNote (int midiNoteNumber, juce::Graphics& g, juce::Rectangle<float> area,
+                                            bool isDown, bool isOver, juce::Colour lineColour, juce::Colour textColour)
+{
+    // every key is drawn on each paint, even for a small dirty region
+    if (! g.clipRegionIntersects (area.getSmallestIntegerContainer()))
+    {
+        return;
+    }
+
+    auto function = functions[static_cast<size_t>(midiNoteNumber)];
+    if (isDown && function != ChordAnalysis::ToneFunction::none)
+    {
+        // drawn under the separator lines and labels, instead of the key down overlay
+        g.setColour (getFunctionColour (function));
+        g.fillRect (area);
+        isDown = false;
+    }
+    juce::MidiKeyboardComponent::drawWhiteNote (midiNoteNumber, g, area, isDown, isOver, lineColour, textColour);
+}
+
+void ChordKeyboardComponent::drawBlackNote (int midiNoteNumber, juce::Graphics& g, juce::Rectangle<float> area,
+                                            bool isDown, bool isOver, juce::Colour noteFillColour)
+{
+    if (! g.clipRegionIntersects (area.getSmallestIntegerContainer()))
+    {
+        return;
+    }
+
+    auto function = functions[static_cast<size_t>(midiNoteNumber)];
+    if (isDown && function != ChordAnalysis::ToneFunction::none)
+    {
+        // black keys fill their whole area, so the colour goes on top with a thin border left
+        juce::MidiKeyboardComponent::drawBlackNote (midiNoteNumber, g, area, false, isOver, noteFillColour);
+        g.setColour (getFunctionColour (function));
+        g.fillRect (area.reduced (1.0f));
+        return;
+    }
+    juce::MidiKeyboardComponent::drawBlackNote (midiNoteNumber, g, area, isDown, isOver, noteFillColour);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+#include "ChordAnalysis.h"
+#include "Trace.h"
+
+//==============================================================================
+/*
+    MidiKeyboardComponent that colours the keys held down by their function in the identified
+    chord: root, third, fifth, seventh or non-chord tone.
+
+    Only the keys whose colour changes are repainted, and keys outside the region being
+    repainted are skipped, so the cost of an update doesn't grow with the width of the window.
+*/
+class ChordKeyboardComponent : public juce::MidiKeyboardComponent
+{
+public:
+    explicit ChordKeyboardComponent (juce::MidiKeyboardState& state);
+
+    // notes are the ones that were identified as result
+    void setChord (const std::vector<int>& notes, const ChordResult& result, int key);
+
+    static juce::Colour getFunctionColour (ChordAnalysis::ToneFunction function);
+
+    void paint (juce::Graphics& g) override;
+
+private:
+    void drawWhiteNote (int midiNoteNumber, juce::Graphics& g, juce::Rectangle<float> area,
+                        bool isDown, bool isOver, juce::Colour lineColour, juce::Colour textColour) override;
+
+    void drawBlackNote (int midiNoteNumber, juce::Graphics& g, juce::Rectangle<float> area,
+                        bool isDown, bool isOver, juce::Colour noteFillColour) override;
+
+    std::array<ChordAnalysis::ToneFunction, 128> functions {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChordKeyboardComponent)
+};
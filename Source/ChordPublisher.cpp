@@ -0,0 +1,178 @@
+#include "ChordPublisher.h"
+#include "chordid_shm.h"
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+    // copies at most size - 1 bytes and terminates the string
+    void copyText (char* destination, size_t size, const char* text, size_t& length)
+    {
+        for (; *text != 0 && length < size - 1; ++text)
+        {
+            destination[length++] = *text;
+        }
+        destination[length] = 0;
+    }
+
+    // the same seqlock as ChordPublisher, over everything in the slot before the name
+    void writeSharedSlot (chordid_shm_slot& slot, double time, const uint64_t (&notes)[2], const ChordResult& result, int key, int progression)
+    {
+        chordid_shm_slot copy {};
+        copy.time = time;
+        copy.notes[0] = notes[0];
+        copy.notes[1] = notes[1];
+        copy.valid = result.valid ? 1 : 0;
+        copy.key = static_cast<int8_t>(key);
+        copy.progression = static_cast<int16_t>(progression);
+        copy.packed = ChordAnalysis::pack (result);
+        copy.symbol_id = static_cast<int16_t>(result.getSymbolId());
+        copy.numeral_id = static_cast<int16_t>(result.getNumeralId());
+        if (result.valid && key >= 1 && key <= ChordAnalysis::numKeys)
+        {
+            copy.chromatic_degree = static_cast<int8_t>(result.chromaticDegree);
+            copy.capital = result.capital ? 1 : 0;
+            copy.chord = static_cast<int8_t>(result.chord);
+            copy.inversion = static_cast<int8_t>(ChordAnalysis::getInversion (result));
+
+            // written out here rather than with getNumeralText(), so publishing never allocates
+            auto spelling = ChordAnalysis::spell (result.chromaticDegree, result.capital, key);
+            size_t length = 0;
+            copyText (copy.numeral, sizeof (copy.numeral), spelling.accidental, length);
+            copyText (copy.numeral, sizeof (copy.numeral), spelling.numeral, length);
+            copyText (copy.numeral, sizeof (copy.numeral), result.quality, length);
+            length = 0;
+            for (auto figure = result.figures; *figure != 0; ++figure)
+            {
+                if (*figure != '\n' && length < sizeof (copy.figures) - 1)
+                {
+                    copy.figures[length++] = *figure;
+                }
+            }
+        }
+
+        // a lock free 64 bit atomic has the layout of the integer, so the sequence is used as one
+        auto& sequence = reinterpret_cast<std::atomic<uint64_t>&>(slot.sequence);
+        auto s = sequence.load (std::memory_order_relaxed);
+        sequence.store (s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+        const size_t start = offsetof (chordid_shm_slot, time);
+        std::memcpy (reinterpret_cast<char*>(&slot) + start, reinterpret_cast<const char*>(&copy) + start,
+                     offsetof (chordid_shm_slot, name) - start);
+        sequence.store (s + 2, std::memory_order_release);
+    }
+}
+
+void ChordPublisher::publish (double time, const uint64_t (&notes)[2], const ChordResult& result, int key, int progression)
+{
+    uint64_t timeBits;
+    std::memcpy (&timeBits, &time, sizeof (timeBits));
+
+    // there is only one writer, so nothing else changes the sequence in between
+    auto s = sequence.load (std::memory_order_relaxed);
+    sequence.store (s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    words[0].store (timeBits, std::memory_order_relaxed);
+    words[1].store (notes[0], std::memory_order_relaxed);
+    words[2].store (notes[1], std::memory_order_relaxed);
+    words[3].store (pack (result, key, progression), std::memory_order_relaxed);
+
+    sequence.store (s + 2, std::memory_order_release);
+
+    if (auto slot = sharedSlot.load (std::memory_order_acquire))
+    {
+        writeSharedSlot (*slot, time, notes, result, key, progression);
+    }
+}
+
+void ChordPublisher::publish (double time, const std::vector<int>& notes, const ChordResult& result, int key, int progression)
+{
+    uint64_t bits[2] = {0, 0};
+    for (auto note : notes)
+    {
+        if (note >= 0 && note < 128)
+        {
+            bits[note / 64] |= uint64_t (1) << (note % 64);
+        }
+    }
+    publish (time, bits, result, key, progression);
+}
+
+void ChordPublisher::setSharedSlot (chordid_shm_slot* slot)
+{
+    static_assert (sizeof (std::atomic<uint64_t>) == sizeof (uint64_t) && ATOMIC_LLONG_LOCK_FREE == 2,
+                   "the sequence of a shared slot is written as a std::atomic");
+    sharedSlot.store (slot, std::memory_order_release);
+}
+
+ChordPublisher::Snapshot ChordPublisher::read() const
+{
+    uint64_t copy[4];
+    uint64_t before;
+    for (;;)
+    {
+        before = sequence.load (std::memory_order_acquire);
+        if (before & 1)
+        {
+            // a write is in progress, it is only a few stores long
+            std::this_thread::yield();
+            continue;
+        }
+        for (int i = 0; i < 4; ++i)
+        {
+            copy[i] = words[i].load (std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (sequence.load (std::memory_order_relaxed) == before)
+        {
+            break;
+        }
+    }
+
+    Snapshot snapshot;
+    snapshot.version = before / 2;
+    std::memcpy (&snapshot.time, &copy[0], sizeof (snapshot.time));
+    snapshot.notes[0] = copy[1];
+    snapshot.notes[1] = copy[2];
+    snapshot.result = ChordAnalysis::unpack (static_cast<uint16_t>(copy[3] & 0xffff));
+    snapshot.key = static_cast<int>((copy[3] >> 16) & 0xff);
+    snapshot.progression = static_cast<int>((copy[3] >> 24) & 0xffffff) - 1;
+    return snapshot;
+}
+
+uint64_t ChordPublisher::getVersion() const
+{
+    return sequence.load (std::memory_order_acquire) / 2;
+}
+
+uint64_t ChordPublisher::waitForVersion (uint64_t after, int timeoutMs) const
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds (timeoutMs);
+    // spin briefly for readers that want low latency, then back off to sleeping
+    for (int attempt = 0;; ++attempt)
+    {
+        auto v = getVersion();
+        if (v > after || std::chrono::steady_clock::now() >= deadline)
+        {
+            return v;
+        }
+        if (attempt < 64)
+        {
+            std::this_thread::yield();
+        } else
+        {
+            std::this_thread::sleep_for (std::chrono::microseconds (500));
+        }
+    }
+}
+
+uint64_t ChordPublisher::pack (const ChordResult& result, int key, int progression)
+{
+    // result (bits 0-15), key (16-23) and progression + 1 (24-47)
+    return ChordAnalysis::pack (result)
+         | static_cast<uint64_t>(key & 0xff) << 16
+         | static_cast<uint64_t>((progression + 1) & 0xffffff) << 24;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "ChordAnalysis.h"
+
+struct chordid_shm_slot;
+
+//==============================================================================
+// Single slot through which the analysis publishes each result to any number of readers.
+//
+// The slot is a seqlock: the writer makes the sequence number odd, stores the snapshot and
+// makes it even again, and readers retry if the sequence changed while they were copying.
+// Publishing is a handful of atomic stores, so the writer never waits for readers and never
+// allocates, and readers never take a lock. A reader that falls behind only sees the latest
+// snapshot, but can count the ones it missed from the versions.
+//
+// Results can also be mirrored to shared memory for other processes, with the same scheme.
+class ChordPublisher
+{
+public:
+    // immutable copy of a published result
+    struct Snapshot
+    {
+        // 0 until the first publish, then incremented by one for every publish
+        uint64_t version = 0;
+        // seconds, on the clock of the note events
+        double time = 0.0;
+        // one bit per midi note number
+        uint64_t notes[2] = {0, 0};
+        ChordResult result;
+        int key = 0;
+        // pattern completed by the chord, -1 if none
+        int progression = -1;
+    };
+
+    //-----Writer side, one thread only-----
+    void publish (double time, const uint64_t (&notes)[2], const ChordResult& result, int key, int progression);
+
+    // notes as midi note numbers
+    void publish (double time, const std::vector<int>& notes, const ChordResult& result, int key, int progression);
+
+    // also publishes every result to a slot of a shared memory segment (see chordid_shm.h)
+    // from the next publish, nullptr stops, the slot must stay mapped until publishing has stopped
+    void setSharedSlot (chordid_shm_slot* slot);
+
+    //-----Reader side, any thread-----
+    Snapshot read() const;
+
+    uint64_t getVersion() const;
+
+    // waits until a version newer than after is published, or until timeoutMs has passed,
+    // by polling, so the writer never has anything to signal
+    // returns the latest version
+    uint64_t waitForVersion (uint64_t after, int timeoutMs) const;
+
+private:
+    // result, key and progression in one word
+    static uint64_t pack (const ChordResult& result, int key, int progression);
+
+    // even when the slot is stable, version is sequence / 2
+    std::atomic<uint64_t> sequence { 0 };
+
+    // time, notes and packed result, stored as separate atomic words so that a reader
+    // copying them during a write is a detected retry rather than a data race
+    std::atomic<uint64_t> words[4] {};
+
+    std::atomic<chordid_shm_slot*> sharedSlot { nullptr };
+};
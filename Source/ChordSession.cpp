@@ -0,0 +1,132 @@
+#include "ChordSession.h"
+
+ChordSession::ChordSession (const ProgressionMatcher& majorMatcher, const ProgressionMatcher& minorMatcher)
+  : majorProgressions (majorMatcher), minorProgressions (minorMatcher)
+{
+}
+
+void ChordSession::setKey (int k)
+{
+    key.store (k);
+    pending.store (true);
+}
+
+int ChordSession::getKey() const
+{
+    return key.load();
+}
+
+bool ChordSession::push (const NoteEvent& event)
+{
+    auto write = writeIndex.load (std::memory_order_relaxed);
+    if (write - readIndex.load (std::memory_order_acquire) >= queueSize)
+    {
+        return false;
+    }
+    queue[write % queueSize] = event;
+    writeIndex.store (write + 1, std::memory_order_release);
+    pending.store (true);
+    return true;
+}
+
+bool ChordSession::takePending()
+{
+    return pending.exchange (false);
+}
+
+bool ChordSession::process()
+{
+    const int k = key.load();
+    if (k != processedKey)
+    {
+        processedKey = k;
+        progressionState = {};
+    }
+
+    // everything queued since the last call is treated as one onset group
+    auto read = readIndex.load (std::memory_order_relaxed);
+    auto write = writeIndex.load (std::memory_order_acquire);
+    for (; read != write; ++read)
+    {
+        auto& event = queue[read % queueSize];
+        if (event.note < 0 || event.note > 127)
+        {
+            continue;
+        }
+        time = event.time;
+        uint64_t bit = uint64_t (1) << (event.note % 64);
+        uint64_t& word = notes[event.note / 64];
+        word = event.on ? (word | bit) : (word & ~bit);
+    }
+    readIndex.store (read, std::memory_order_release);
+
+    // the result only depends on the notes and key, so a group that left both as they were
+    // published (a note pressed and released, a key set back) changes nothing
+    if (notes[0] == publishedNotes[0] && notes[1] == publishedNotes[1] && processedKey == publishedKey)
+    {
+        return false;
+    }
+    publishedNotes[0] = notes[0];
+    publishedNotes[1] = notes[1];
+    publishedKey = processedKey;
+
+    // bass is the lowest note, intervals are taken from the pitch classes of the rest
+    int bass = -1;
+    int numNotes = 0;
+    uint16_t pitchClasses = 0;
+    for (int note = 0; note < 128; ++note)
+    {
+        if ((notes[note / 64] >> (note % 64)) & 1)
+        {
+            if (bass < 0)
+            {
+                bass = note;
+            }
+            pitchClasses |= static_cast<uint16_t>(1 << ((note - bass) % 12));
+            ++numNotes;
+        }
+    }
+
+    ChordResult result;
+    if (numNotes >= 3 && processedKey != 0)
+    {
+        result = ChordAnalysis::identify (static_cast<uint16_t>(pitchClasses & ~1), bass, processedKey);
+    }
+
+    int progression = -1;
+    if (result.valid)
+    {
+        auto& progressions = ChordAnalysis::isMajor (processedKey) ? majorProgressions : minorProgressions;
+        progressions.feed (progressionState, result);
+        progression = progressionState.match;
+    }
+
+    publisher.publish (time, notes, result, processedKey, progression);
+    statistics.record (time, result, numNotes, processedKey);
+    return true;
+}
+
+ChordSession::Snapshot ChordSession::getSnapshot() const
+{
+    return publisher.read();
+}
+
+uint64_t ChordSession::getVersion() const
+{
+    return publisher.getVersion();
+}
+
+const ChordPublisher& ChordSession::getPublisher() const
+{
+    return publisher;
+}
+
+void ChordSession::setSharedSlot (chordid_shm_slot* slot)
+{
+    publisher.setSharedSlot (slot);
+}
+
+const SessionStatistics& ChordSession::getStatistics() const
+{
+    return statistics;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include "ChordAnalysis.h"
+#include "ChordPublisher.h"
+#include "OnsetGrouper.h"
+#include "ProgressionMatcher.h"
+#include "SessionStatistics.h"
+
+//==============================================================================
+// Analysis state for one keyboard, independent of any UI.
+//
+// Note events are pushed from a single producer (the MIDI thread of the device) into a fixed
+// size queue, and processed by a single consumer (a worker thread), which identifies the chord
+// once for everything that was queued and publishes the result through a ChordPublisher. Any
+// thread can read the published result. Memory used by a session is fixed and it never allocates.
+class ChordSession
+{
+public:
+    // matchers are shared by all sessions and must outlive them
+    ChordSession (const ProgressionMatcher& majorProgressions, const ProgressionMatcher& minorProgressions);
+
+    // can be called from any thread, takes effect the next time the session is processed
+    void setKey (int k);
+
+    int getKey() const;
+
+    // producer side, returns false if the queue is full and the event was dropped
+    bool push (const NoteEvent& event);
+
+    // returns true (once) if events or a key change are waiting to be processed
+    bool takePending();
+
+    // consumer side, returns true if a new result was published
+    // (only when the notes or key are different from the last one)
+    bool process();
+
+    //-----Published result, safe to read from any thread-----
+    using Snapshot = ChordPublisher::Snapshot;
+
+    Snapshot getSnapshot() const;
+
+    // incremented every time a new result is published
+    uint64_t getVersion() const;
+
+    const ChordPublisher& getPublisher() const;
+
+    // see ChordPublisher::setSharedSlot()
+    void setSharedSlot (chordid_shm_slot* slot);
+
+    // updated by process()
+    const SessionStatistics& getStatistics() const;
+
+private:
+    static const int queueSize = 256;
+
+    //-----Producer/consumer queue-----
+    std::array<NoteEvent, queueSize> queue;
+    std::atomic<uint32_t> readIndex { 0 };
+    std::atomic<uint32_t> writeIndex { 0 };
+    std::atomic<bool> pending { false };
+
+    //-----Consumer state-----
+    const ProgressionMatcher& majorProgressions;
+    const ProgressionMatcher& minorProgressions;
+    ProgressionMatcher::State progressionState;
+
+    // one bit per midi note number
+    uint64_t notes[2] = {0, 0};
+    int processedKey = 0;
+    // notes and key of the last result published
+    uint64_t publishedNotes[2] = {0, 0};
+    int publishedKey = 0;
+    // time of the last event processed
+    double time = 0.0;
+
+    std::atomic<int> key { 0 };
+
+    ChordPublisher publisher;
+    SessionStatistics statistics;
+};
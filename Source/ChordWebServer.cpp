@@ -0,0 +1,546 @@
+#include "ChordWebServer.h"
+
+#if JUCE_LINUX
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // how often publishers are checked for new results, in milliseconds
+    const int pollInterval = 10;
+
+    // seconds between the comments sent to idle streams, so dead connections are noticed
+    const double keepAliveInterval = 15.0;
+
+    // seconds a client has to send its request in
+    const double requestTimeout = 10.0;
+
+    const size_t maxRequestSize = 4096;
+
+    // encoded once and shared by every client it is queued to
+    using Buffer = std::shared_ptr<const std::string>;
+
+    Buffer makeBuffer (std::string text)
+    {
+        return std::make_shared<const std::string> (std::move (text));
+    }
+
+    Buffer makeResponse (const char* status, const char* contentType, const std::string& body)
+    {
+        return makeBuffer (std::string ("HTTP/1.1 ") + status + "\r\nContent-Type: " + contentType
+                           + "\r\nContent-Length: " + std::to_string (body.size())
+                           + "\r\nConnection: close\r\n\r\n" + body);
+    }
+
+    void appendJsonString (std::string& json, const std::string& text)
+    {
+        json += '"';
+        for (auto c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                json += '\\';
+                json += c;
+            } else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf (escaped, sizeof (escaped), "\\u%04x", c);
+                json += escaped;
+            } else
+            {
+                json += c;
+            }
+        }
+        json += '"';
+    }
+
+    double getSeconds()
+    {
+        return juce::Time::getMillisecondCounterHiRes() * 0.001;
+    }
+
+    const char* const page = R"(<!DOCTYPE html>
+<html>
+<head>
+<meta charset="utf-8">
+<meta name="viewport" content="width=device-width">
+<title>Chord Identifier</title>
+<style>
+body { margin: 0; display: flex; flex-wrap: wrap; font-family: sans-serif; background: #222; color: #eee; }
+div { flex: 1 1 16em; margin: 0.5em; padding: 1em; border-radius: 0.5em; background: #333; text-align: center; }
+b { display: block; min-height: 1.2em; font-size: 5em; font-weight: normal; }
+sup { display: inline-block; font-size: 0.4em; line-height: 1; text-align: left; vertical-align: 0.6em; }
+</style>
+</head>
+<body>
+<script>
+var cells = [];
+new EventSource("/events").addEventListener("chord", function (event)
+{
+    var chord = JSON.parse (event.data);
+    var cell = cells[chord.source];
+    if (! cell)
+    {
+        cell = cells[chord.source] = document.createElement ("div");
+        cell.innerHTML = "<span></span><b></b><small></small>";
+        document.body.appendChild (cell);
+    }
+    cell.children[0].textContent = chord.name;
+    cell.children[1].textContent = chord.numeral;
+    if (chord.figures.length > 0)
+    {
+        var figures = document.createElement ("sup");
+        figures.innerText = chord.figures.join ("\n");
+        cell.children[1].appendChild (figures);
+    }
+    cell.children[2].textContent = chord.key;
+});
+</script>
+</body>
+</html>
+)";
+
+    struct Client
+    {
+        std::string request;
+        double connected = 0.0;
+        bool streaming = false;
+        // set for plain responses, the connection is closed once they are sent
+        bool closeWhenSent = false;
+        // false while waiting for EPOLLOUT
+        bool writable = true;
+        std::deque<Buffer> queue;
+        // bytes of the front of the queue already sent
+        size_t offset = 0;
+        size_t queuedBytes = 0;
+    };
+
+    struct Source
+    {
+        std::string name;
+        const ChordPublisher* publisher;
+        uint64_t version;
+        // event for the latest result, sent to streams when they connect
+        Buffer latest;
+    };
+}
+
+//==============================================================================
+struct ChordWebServer::Pimpl
+{
+    ~Pimpl()
+    {
+        close();
+    }
+
+    void close()
+    {
+        for (auto& client : clients)
+        {
+            ::close (client.first);
+        }
+        clients.clear();
+        if (listener >= 0)
+        {
+            ::close (listener);
+        }
+        if (epoll >= 0)
+        {
+            ::close (epoll);
+        }
+        listener = -1;
+        epoll = -1;
+    }
+
+    Buffer encode (int index, const ChordPublisher::Snapshot& snapshot)
+    {
+        const auto& source = sources[static_cast<size_t>(index)];
+        const bool validKey = snapshot.key >= 1 && snapshot.key <= ChordAnalysis::numKeys;
+
+        std::string json = "{\"source\":" + std::to_string (index) + ",\"name\":";
+        appendJsonString (json, source.name);
+        json += ",\"key\":";
+        appendJsonString (json, validKey ? ChordAnalysis::getKeyName (snapshot.key) : "");
+        json += ",\"numeral\":";
+        appendJsonString (json, validKey && snapshot.result.valid ? ChordAnalysis::getNumeralText (snapshot.result, snapshot.key) : "");
+        json += ",\"figures\":[";
+        if (snapshot.result.valid)
+        {
+            auto figures = juce::StringArray::fromLines (snapshot.result.figures);
+            figures.removeEmptyStrings();
+            for (int i = 0; i < figures.size(); ++i)
+            {
+                json += i > 0 ? "," : "";
+                appendJsonString (json, figures[i].toStdString());
+            }
+        }
+        json += "],\"notes\":[";
+        bool first = true;
+        for (int note = 0; note < 128; ++note)
+        {
+            if ((snapshot.notes[note / 64] >> (note % 64)) & 1)
+            {
+                json += first ? "" : ",";
+                json += std::to_string (note);
+                first = false;
+            }
+        }
+        char number[64];
+        std::snprintf (number, sizeof (number), "],\"time\":%.3f,\"version\":%llu}", snapshot.time,
+                       static_cast<unsigned long long>(snapshot.version));
+        json += number;
+
+        return makeBuffer ("event: chord\ndata: " + json + "\n\n");
+    }
+
+    void accept (ChordWebServer& server)
+    {
+        for (;;)
+        {
+            const int socket = accept4 (listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (socket < 0)
+            {
+                return;
+            }
+            if (static_cast<int>(clients.size()) >= maxClients)
+            {
+                ::close (socket);
+                continue;
+            }
+            const int noDelay = 1;
+            setsockopt (socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof (noDelay));
+            epoll_event event {};
+            event.events = EPOLLIN;
+            event.data.fd = socket;
+            if (epoll_ctl (epoll, EPOLL_CTL_ADD, socket, &event) < 0)
+            {
+                ::close (socket);
+                continue;
+            }
+            clients[socket].connected = getSeconds();
+            server.numClients = static_cast<int>(clients.size());
+        }
+    }
+
+    // returns false if the client has closed the connection or sent something that isn't a request
+    bool read (int socket, Client& client)
+    {
+        char data[1024];
+        for (;;)
+        {
+            const ssize_t size = recv (socket, data, sizeof (data), 0);
+            if (size == 0)
+            {
+                return false;
+            }
+            if (size < 0)
+            {
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            // anything sent after the request is ignored
+            if (client.streaming || client.closeWhenSent)
+            {
+                continue;
+            }
+            client.request.append (data, static_cast<size_t>(size));
+            if (client.request.find ("\r\n\r\n") != std::string::npos || client.request.find ("\n\n") != std::string::npos)
+            {
+                return respond (socket, client);
+            }
+            if (client.request.size() > maxRequestSize)
+            {
+                return false;
+            }
+        }
+    }
+
+    bool respond (int socket, Client& client)
+    {
+        const auto line = client.request.substr (0, client.request.find_first_of ("\r\n"));
+        const auto methodEnd = line.find (' ');
+        const auto pathEnd = line.find_first_of (" ?", methodEnd + 1);
+        const auto method = line.substr (0, methodEnd);
+        const auto path = methodEnd == std::string::npos ? std::string() : line.substr (methodEnd + 1, pathEnd - methodEnd - 1);
+        client.request = std::string();
+
+        if (method != "GET")
+        {
+            client.closeWhenSent = true;
+            return send (socket, client, notAllowedResponse);
+        }
+        if (path == "/events")
+        {
+            // every source is sent its latest result, so the page is complete straight away
+            client.streaming = true;
+            if (! send (socket, client, streamHeaders))
+            {
+                return false;
+            }
+            for (auto& source : sources)
+            {
+                if (! send (socket, client, source.latest))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        client.closeWhenSent = true;
+        return send (socket, client, path == "/" || path == "/index.html" ? pageResponse : notFoundResponse);
+    }
+
+    // queues the buffer and sends as much as the socket takes
+    // returns false if the client should be disconnected
+    bool send (int socket, Client& client, const Buffer& buffer)
+    {
+        if (client.queuedBytes + buffer->size() > maxQueuedBytes)
+        {
+            return false;
+        }
+        client.queue.push_back (buffer);
+        client.queuedBytes += buffer->size();
+        return ! client.writable || flush (socket, client);
+    }
+
+    bool flush (int socket, Client& client)
+    {
+        while (! client.queue.empty())
+        {
+            const auto& front = *client.queue.front();
+            const ssize_t sent = ::send (socket, front.data() + client.offset, front.size() - client.offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    return false;
+                }
+                if (client.writable)
+                {
+                    client.writable = false;
+                    return setEvents (socket, EPOLLIN | EPOLLOUT);
+                }
+                return true;
+            }
+            client.offset += static_cast<size_t>(sent);
+            if (client.offset == front.size())
+            {
+                client.queuedBytes -= front.size();
+                client.offset = 0;
+                client.queue.pop_front();
+            }
+        }
+        if (client.closeWhenSent)
+        {
+            return false;
+        }
+        if (! client.writable)
+        {
+            client.writable = true;
+            return setEvents (socket, EPOLLIN);
+        }
+        return true;
+    }
+
+    bool setEvents (int socket, uint32_t events)
+    {
+        epoll_event event {};
+        event.events = events;
+        event.data.fd = socket;
+        return epoll_ctl (epoll, EPOLL_CTL_MOD, socket, &event) == 0;
+    }
+
+    void disconnect (ChordWebServer& server, int socket)
+    {
+        // closing the socket also removes it from the epoll set
+        ::close (socket);
+        clients.erase (socket);
+        server.numClients = static_cast<int>(clients.size());
+    }
+
+    // queues the buffer to every stream, and disconnects the ones that have too much waiting
+    void broadcast (ChordWebServer& server, const Buffer& buffer)
+    {
+        for (auto i = clients.begin(); i != clients.end();)
+        {
+            if (i->second.streaming && ! send (i->first, i->second, buffer))
+            {
+                ::close (i->first);
+                i = clients.erase (i);
+            } else
+            {
+                ++i;
+            }
+        }
+        server.numClients = static_cast<int>(clients.size());
+    }
+
+    int listener = -1;
+    int epoll = -1;
+
+    std::vector<Source> sources;
+    std::unordered_map<int, Client> clients;
+
+    const Buffer pageResponse = makeResponse ("200 OK", "text/html; charset=utf-8", page);
+    const Buffer notFoundResponse = makeResponse ("404 Not Found", "text/plain", "Not found\n");
+    const Buffer notAllowedResponse = makeResponse ("405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+    const Buffer streamHeaders = makeBuffer ("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                                             "Access-Control-Allow-Origin: *\r\nConnection: keep-alive\r\n\r\nretry: 1000\n\n");
+    const Buffer keepAlive = makeBuffer (":\n\n");
+};
+
+//==============================================================================
+ChordWebServer::ChordWebServer()
+  : juce::Thread ("Chord web server"), pimpl (std::make_unique<Pimpl>())
+{
+}
+
+ChordWebServer::~ChordWebServer()
+{
+    stop();
+}
+
+void ChordWebServer::addSource (const juce::String& name, const ChordPublisher& publisher)
+{
+    jassert (! isThreadRunning());
+    pimpl->sources.push_back ({ name.toStdString(), &publisher, 0, nullptr });
+}
+
+bool ChordWebServer::start (int portNumber)
+{
+    stop();
+    auto& p = *pimpl;
+
+    p.listener = socket (AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    p.epoll = epoll_create1 (EPOLL_CLOEXEC);
+    if (p.listener < 0 || p.epoll < 0)
+    {
+        p.close();
+        return false;
+    }
+    const int reuse = 1;
+    setsockopt (p.listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof (reuse));
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl (INADDR_ANY);
+    address.sin_port = htons (static_cast<uint16_t>(portNumber));
+    socklen_t addressSize = sizeof (address);
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.fd = p.listener;
+    if (bind (p.listener, reinterpret_cast<sockaddr*>(&address), sizeof (address)) < 0
+        || listen (p.listener, SOMAXCONN) < 0
+        || getsockname (p.listener, reinterpret_cast<sockaddr*>(&address), &addressSize) < 0
+        || epoll_ctl (p.epoll, EPOLL_CTL_ADD, p.listener, &event) < 0)
+    {
+        p.close();
+        return false;
+    }
+
+    // the current result of every source, so the first streams have something to show
+    for (size_t i = 0; i < p.sources.size(); ++i)
+    {
+        auto snapshot = p.sources[i].publisher->read();
+        p.sources[i].version = snapshot.version;
+        p.sources[i].latest = p.encode (static_cast<int>(i), snapshot);
+    }
+
+    port = ntohs (address.sin_port);
+    startThread();
+    return true;
+}
+
+void ChordWebServer::stop()
+{
+    stopThread (pollInterval * 100);
+    pimpl->close();
+    port = 0;
+    numClients = 0;
+}
+
+int ChordWebServer::getPort() const
+{
+    return port;
+}
+
+int ChordWebServer::getNumClients() const
+{
+    return numClients;
+}
+
+void ChordWebServer::run()
+{
+    auto& p = *pimpl;
+    epoll_event events[64];
+    double lastKeepAlive = getSeconds();
+
+    while (! threadShouldExit())
+    {
+        const int numEvents = epoll_wait (p.epoll, events, 64, pollInterval);
+        for (int i = 0; i < numEvents; ++i)
+        {
+            const int socket = events[i].data.fd;
+            if (socket == p.listener)
+            {
+                p.accept (*this);
+                continue;
+            }
+            auto client = p.clients.find (socket);
+            if (client == p.clients.end())
+            {
+                continue;
+            }
+            const bool ok = (events[i].events & (EPOLLERR | EPOLLHUP)) == 0
+                         && ((events[i].events & EPOLLIN) == 0 || p.read (socket, client->second))
+                         && ((events[i].events & EPOLLOUT) == 0 || p.flush (socket, client->second));
+            if (! ok)
+            {
+                p.disconnect (*this, socket);
+            }
+        }
+
+        for (size_t i = 0; i < p.sources.size(); ++i)
+        {
+            auto& source = p.sources[i];
+            if (source.publisher->getVersion() != source.version)
+            {
+                auto snapshot = source.publisher->read();
+                source.version = snapshot.version;
+                source.latest = p.encode (static_cast<int>(i), snapshot);
+                p.broadcast (*this, source.latest);
+            }
+        }
+
+        const double now = getSeconds();
+        if (now - lastKeepAlive >= keepAliveInterval)
+        {
+            lastKeepAlive = now;
+            p.broadcast (*this, p.keepAlive);
+        }
+        for (auto client = p.clients.begin(); client != p.clients.end();)
+        {
+            if (! client->second.streaming && ! client->second.closeWhenSent && now - client->second.connected > requestTimeout)
+            {
+                ::close (client->first);
+                client = p.clients.erase (client);
+                numClients = static_cast<int>(p.clients.size());
+            } else
+            {
+                ++client;
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_LINUX
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include "ChordPublisher.h"
+
+//==============================================================================
+/*
+    Small HTTP server showing the live chords in a browser, so that students' laptops or a
+    projector can follow along without installing anything.
+
+    GET / returns a page showing every source, and GET /events is a Server-Sent Events stream
+    with a "chord" event for every published result. A single thread serves all the clients
+    with epoll and non-blocking sockets.
+
+    Publishers are polled, so the analysis never waits for the server. Each result is encoded
+    once and the same buffer is queued to every client. A client that doesn't keep up and has
+    more than maxQueuedBytes waiting is disconnected (EventSource reconnects by itself, and is
+    sent the current chords again).
+*/
+class ChordWebServer : private juce::Thread
+{
+public:
+    ChordWebServer();
+    ~ChordWebServer() override;
+
+    // publisher must outlive the server, sources can't be added while it is running
+    void addSource (const juce::String& name, const ChordPublisher& publisher);
+
+    // listens on every interface, port 0 picks a free one, returns false if it can't listen
+    bool start (int port);
+
+    void stop();
+
+    // port listened on, 0 if not running
+    int getPort() const;
+
+    int getNumClients() const;
+
+    static const int defaultPort = 8080;
+
+    // connections beyond this are closed as soon as they are accepted
+    static const int maxClients = 256;
+
+    static const size_t maxQueuedBytes = 64 * 1024;
+
+private:
+    void run() override;
+
+    struct Pimpl;
+    std::unique_ptr<Pimpl> pimpl;
+
+    std::atomic<int> port { 0 };
+    std::atomic<int> numClients { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChordWebServer)
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "ClassroomComponent.h"
+#include "ChordComponent.h"
+#include "StatisticsComponent.h"
+
+//==============================================================================
+ClassroomComponent::SessionCell::SessionCell (ClassroomServer& s, int index)
+  : server (s), sessionIndex (index)
+{
+    setOpaque (true);
+
+    addAndMakeVisible (keyList);
+    keyList.setTextWhenNothingSelected ("--");
+    ChordComponent::fillKeyList (keyList);
+    keyList.onChange = [this] { server.setKey (sessionIndex, keyList.getSelectedId()); };
+}
+
+ClassroomComponent::SessionCell::~SessionCell()
+{
+    if (statisticsWindow != nullptr)
+    {
+        delete statisticsWindow.getComponent();
+    }
+}
+
+void ClassroomComponent::SessionCell::mouseDoubleClick (const juce::MouseEvent&)
+{
+    if (statisticsWindow != nullptr)
+    {
+        statisticsWindow->toFront (true);
+        return;
+    }
+    auto& session = server.getSession (sessionIndex);
+    statisticsWindow = StatisticsComponent::show (server.getSessionName (sessionIndex), session.getStatistics(),
+                                                  [&session] { return session.getKey(); });
+}
+
+void ClassroomComponent::SessionCell::paint (juce::Graphics& g)
+{
+    auto& lf = getLookAndFeel();
+    g.fillAll (lf.findColour (juce::ResizableWindow::backgroundColourId).brighter (0.05f));
+    g.setColour (lf.findColour (juce::ComboBox::outlineColourId));
+    g.drawRect (getLocalBounds());
+
+    auto area = getLocalBounds().reduced (4);
+    auto header = area.removeFromTop (24);
+    g.setColour (lf.findColour (juce::Label::textColourId));
+    g.setFont (juce::Font (16.0f));
+    g.drawFittedText (server.getSessionName (sessionIndex), header.withTrimmedRight (keyList.getWidth() + 4),
+                      juce::Justification::centredLeft, 1);
+
+    auto footer = area.removeFromBottom (area.getHeight() / 5);
+    if (snapshot.progression >= 0)
+    {
+        auto& progressions = server.getProgressions (ChordAnalysis::isMajor (snapshot.key));
+        g.setColour (juce::Colours::cornflowerblue);
+        g.setFont (juce::Font (footer.getHeight() * 0.8f));
+        g.drawFittedText (juce::String::fromUTF8 (progressions.getPattern (snapshot.progression).name.c_str()),
+                          footer, juce::Justification::centred, 1);
+    }
+
+    if (! snapshot.result.valid)
+    {
+        return;
+    }
+
+    // numeral with its accidental and quality, followed by the figured bass stacked on the right
+    auto spelling = ChordAnalysis::spell (snapshot.result.chromaticDegree, snapshot.result.capital, snapshot.key);
+    auto numeral = juce::String (juce::CharPointer_UTF8 (spelling.accidental))
+                 + spelling.numeral
+                 + juce::String (juce::CharPointer_UTF8 (snapshot.result.quality));
+    auto figures = juce::StringArray::fromLines (snapshot.result.figures);
+    figures.removeEmptyStrings();
+
+    juce::Font numeralFont (area.getHeight() * 0.8f);
+    auto figuresWidth = figures.isEmpty() ? 0 : static_cast<int>(numeralFont.getHeight() * INTERVAL_WIDTH_TO_HEIGHT_RATIO);
+    auto numeralWidth = juce::jmin (area.getWidth() - figuresWidth, numeralFont.getStringWidth (numeral));
+    auto chordArea = area.withSizeKeepingCentre (numeralWidth + figuresWidth, area.getHeight());
+
+    g.setColour (lf.findColour (juce::Label::textColourId));
+    g.setFont (numeralFont);
+    g.drawFittedText (numeral, chordArea.removeFromLeft (numeralWidth), juce::Justification::centred, 1);
+
+    if (! figures.isEmpty())
+    {
+        auto lineHeight = chordArea.getHeight() / 2;
+        g.setFont (juce::Font (lineHeight * 0.9f));
+        auto figuresArea = chordArea.withSizeKeepingCentre (chordArea.getWidth(), lineHeight * figures.size());
+        for (auto& figure : figures)
+        {
+            g.drawText (figure, figuresArea.removeFromTop (lineHeight), juce::Justification::centredLeft);
+        }
+    }
+}
+
+void ClassroomComponent::SessionCell::resized()
+{
+    keyList.setBounds (getLocalBounds().reduced (4).removeFromTop (24).removeFromRight (110));
+}
+
+void ClassroomComponent::SessionCell::update()
+{
+    auto& session = server.getSession (sessionIndex);
+    if (session.getVersion() != version)
+    {
+        snapshot = session.getSnapshot();
+        version = snapshot.version;
+        repaint();
+    }
+}
+
+//==============================================================================
+ClassroomComponent::ClassroomComponent (bool alsaSequencer)
+{
+    setOpaque (true);
+
+    server.start (alsaSequencer);
+    addCells();
+
+    startTimerHz (30);
+    setSize (900, 600);
+}
+
+ClassroomComponent::~ClassroomComponent()
+{
+    stopTimer();
+    server.stop();
+}
+
+void ClassroomComponent::paint (juce::Graphics& g)
+{
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+
+    if (cells.empty())
+    {
+        g.setColour (getLookAndFeel().findColour (juce::Label::textColourId));
+        g.setFont (juce::Font (20.0f));
+        g.drawText ("No MIDI Inputs Enabled", getLocalBounds(), juce::Justification::centred);
+    }
+}
+
+void ClassroomComponent::resized()
+{
+    if (cells.empty())
+    {
+        return;
+    }
+
+    // as square a grid as possible
+    auto numCells = static_cast<int>(cells.size());
+    auto columns = static_cast<int>(std::ceil (std::sqrt (static_cast<double>(numCells))));
+    auto rows = (numCells + columns - 1) / columns;
+    auto cellWidth = getWidth() / columns;
+    auto cellHeight = getHeight() / rows;
+
+    for (int i = 0; i < numCells; ++i)
+    {
+        cells[static_cast<size_t>(i)]->setBounds ((i % columns) * cellWidth, (i / columns) * cellHeight, cellWidth, cellHeight);
+    }
+}
+
+ClassroomServer& ClassroomComponent::getServer()
+{
+    return server;
+}
+
+void ClassroomComponent::addCells()
+{
+    const auto numCells = cells.size();
+    while (static_cast<int>(cells.size()) < server.getNumSessions())
+    {
+        cells.push_back (std::make_unique<SessionCell> (server, static_cast<int>(cells.size())));
+        addAndMakeVisible (*cells.back());
+    }
+    if (cells.size() != numCells)
+    {
+        resized();
+        repaint();
+    }
+}
+
+void ClassroomComponent::timerCallback()
+{
+    // keyboards connected to the sequencer after it started
+    addCells();
+    for (auto& cell : cells)
+    {
+        cell->update();
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+#include "ClassroomServer.h"
+
+//==============================================================================
+/*
+    Grid showing the current chord of every session of a ClassroomServer.
+
+    Sessions are polled on a timer, and only cells whose session published a new result
+    are repainted.
+*/
+class ClassroomComponent : public juce::Component,
+                           private juce::Timer
+{
+public:
+    // alsaSequencer reads the keyboards through the ALSA sequencer, see ClassroomServer::start()
+    explicit ClassroomComponent (bool alsaSequencer = false);
+    ~ClassroomComponent() override;
+
+    void paint (juce::Graphics& g) override;
+
+    void resized() override;
+
+    ClassroomServer& getServer();
+
+private:
+    void timerCallback() override;
+
+    // adds a cell for every session that doesn't have one yet
+    void addCells();
+
+    // one cell of the grid, showing the device name, its key and its chord
+    class SessionCell : public juce::Component
+    {
+    public:
+        SessionCell (ClassroomServer& s, int index);
+        ~SessionCell() override;
+
+        void paint (juce::Graphics& g) override;
+
+        void resized() override;
+
+        // repaints the cell if its session published a new result
+        void update();
+
+        // double clicking a cell shows the statistics of its session
+        void mouseDoubleClick (const juce::MouseEvent&) override;
+
+    private:
+        ClassroomServer& server;
+        const int sessionIndex;
+        uint64_t version = 0;
+        ChordSession::Snapshot snapshot;
+
+        juce::ComboBox keyList;
+        juce::Component::SafePointer<juce::DialogWindow> statisticsWindow;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SessionCell)
+    };
+
+    ClassroomServer server;
+    std::vector<std::unique_ptr<SessionCell>> cells;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ClassroomComponent)
+};
@@ -0,0 +1,289 @@
+#include "ClassroomServer.h"
+#include "ChordComponent.h"
+
+#include <iostream>
+
+#if JUCE_LINUX
+ #include <poll.h>
+ #include <sys/eventfd.h>
+ #include <sys/mman.h>
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    // SCHED_FIFO priority of the ALSA input thread, above the audio threads of most desktops
+    const int sequencerPriority = 80;
+}
+
+//==============================================================================
+ClassroomServer::Worker::Worker (ClassroomServer& s, int first, int stride)
+  : juce::Thread ("Chord worker " + juce::String (first)), server (s), firstSession (first), sessionStride (stride)
+{
+   #if JUCE_LINUX
+    wakeEvent = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+   #endif
+}
+
+ClassroomServer::Worker::~Worker()
+{
+    stopThread (1000);
+   #if JUCE_LINUX
+    if (wakeEvent >= 0)
+    {
+        close (wakeEvent);
+    }
+   #endif
+}
+
+void ClassroomServer::Worker::run()
+{
+    while (! threadShouldExit())
+    {
+        // wake() from the MIDI callback wakes us up early, the timeout only matters for key changes
+       #if JUCE_LINUX
+        if (wakeEvent >= 0)
+        {
+            pollfd descriptor { wakeEvent, POLLIN, 0 };
+            if (poll (&descriptor, 1, 100) > 0)
+            {
+                eventfd_t count;
+                eventfd_read (wakeEvent, &count);
+            }
+        } else
+       #endif
+        {
+            wait (100);
+        }
+
+        // cleared before looking, so an event queued from here on wakes us again
+        woken = false;
+        for (int i = firstSession; i < server.getNumSessions(); i += sessionStride)
+        {
+            auto& session = *server.sessions[static_cast<size_t>(i)];
+            if (session.takePending())
+            {
+                session.process();
+            }
+        }
+    }
+}
+
+//==============================================================================
+ClassroomServer::ClassroomServer()
+{
+    // user defined progressions are shared with the single keyboard mode
+    auto lines = ChordComponent::getUserProgressionsFile().loadFileAsString().toStdString();
+    majorProgressions.addPatterns (lines, true);
+    minorProgressions.addPatterns (lines, false);
+    majorProgressions.compile();
+    minorProgressions.compile();
+}
+
+ClassroomServer::~ClassroomServer()
+{
+    stop();
+}
+
+void ClassroomServer::start (bool alsaSequencer)
+{
+    stop();
+
+   #if JUCE_LINUX
+    const bool useSequencer = alsaSequencer && startSequencer();
+   #else
+    juce::ignoreUnused (alsaSequencer);
+    const bool useSequencer = false;
+   #endif
+
+    for (auto& device : juce::MidiInput::getAvailableDevices())
+    {
+        if (useSequencer)
+        {
+            break;
+        }
+        auto input = juce::MidiInput::openDevice (device.identifier, this);
+        if (input == nullptr)
+        {
+            continue;
+        }
+        sessions.push_back (std::make_unique<ChordSession> (majorProgressions, minorProgressions));
+        inputs.push_back (std::move (input));
+        names.add (device.name);
+    }
+
+    // identification is cheap, so a few workers are enough for a whole room
+    int numWorkers = juce::jlimit (1, 4, juce::SystemStats::getNumCpus() - 1);
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.push_back (std::make_unique<Worker> (*this, i, numWorkers));
+        workers.back()->startThread();
+    }
+
+    for (auto& input : inputs)
+    {
+        input->start();
+    }
+   #if JUCE_LINUX
+    if (sequencer != nullptr)
+    {
+        sequencer->start (sequencerPriority);
+        std::cout << "Reading MIDI from the ALSA sequencer at " << sequencer->getAddress().toStdString()
+                  << ", " << (sequencer->isRealtime() ? "with" : "without") << " realtime priority, memory "
+                  << (sequencer->isMemoryLocked() ? "locked" : "not locked") << std::endl;
+    }
+   #endif
+}
+
+void ClassroomServer::stop()
+{
+   #if JUCE_LINUX
+    if (sequencer != nullptr)
+    {
+        sequencer->stop();
+        for (auto& session : sessions)
+        {
+            munlock (session.get(), sizeof (ChordSession));
+        }
+    }
+   #endif
+    for (auto& input : inputs)
+    {
+        input->stop();
+    }
+    for (auto& worker : workers)
+    {
+        worker->stopThread (1000);
+    }
+    workers.clear();
+    // the workers ask the sequencer how many sessions there are, so it goes after them
+   #if JUCE_LINUX
+    sequencer.reset();
+   #endif
+    inputs.clear();
+    sessions.clear();
+    names.clear();
+}
+
+int ClassroomServer::getNumSessions() const
+{
+   #if JUCE_LINUX
+    if (sequencer != nullptr)
+    {
+        return sequencer->getNumSources();
+    }
+   #endif
+    return static_cast<int>(sessions.size());
+}
+
+const ChordSession& ClassroomServer::getSession (int index) const
+{
+    return *sessions[static_cast<size_t>(index)];
+}
+
+juce::String ClassroomServer::getSessionName (int index) const
+{
+   #if JUCE_LINUX
+    if (sequencer != nullptr)
+    {
+        return sequencer->getSourceName (index);
+    }
+   #endif
+    return names[index];
+}
+
+void ClassroomServer::setKey (int index, int key)
+{
+    sessions[static_cast<size_t>(index)]->setKey (key);
+    wake (index);
+}
+
+void ClassroomServer::setSharedSlot (int index, chordid_shm_slot* slot)
+{
+    sessions[static_cast<size_t>(index)]->setSharedSlot (slot);
+}
+
+const ProgressionMatcher& ClassroomServer::getProgressions (bool major) const
+{
+    return major ? majorProgressions : minorProgressions;
+}
+
+void ClassroomServer::handleIncomingMidiMessage (juce::MidiInput* source, const juce::MidiMessage& message)
+{
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        if (inputs[i].get() == source)
+        {
+            push (static_cast<int>(i), message.getRawData(), message.getRawDataSize(), message.getTimeStamp());
+            return;
+        }
+    }
+}
+
+#if JUCE_LINUX
+void ClassroomServer::handleSequencerMessage (int source, const juce::uint8* data, int size, double time)
+{
+    push (source, data, size, time);
+}
+
+bool ClassroomServer::startSequencer()
+{
+    sequencer.reset (new AlsaSequencerInput (*this));
+    if (! sequencer->open ("Chord Identifier"))
+    {
+        sequencer.reset();
+        return false;
+    }
+
+    // the sessions are what the realtime thread writes to, so they are allocated before it starts
+    // (including the ones for sources it may add) and locked in memory as well
+    for (int i = 0; i < AlsaSequencerInput::maxSources; ++i)
+    {
+        sessions.push_back (std::make_unique<ChordSession> (majorProgressions, minorProgressions));
+        mlock (sessions.back().get(), sizeof (ChordSession));
+    }
+    return true;
+}
+#endif
+
+void ClassroomServer::push (int index, const juce::uint8* data, int size, double time)
+{
+    if (size < 3)
+    {
+        return;
+    }
+    const int type = data[0] & 0xf0;
+    if (type != 0x80 && type != 0x90)
+    {
+        return;
+    }
+
+    // a note on with no velocity is a note off
+    sessions[static_cast<size_t>(index)]->push ({ data[1] & 0x7f, type == 0x90 && data[2] > 0, time });
+    wake (index);
+}
+
+void ClassroomServer::Worker::wake()
+{
+    if (woken.exchange (true))
+    {
+        return;
+    }
+   #if JUCE_LINUX
+    // writing to an eventfd takes no lock that a lower priority thread could be holding
+    if (wakeEvent >= 0)
+    {
+        eventfd_write (wakeEvent, 1);
+        return;
+    }
+   #endif
+    notify();
+}
+
+void ClassroomServer::wake (int index)
+{
+    if (! workers.empty())
+    {
+        workers[static_cast<size_t>(index) % workers.size()]->wake();
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "AlsaSequencerInput.h"
+#include "ChordSession.h"
+
+//==============================================================================
+/*
+    Runs one ChordSession per MIDI input so that a whole room of keyboards can be analysed
+    by a single process.
+
+    MIDI callbacks only queue the event in the session of the device and wake a worker,
+    sessions are shared out between a small fixed pool of worker threads which do the
+    identification.
+
+    On Linux the inputs can instead be read from the ALSA sequencer by an AlsaSequencerInput,
+    on a realtime thread with kernel timestamps, which queues events the same way. Keyboards
+    connected to it later get a session too, from ones allocated in advance.
+*/
+class ClassroomServer : private juce::MidiInputCallback
+#if JUCE_LINUX
+                      , private AlsaSequencerInput::Callback
+#endif
+{
+public:
+    ClassroomServer();
+    ~ClassroomServer() override;
+
+    // opens every available MIDI input, each one gets its own session
+    // alsaSequencer reads them through the ALSA sequencer instead, on Linux, if it can be opened
+    void start (bool alsaSequencer = false);
+
+    void stop();
+
+    // can grow while the server is running when reading from the ALSA sequencer
+    int getNumSessions() const;
+
+    const ChordSession& getSession (int index) const;
+
+    juce::String getSessionName (int index) const;
+
+    void setKey (int index, int key);
+
+    // mirrors the results of a session to shared memory, see ChordPublisher::setSharedSlot()
+    void setSharedSlot (int index, chordid_shm_slot* slot);
+
+    const ProgressionMatcher& getProgressions (bool major) const;
+
+private:
+    void handleIncomingMidiMessage (juce::MidiInput* source, const juce::MidiMessage& message) override;
+
+   #if JUCE_LINUX
+    void handleSequencerMessage (int source, const juce::uint8* data, int size, double time) override;
+
+    // opens the sequencer and creates a session per source, returns false if it couldn't be opened
+    bool startSequencer();
+   #endif
+
+    // queues a note on or off (and ignores anything else) from any input thread
+    void push (int index, const juce::uint8* data, int size, double time);
+
+    // wakes the worker responsible for a session
+    void wake (int index);
+
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker (ClassroomServer& s, int first, int stride);
+        ~Worker() override;
+
+        void run() override;
+
+        // safe to call from the realtime sequencer thread, which notify() isn't as it takes a lock
+        void wake();
+
+    private:
+        ClassroomServer& server;
+        const int firstSession;
+        const int sessionStride;
+
+        // set by wake() until the worker looks at its sessions again, so only the first event
+        // after that has to make a system call
+        std::atomic<bool> woken { false };
+       #if JUCE_LINUX
+        int wakeEvent = -1;
+       #endif
+    };
+
+    ProgressionMatcher majorProgressions = ProgressionMatcher::createDefault (true);
+    ProgressionMatcher minorProgressions = ProgressionMatcher::createDefault (false);
+
+    // sessions and inputs have the same index, and don't change while the server is running
+    // with the sequencer there is a session ready for every source it can add, and the ones in
+    // use are those of its sources
+    std::vector<std::unique_ptr<ChordSession>> sessions;
+    std::vector<std::unique_ptr<juce::MidiInput>> inputs;
+    juce::StringArray names;
+
+   #if JUCE_LINUX
+    std::unique_ptr<AlsaSequencerInput> sequencer;
+   #endif
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ClassroomServer)
+};
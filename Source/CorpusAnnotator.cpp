@@ -0,0 +1,422 @@
+#include "CorpusAnnotator.h"
+#include "HarmonicDecoder.h"
+#include "MusicXmlAnnotator.h"
+#include "ProgressionIndex.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+namespace
+{
+    // read size, large enough that the parser isn't called for every few notes
+    const int chunkSize = 1 << 16;
+
+    bool isScore (const juce::File& file)
+    {
+        return file.hasFileExtension ("musicxml;xml;mxl") && ! file.getFileName().endsWith (".chords.csv");
+    }
+
+    // MusicXML inside an .mxl archive, the first entry outside META-INF
+    std::unique_ptr<juce::InputStream> openScore (const juce::File& file, std::unique_ptr<juce::ZipFile>& zip)
+    {
+        if (! file.hasFileExtension ("mxl"))
+        {
+            return file.createInputStream();
+        }
+
+        zip = std::make_unique<juce::ZipFile> (file);
+        for (int i = 0; i < zip->getNumEntries(); ++i)
+        {
+            auto name = zip->getEntry (i)->filename;
+            if (! name.startsWith ("META-INF") && name.endsWith (".xml"))
+            {
+                return std::unique_ptr<juce::InputStream> (zip->createStreamForEntry (i));
+            }
+        }
+        return nullptr;
+    }
+
+    // a score and where its annotations go
+    struct Score
+    {
+        juce::File file;
+        juce::File output;
+    };
+
+    // the full file name is kept so x.xml and x.mxl don't share an output, and in an output
+    // folder the path below root is kept too, so scores with the same name in different folders don't
+    Score getScore (const juce::File& file, const juce::File& root, const juce::File& outputFolder)
+    {
+        if (outputFolder == juce::File())
+        {
+            return { file, file.getSiblingFile (file.getFileName() + ".chords.csv") };
+        }
+        return { file, outputFolder.getChildFile (file.getRelativePathFrom (root) + ".chords.csv") };
+    }
+
+    struct AtomicTotals
+    {
+        std::atomic<int> failed { 0 };
+        std::atomic<juce::int64> bytes { 0 };
+        std::atomic<juce::int64> notes { 0 };
+        std::atomic<juce::int64> sonorities { 0 };
+        std::atomic<juce::int64> identified { 0 };
+    };
+
+    // documents are added from every job, so the builder is only used under the lock
+    struct IndexUpdate
+    {
+        ProgressionIndex::Builder builder;
+        juce::CriticalSection lock;
+    };
+
+    int64_t getModificationTime (const juce::File& file)
+    {
+        return file.getLastModificationTime().toMilliseconds();
+    }
+
+    void annotateScore (const Score& score, IndexUpdate* index, bool smooth, AtomicTotals& totals)
+    {
+        auto& file = score.file;
+        std::unique_ptr<juce::ZipFile> zip;
+        auto input = openScore (file, zip);
+
+        MusicXmlAnnotator annotator;
+        bool ok = input != nullptr;
+        juce::HeapBlock<char> chunk (chunkSize);
+        juce::int64 bytes = 0;
+        while (ok)
+        {
+            int read = input->read (chunk.get(), chunkSize);
+            if (read <= 0)
+            {
+                break;
+            }
+            bytes += read;
+            ok = annotator.feed (chunk.get(), static_cast<size_t>(read));
+        }
+        ok = ok && annotator.finish();
+        totals.bytes += bytes;
+        if (ok && smooth)
+        {
+            annotator.smooth();
+        }
+
+        if (! ok)
+        {
+            std::cerr << "Couldn't read " << file.getFullPathName().toStdString() << std::endl;
+            ++totals.failed;
+            return;
+        }
+
+        auto& sonorities = annotator.getSonorities();
+        juce::int64 identified = 0;
+        for (auto& sonority : sonorities)
+        {
+            identified += sonority.result.valid ? 1 : 0;
+        }
+
+        auto& output = score.output;
+        output.getParentDirectory().createDirectory();
+        std::ofstream out (output.getFullPathName().toStdString(), std::ios::binary);
+        MusicXmlAnnotator::writeCsv (sonorities, out);
+        out.flush();
+        if (! out)
+        {
+            std::cerr << "Couldn't write " << output.getFullPathName().toStdString() << std::endl;
+            ++totals.failed;
+            return;
+        }
+
+        if (index != nullptr)
+        {
+            std::vector<uint16_t> tokens;
+            std::vector<int32_t> measures;
+            for (auto& sonority : sonorities)
+            {
+                if (sonority.result.valid)
+                {
+                    tokens.push_back (ProgressionIndex::toToken (sonority.result, sonority.key));
+                    measures.push_back (sonority.measure);
+                }
+            }
+            const juce::ScopedLock lock (index->lock);
+            index->builder.addDocument (file.getFullPathName().toStdString(), getModificationTime (file), file.getSize(), tokens, measures);
+        }
+
+        totals.notes += annotator.getNumNotes();
+        totals.sonorities += static_cast<juce::int64>(sonorities.size());
+        totals.identified += identified;
+    }
+}
+
+//==============================================================================
+CorpusAnnotator::Totals CorpusAnnotator::annotate (const juce::StringArray& paths, const juce::File& outputFolder, const juce::File& indexFile, bool smooth, int numThreads)
+{
+    // outputs mirror the folders below the one given, or the working directory for single scores
+    const auto workingDirectory = juce::File::getCurrentWorkingDirectory();
+    juce::Array<Score> scores;
+    for (auto& path : paths)
+    {
+        auto file = workingDirectory.getChildFile (path);
+        if (file.isDirectory())
+        {
+            for (auto& child : file.findChildFiles (juce::File::findFiles, true, "*.musicxml;*.xml;*.mxl"))
+            {
+                if (isScore (child))
+                {
+                    scores.add (getScore (child, file, outputFolder));
+                }
+            }
+        } else if (isScore (file))
+        {
+            scores.add (getScore (file, file.isAChildOf (workingDirectory) ? workingDirectory : file.getParentDirectory(), outputFolder));
+        }
+    }
+
+    if (outputFolder != juce::File())
+    {
+        outputFolder.createDirectory();
+    }
+
+    // scores the old index has with the same modification time and size are copied, not analysed again
+    std::unique_ptr<juce::MemoryMappedFile> oldMapping;
+    std::unique_ptr<IndexUpdate> index;
+    int unchanged = 0;
+    if (indexFile != juce::File())
+    {
+        index = std::make_unique<IndexUpdate>();
+        if (indexFile.existsAsFile())
+        {
+            oldMapping = std::make_unique<juce::MemoryMappedFile> (indexFile, juce::MemoryMappedFile::readOnly);
+            ProgressionIndex old (oldMapping->getData(), oldMapping->getSize());
+            if (! old.isValid())
+            {
+                std::cerr << "Rebuilding " << indexFile.getFullPathName().toStdString() << ", it isn't a valid index" << std::endl;
+            }
+
+            std::map<juce::String, Score> toAnnotate;
+            for (auto& score : scores)
+            {
+                toAnnotate[score.file.getFullPathName()] = score;
+            }
+            for (uint32_t d = 0; d < old.getNumDocuments(); ++d)
+            {
+                juce::File file (juce::String (juce::CharPointer_UTF8 (old.getDocumentPath (d).c_str())));
+                auto found = toAnnotate.find (file.getFullPathName());
+                if (found != toAnnotate.end())
+                {
+                    if (old.getDocumentModificationTime (d) != getModificationTime (file) || old.getDocumentSize (d) != file.getSize())
+                    {
+                        continue;
+                    }
+                    toAnnotate.erase (found);
+                    ++unchanged;
+                } else if (! file.existsAsFile())
+                {
+                    continue;
+                }
+                index->builder.addDocument (old, d);
+            }
+
+            scores.clear();
+            for (auto& score : toAnnotate)
+            {
+                scores.add (score.second);
+            }
+        }
+    }
+
+    // a plain diatonic progression has to come out of the decoder as it went in
+    jassert (! smooth || HarmonicDecoder::checkCalibration());
+
+    AtomicTotals totals;
+    std::atomic<int> remaining { scores.size() };
+    juce::WaitableEvent finished;
+    const double start = juce::Time::getMillisecondCounterHiRes();
+    {
+        juce::ThreadPool pool (juce::jmax (1, numThreads));
+        for (auto& score : scores)
+        {
+            pool.addJob ([score, &index, smooth, &totals, &remaining, &finished]
+            {
+                annotateScore (score, index.get(), smooth, totals);
+                if (--remaining == 0)
+                {
+                    finished.signal();
+                }
+            });
+        }
+        if (! scores.isEmpty())
+        {
+            finished.wait();
+        }
+    }
+
+    Totals result;
+    if (index != nullptr)
+    {
+        // the old index may still be mapped, so the new one replaces it once it is complete
+        auto temporary = indexFile.getSiblingFile (indexFile.getFileName() + ".tmp");
+        std::ofstream out (temporary.getFullPathName().toStdString(), std::ios::binary);
+        bool written = index->builder.write (out);
+        out.close();
+        oldMapping.reset();
+        if (! written || ! temporary.moveFileTo (indexFile))
+        {
+            std::cerr << "Couldn't write " << indexFile.getFullPathName().toStdString() << std::endl;
+            temporary.deleteFile();
+            ++totals.failed;
+        }
+    }
+
+    result.files = scores.size();
+    result.failed = totals.failed;
+    result.bytes = totals.bytes;
+    result.notes = totals.notes;
+    result.sonorities = totals.sonorities;
+    result.identified = totals.identified;
+    result.unchanged = unchanged;
+    result.seconds = (juce::Time::getMillisecondCounterHiRes() - start) * 0.001;
+    return result;
+}
+
+juce::String CorpusAnnotator::describe (const Totals& totals)
+{
+    const double seconds = juce::jmax (totals.seconds, 1e-6);
+    const double identifiedPercent = totals.sonorities > 0 ? 100.0 * static_cast<double>(totals.identified) / static_cast<double>(totals.sonorities) : 0.0;
+
+    return juce::String (totals.files - totals.failed) + " of " + juce::String (totals.files) + " scores, "
+         + juce::String (totals.notes) + " notes, " + juce::String (totals.sonorities) + " sonorities ("
+         + juce::String (identifiedPercent, 1) + "% identified) in " + juce::String (totals.seconds, 2) + " s"
+         + (totals.unchanged > 0 ? ", " + juce::String (totals.unchanged) + " unchanged scores skipped\n" : juce::String ("\n"))
+         + juce::String (totals.files / seconds, 1) + " scores/s, "
+         + juce::String (static_cast<double>(totals.bytes) / (1024.0 * 1024.0) / seconds, 1) + " MB/s, "
+         + juce::String (static_cast<double>(totals.sonorities) / seconds, 0) + " sonorities/s";
+}
+
+int CorpusAnnotator::runFromCommandLine (const juce::String& commandLine)
+{
+    auto arguments = juce::StringArray::fromTokens (commandLine, true);
+    juce::StringArray paths;
+    juce::File outputFolder, indexFile;
+    int numThreads = juce::SystemStats::getNumCpus();
+    bool smooth = false;
+
+    for (int i = 0; i < arguments.size(); ++i)
+    {
+        auto argument = arguments[i].unquoted();
+        if (argument == "--annotate")
+        {
+            continue;
+        }
+        if (argument == "--out" && i + 1 < arguments.size())
+        {
+            outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile (arguments[++i].unquoted());
+        } else if (argument == "--index" && i + 1 < arguments.size())
+        {
+            indexFile = juce::File::getCurrentWorkingDirectory().getChildFile (arguments[++i].unquoted());
+        } else if (argument == "--threads" && i + 1 < arguments.size())
+        {
+            numThreads = arguments[++i].getIntValue();
+        } else if (argument == "--smooth")
+        {
+            smooth = true;
+        } else
+        {
+            paths.add (argument);
+        }
+    }
+
+    if (paths.isEmpty())
+    {
+        std::cerr << "Usage: --annotate <scores or folders...> [--out <folder>] [--index <file>] [--smooth] [--threads <n>]" << std::endl;
+        return 1;
+    }
+
+    auto totals = annotate (paths, outputFolder, indexFile, smooth, numThreads);
+    std::cout << describe (totals).toStdString() << std::endl;
+    return totals.failed > 0 || totals.files + totals.unchanged == 0 ? 1 : 0;
+}
+
+int CorpusAnnotator::runQueryFromCommandLine (const juce::String& commandLine)
+{
+    auto arguments = juce::StringArray::fromTokens (commandLine, true);
+    juce::String text;
+    juce::File indexFile;
+    bool major = true, minor = true;
+    size_t maxHits = 100;
+
+    for (int i = 0; i < arguments.size(); ++i)
+    {
+        auto argument = arguments[i].unquoted();
+        if (argument == "--query" && i + 1 < arguments.size())
+        {
+            text = arguments[++i].unquoted();
+        } else if (argument == "--index" && i + 1 < arguments.size())
+        {
+            indexFile = juce::File::getCurrentWorkingDirectory().getChildFile (arguments[++i].unquoted());
+        } else if (argument == "--max" && i + 1 < arguments.size())
+        {
+            maxHits = static_cast<size_t>(juce::jmax (1, arguments[++i].getIntValue()));
+        } else if (argument == "--major")
+        {
+            minor = false;
+        } else if (argument == "--minor")
+        {
+            major = false;
+        }
+    }
+
+    if (text.isEmpty() || ! indexFile.existsAsFile())
+    {
+        std::cerr << "Usage: --query \"<numerals>\" --index <file> [--major | --minor] [--max <n>]" << std::endl;
+        return 1;
+    }
+
+    // the index is read in place, only the pages the query touches are loaded
+    juce::MemoryMappedFile mapping (indexFile, juce::MemoryMappedFile::readOnly);
+    ProgressionIndex index (mapping.getData(), mapping.getSize());
+    if (! index.isValid())
+    {
+        std::cerr << "Couldn't read " << indexFile.getFullPathName().toStdString() << std::endl;
+        return 1;
+    }
+
+    const double start = juce::Time::getMillisecondCounterHiRes();
+    std::vector<ProgressionIndex::Hit> hits;
+    for (auto mode : {true, false})
+    {
+        if (! (mode ? major : minor))
+        {
+            continue;
+        }
+        std::vector<ProgressionIndex::QueryToken> query;
+        if (! ProgressionIndex::parseQuery (text.toStdString(), mode, query))
+        {
+            std::cerr << "Couldn't parse " << text.toStdString() << std::endl;
+            return 1;
+        }
+        auto found = index.find (query, maxHits);
+        hits.insert (hits.end(), found.begin(), found.end());
+    }
+    std::sort (hits.begin(), hits.end(), [] (const ProgressionIndex::Hit& a, const ProgressionIndex::Hit& b)
+    {
+        return a.document != b.document ? a.document < b.document : a.position < b.position;
+    });
+    if (hits.size() > maxHits)
+    {
+        hits.resize (maxHits);
+    }
+    const double milliseconds = juce::Time::getMillisecondCounterHiRes() - start;
+
+    for (auto& hit : hits)
+    {
+        std::cout << index.getDocumentPath (hit.document) << "  m. " << hit.measure << std::endl;
+    }
+    std::cout << hits.size() << (hits.size() == maxHits ? "+" : "") << " matches in " << index.getNumDocuments() << " scores ("
+              << index.getNumTokens() << " chords) in " << juce::String (milliseconds, 2).toStdString() << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Batch mode: annotates a corpus of MusicXML scores with roman numerals, without opening a
+    window.
+
+    Every score (.musicxml, .xml, or compressed .mxl) is streamed through a MusicXmlAnnotator
+    on a thread pool, and its sonorities are written next to it as <name>.<ext>.chords.csv, or
+    into an output folder under the same relative path. Scores are independent so the only
+    shared state is the totals.
+
+    With an index file the chord sequences are also added to a ProgressionIndex. Updating an
+    existing index only analyses the scores that are new or changed since it was written, the
+    rest are copied over from the old index.
+*/
+namespace CorpusAnnotator
+{
+    struct Totals
+    {
+        int files = 0;
+        int failed = 0;
+        juce::int64 bytes = 0;
+        juce::int64 notes = 0;
+        juce::int64 sonorities = 0;
+        juce::int64 identified = 0;
+        // scores left out because the index already had them
+        int unchanged = 0;
+        double seconds = 0.0;
+    };
+
+    // paths can be scores or folders, which are searched recursively
+    // outputFolder can be File() to write each output next to its score
+    // indexFile can be File() to skip indexing, otherwise it is created or updated
+    // smooth decodes each score with a HarmonicDecoder instead of identifying every sonority on its own
+    Totals annotate (const juce::StringArray& paths, const juce::File& outputFolder, const juce::File& indexFile, bool smooth, int numThreads);
+
+    // files per second, megabytes per second and sonorities per second
+    juce::String describe (const Totals& totals);
+
+    // handles "--annotate <paths...> [--out <folder>] [--index <file>] [--smooth] [--threads <n>]",
+    // printing progress to stdout, and returns the exit code
+    int runFromCommandLine (const juce::String& commandLine);
+
+    // handles "--query <numerals> --index <file> [--major | --minor] [--max <n>]", printing every
+    // match to stdout, and returns the exit code
+    int runQueryFromCommandLine (const juce::String& commandLine);
+}
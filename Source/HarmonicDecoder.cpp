@@ -0,0 +1,293 @@
+#include "HarmonicDecoder.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // pitch classes above the root of each quality: major, minor, augmented and diminished
+    // triads, then dominant, diminished, half diminished and minor sevenths
+    const int qualityTones[HarmonicDecoder::numQualities][4] =
+    {
+        {0, 4, 7, -1}, {0, 3, 7, -1}, {0, 4, 8, -1}, {0, 3, 6, -1},
+        {0, 4, 7, 10}, {0, 3, 6, 9}, {0, 3, 6, 10}, {0, 3, 7, 10}
+    };
+
+    // probability of each chord tone sounding, and of each other pitch class sounding, so both a
+    // missing chord tone and a tone outside the chord cost log (0.9 / 0.1) = 2.2 per quarter note
+    const float chordToneProbability = 0.9f;
+    const float otherToneProbability = 0.1f;
+
+    // a change costs log 2 = 0.7, and a chord in between two others pays it twice, so a chord
+    // one tone away from its neighbours is kept from a quarter note up, and shorter ones (passing
+    // and neighbour tones) are absorbed into the chord around them
+    const float logStay = std::log (0.5f);
+    const float logChange = std::log (0.25f);
+
+    // chords with tones outside the scale of the key (harmonic minor for minor keys)
+    const float logChromatic = std::log (0.3f);
+
+    const int numLanes = 8;
+
+    // low enough that no path can come from it, without the infinities
+    const float impossible = -1.0e30f;
+
+    int getMask (int quality)
+    {
+        int mask = 0;
+        for (auto tone : qualityTones[quality])
+        {
+            if (tone >= 0)
+            {
+                mask |= 1 << tone;
+            }
+        }
+        return mask;
+    }
+
+    struct Tables
+    {
+        // log odds of each pitch class sounding for every state, pitch class first so that one
+        // pitch class is a contiguous row over the states
+        float emissions[12][HarmonicDecoder::numStates];
+        // log probability of every state when nothing sounds, which the log odds are added to
+        float silence[HarmonicDecoder::numStates];
+        // log prior of every state in keys 1-30, row 0 is for an unknown key
+        float priors[ChordAnalysis::numKeys + 1][HarmonicDecoder::numStates];
+    };
+
+    const Tables& getTables()
+    {
+        static const Tables tables = []
+        {
+            Tables t;
+            for (int state = 0; state < HarmonicDecoder::numStates; ++state)
+            {
+                const int root = state / HarmonicDecoder::numQualities;
+                const int mask = getMask (state % HarmonicDecoder::numQualities);
+                t.silence[state] = 0.0f;
+                for (int pitchClass = 0; pitchClass < 12; ++pitchClass)
+                {
+                    const bool chordTone = (mask >> ((pitchClass - root + 12) % 12)) & 1;
+                    const float probability = chordTone ? chordToneProbability : otherToneProbability;
+                    t.emissions[pitchClass][state] = std::log (probability / (1.0f - probability));
+                    t.silence[state] += std::log (1.0f - probability);
+                }
+
+                t.priors[0][state] = 0.0f;
+                for (int key = 1; key <= ChordAnalysis::numKeys; ++key)
+                {
+                    const int scale = ChordAnalysis::isMajor (key) ? 0xab5 : 0x9ad;
+                    const int tonic = ChordAnalysis::getTonic (key);
+                    bool diatonic = true;
+                    for (int i = 0; i < 12; ++i)
+                    {
+                        if ((mask >> i) & 1)
+                        {
+                            diatonic = diatonic && ((scale >> ((root + i - tonic + 12) % 12)) & 1);
+                        }
+                    }
+                    t.priors[key][state] = diatonic ? 0.0f : logChromatic;
+                }
+            }
+            return t;
+        }();
+        return tables;
+    }
+}
+
+//==============================================================================
+HarmonicDecoder::HarmonicDecoder (int w, int l)
+  : windowSize (std::max (w, 2)), lag (std::min (std::max (l, 0), windowSize - 1)),
+    frames (static_cast<size_t>(windowSize)),
+    backPointers (static_cast<size_t>(windowSize * numStates)),
+    path (static_cast<size_t>(windowSize))
+{
+    getTables();
+    scores.fill (0.0f);
+}
+
+void HarmonicDecoder::push (const Observation& observation, std::vector<ChordResult>& results)
+{
+    frames[static_cast<size_t>(numFrames)] = observation;
+    step (numFrames);
+    ++numFrames;
+    if (numFrames == windowSize)
+    {
+        decide (windowSize - lag, results);
+    }
+}
+
+void HarmonicDecoder::finish (std::vector<ChordResult>& results)
+{
+    decide (numFrames, results);
+    scores.fill (0.0f);
+}
+
+std::vector<ChordResult> HarmonicDecoder::decode (const std::vector<Observation>& observations)
+{
+    HarmonicDecoder decoder;
+    std::vector<ChordResult> results;
+    results.reserve (observations.size());
+    for (auto& observation : observations)
+    {
+        decoder.push (observation, results);
+    }
+    decoder.finish (results);
+    return results;
+}
+
+bool HarmonicDecoder::checkCalibration()
+{
+    const std::vector<std::vector<int>> progression =
+    {
+        {48, 64, 67, 72}, {53, 65, 69, 72}, {55, 65, 71, 74}, {48, 64, 67, 72},
+        {45, 64, 69, 72}, {50, 65, 69, 74}, {55, 62, 67, 71}, {48, 64, 67, 72}
+    };
+    const int key = ChordAnalysis::getKeyFromFifths (0, true);
+
+    for (float duration : {1.0f, 4.0f})
+    {
+        std::vector<Observation> observations;
+        for (auto& notes : progression)
+        {
+            Observation observation {};
+            observation.bass = notes.front();
+            observation.key = key;
+            for (auto note : notes)
+            {
+                observation.weights[static_cast<size_t>(note % 12)] = duration;
+            }
+            observations.push_back (observation);
+        }
+
+        auto results = decode (observations);
+        for (size_t i = 0; i < progression.size(); ++i)
+        {
+            if (results[i].getSymbolId() != ChordAnalysis::identify (progression[i], key).getSymbolId())
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void HarmonicDecoder::step (int index)
+{
+    auto& tables = getTables();
+    auto& observation = frames[static_cast<size_t>(index)];
+    auto& prior = tables.priors[observation.key >= 1 && observation.key <= ChordAnalysis::numKeys ? observation.key : 0];
+
+    // the frame counts as long as its longest pitch class, for which every pitch class is either
+    // sounding or not, so emissions start from silence and add the log odds of the ones sounding
+    // times their weights, in a local array so the compiler knows nothing else writes to it
+    const float frameWeight = *std::max_element (observation.weights.begin(), observation.weights.end());
+    alignas (32) float emissions[numStates];
+    for (int state = 0; state < numStates; ++state)
+    {
+        emissions[state] = prior[state] + tables.silence[state] * frameWeight;
+    }
+    for (int pitchClass = 0; pitchClass < 12; ++pitchClass)
+    {
+        const float weight = observation.weights[static_cast<size_t>(pitchClass)];
+        if (weight != 0.0f)
+        {
+            auto row = tables.emissions[pitchClass];
+            for (int state = 0; state < numStates; ++state)
+            {
+                emissions[state] += row[state] * weight;
+            }
+        }
+    }
+
+    // the max is taken in lanes, so that it is a vector max instead of a chain of compares
+    alignas (32) float lanes[numLanes];
+    std::copy (scores.begin(), scores.begin() + numLanes, lanes);
+    for (int state = numLanes; state < numStates; state += numLanes)
+    {
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            lanes[lane] = std::max (lanes[lane], scores[static_cast<size_t>(state + lane)]);
+        }
+    }
+    const float offset = *std::max_element (lanes, lanes + numLanes);
+    int best = 0;
+    while (scores[static_cast<size_t>(best)] != offset)
+    {
+        ++best;
+    }
+
+    // every state either stays, or changes from the best one, scores are kept relative to the best
+    // so they never drift out of the range of a float
+    auto back = backPointers.data() + index * numStates;
+    for (int state = 0; state < numStates; ++state)
+    {
+        const float stay = scores[static_cast<size_t>(state)] - offset + logStay;
+        scores[static_cast<size_t>(state)] = std::max (stay, logChange) + emissions[state];
+        back[state] = static_cast<uint8_t>(stay >= logChange ? state : best);
+    }
+}
+
+void HarmonicDecoder::decide (int count, std::vector<ChordResult>& results)
+{
+    if (numFrames == 0)
+    {
+        return;
+    }
+
+    int state = 0;
+    for (int s = 1; s < numStates; ++s)
+    {
+        state = scores[static_cast<size_t>(s)] > scores[static_cast<size_t>(state)] ? s : state;
+    }
+
+    for (int i = numFrames - 1; i >= 0; --i)
+    {
+        path[static_cast<size_t>(i)] = static_cast<uint8_t>(state);
+        state = backPointers[static_cast<size_t>(i * numStates + state)];
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        results.push_back (toResult (path[static_cast<size_t>(i)], frames[static_cast<size_t>(i)]));
+    }
+    const int previousState = path[static_cast<size_t>(count - 1)];
+
+    // the undecided frames are decoded again, starting from the last decided state
+    std::move (frames.begin() + count, frames.begin() + numFrames, frames.begin());
+    numFrames -= count;
+    scores.fill (impossible);
+    scores[static_cast<size_t>(previousState)] = 0.0f;
+    for (int i = 0; i < numFrames; ++i)
+    {
+        step (i);
+    }
+}
+
+ChordResult HarmonicDecoder::toResult (int state, const Observation& observation) const
+{
+    bool sounding = false;
+    for (auto weight : observation.weights)
+    {
+        sounding = sounding || weight > 0.0f;
+    }
+    if (! sounding)
+    {
+        return {};
+    }
+
+    // the bass is only used if it is a chord tone, otherwise the chord is in root position
+    const int root = state / numQualities;
+    const int mask = getMask (state % numQualities);
+    int bass = observation.bass >= 0 && ((mask >> ((observation.bass - root + 12) % 12)) & 1) ? observation.bass : root;
+
+    uint16_t intervalMask = 0;
+    for (int i = 1; i < 12; ++i)
+    {
+        if ((mask >> ((bass - root + i + 12) % 12)) & 1)
+        {
+            intervalMask |= static_cast<uint16_t>(1 << i);
+        }
+    }
+    return ChordAnalysis::identify (intervalMask, bass, observation.key);
+}
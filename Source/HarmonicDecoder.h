@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "ChordAnalysis.h"
+
+//==============================================================================
+// Offline chord segmentation with a hidden Markov model, for analysing whole pieces where
+// identify() on every sonority is thrown off by passing tones and suspensions.
+//
+// The hidden states are chords (a root and one of eight root position qualities), observed
+// through the pitch classes sounding and for how long, with a prior favouring chords diatonic
+// to the key. Viterbi
+// decoding keeps every state's score in one flat array, so each frame is a small matrix
+// product and a branchless max over all states that the compiler can vectorise.
+//
+// Frames are decoded in windows of a fixed size, so a piece of any length uses the same
+// memory. The last frames of each window are decided again with the next one, so that chords
+// near the end of a window still see what comes after them.
+class HarmonicDecoder
+{
+public:
+    struct Observation
+    {
+        // how long each pitch class sounds in the frame, in quarter notes, all 0 for a rest
+        std::array<float, 12> weights;
+        // lowest sounding note, to choose the inversion
+        int bass;
+        // key number 1-30 for the prior and spelling, 0 if unknown
+        int key;
+    };
+
+    // windowSize frames are decoded at once, lag of them again with the next window
+    explicit HarmonicDecoder (int windowSize = 512, int lag = 64);
+
+    // adds a frame, and appends the results of any frames decided by it to results
+    void push (const Observation& observation, std::vector<ChordResult>& results);
+
+    // decides the remaining frames, after which the decoder can be used for a new piece
+    void finish (std::vector<ChordResult>& results);
+
+    // one result per observation
+    static std::vector<ChordResult> decode (const std::vector<Observation>& observations);
+
+    // returns true if I IV V7 I vi ii V I in C major, in quarter notes and in whole notes, decodes
+    // to the chords identify() gives for each of them, which the model's weights are tuned to keep
+    static bool checkCalibration();
+
+    static const int numQualities = 8;
+    static const int numStates = 12 * numQualities;
+
+private:
+    // runs one Viterbi step for the frame at index
+    void step (int index);
+
+    // follows the back pointers, appends the first count frames of the window to results and
+    // decodes the rest again from the last of them
+    void decide (int count, std::vector<ChordResult>& results);
+
+    ChordResult toResult (int state, const Observation& observation) const;
+
+    const int windowSize, lag;
+
+    // observations and back pointers of the current window
+    std::vector<Observation> frames;
+    std::vector<uint8_t> backPointers;
+    std::vector<uint8_t> path;
+    int numFrames = 0;
+
+    alignas (32) std::array<float, numStates> scores;
+};
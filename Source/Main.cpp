@@ -8,6 +8,14 @@
 
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "ClassroomComponent.h"
+#include "ChordWebServer.h"
+#include "CorpusAnnotator.h"
+#include "SharedMemoryOutput.h"
+#include "Trace.h"
+#include "VoicingCommand.h"
+#include <fstream>
+#include <iostream>
 
 //==============================================================================
 class ChordIdentifierApplication : public juce::JUCEApplication
@@ -20,19 +28,130 @@ public:
     const juce::String getApplicationVersion() override    { return ProjectInfo::versionString; }
 
     //==============================================================================
-    void initialise (const juce::String& /*commandLine*/) override
+    void initialise (const juce::String& commandLine) override
     {
         // This method is where you should put your application's initialisation code..
 
+        // --annotate runs the batch annotator over a corpus of scores and quits without a window
+        if (commandLine.contains ("--annotate"))
+        {
+            setApplicationReturnValue (CorpusAnnotator::runFromCommandLine (commandLine));
+            quit();
+            return;
+        }
+
+        // --query searches an index written by --annotate --index
+        if (commandLine.contains ("--query"))
+        {
+            setApplicationReturnValue (CorpusAnnotator::runQueryFromCommandLine (commandLine));
+            quit();
+            return;
+        }
+
+        // --voicings prints the voicings of a numeral, e.g. --voicings "V65 in Eb major"
+        if (commandLine.contains ("--voicings"))
+        {
+            setApplicationReturnValue (VoicingCommand::runFromCommandLine (commandLine));
+            quit();
+            return;
+        }
+
+        // --trace [file] records where the time goes from each note to the screen, and writes it
+        // on quit as a trace that Perfetto (ui.perfetto.dev) or chrome://tracing can open
+        if (commandLine.contains ("--trace"))
+        {
+            auto arguments = juce::StringArray::fromTokens (commandLine, true);
+            auto name = arguments[arguments.indexOf ("--trace") + 1].unquoted();
+            traceFile = juce::File::getCurrentWorkingDirectory().getChildFile (name.isEmpty() || name.startsWith ("--") ? "chordid-trace.json" : name);
+            Trace::setThreadName ("Message thread");
+            Trace::setEnabled (true);
+        }
+
         juce::LookAndFeel::getDefaultLookAndFeel().setDefaultSansSerifTypeface (customLookAndFeel.getCustomFont().getTypeface());
-        mainWindow.reset (new MainWindow (getApplicationName()));
+        
+        // --classroom shows every connected keyboard at once instead of a single one
+        // --alsa reads them from the ALSA sequencer on a realtime thread (Linux only)
+        // --http [port] also serves the chords to browsers on the network (Linux only)
+        // --shm [name] also publishes them to a shared memory segment for other programs (see chordid_shm.h)
+        if (commandLine.contains ("--classroom"))
+        {
+            auto classroom = new ClassroomComponent (commandLine.contains ("--alsa"));
+            mainWindow.reset (new MainWindow (getApplicationName(), classroom));
+            auto& server = classroom->getServer();
+            juce::StringArray names;
+            for (int i = 0; i < server.getNumSessions(); ++i)
+            {
+                names.add (server.getSessionName (i));
+               #if JUCE_LINUX
+                webServer.addSource (server.getSessionName (i), server.getSession (i).getPublisher());
+               #endif
+            }
+           #if JUCE_LINUX || JUCE_MAC
+            if (openSharedMemory (commandLine, names))
+            {
+                for (int i = 0; i < sharedMemory.getNumSlots(); ++i)
+                {
+                    server.setSharedSlot (i, sharedMemory.getSlot (i));
+                }
+            }
+           #endif
+        }
+        else
+        {
+            auto keyboard = new MainComponent();
+            mainWindow.reset (new MainWindow (getApplicationName(), keyboard));
+           #if JUCE_LINUX
+            webServer.addSource ("Keyboard", keyboard->getPublisher());
+           #endif
+           #if JUCE_LINUX || JUCE_MAC
+            if (openSharedMemory (commandLine, { "Keyboard" }))
+            {
+                keyboard->setSharedSlot (sharedMemory.getSlot (0));
+            }
+           #endif
+        }
+
+       #if JUCE_LINUX
+        if (commandLine.contains ("--http"))
+        {
+            auto arguments = juce::StringArray::fromTokens (commandLine, true);
+            auto port = arguments[arguments.indexOf ("--http") + 1].getIntValue();
+            if (webServer.start (port > 0 ? port : ChordWebServer::defaultPort))
+            {
+                std::cout << "Serving chords on http://localhost:" << webServer.getPort() << "/" << std::endl;
+            } else
+            {
+                std::cerr << "Couldn't listen on port " << (port > 0 ? port : ChordWebServer::defaultPort) << std::endl;
+            }
+        }
+       #endif
     }
 
     void shutdown() override
     {
         // Add your application's shutdown code here..
 
+       #if JUCE_LINUX
+        // the publishers it reads belong to the window
+        webServer.stop();
+       #endif
         mainWindow = nullptr; // (deletes our window)
+       #if JUCE_LINUX || JUCE_MAC
+        // only once nothing publishes to it
+        sharedMemory.close();
+       #endif
+        if (traceFile != juce::File())
+        {
+            Trace::setEnabled (false);
+            std::ofstream out (traceFile.getFullPathName().toStdString());
+            if (Trace::write (out))
+            {
+                std::cout << "Wrote trace to " << traceFile.getFullPathName().toStdString() << std::endl;
+            } else
+            {
+                std::cerr << "Couldn't write trace to " << traceFile.getFullPathName().toStdString() << std::endl;
+            }
+        }
     }
 
     //==============================================================================
@@ -46,19 +165,19 @@ public:
     //==============================================================================
     /*
         This class implements the desktop window that contains an instance of
-        our MainComponent class.
+        our MainComponent class (or ClassroomComponent in classroom mode).
     */
     class MainWindow : public juce::DocumentWindow
     {
     public:
-        MainWindow (juce::String name)
+        MainWindow (juce::String name, juce::Component* content)
             : DocumentWindow (name,
                               juce::Desktop::getInstance().getDefaultLookAndFeel()
                                                           .findColour (juce::ResizableWindow::backgroundColourId),
                               DocumentWindow::allButtons)
         {
             setUsingNativeTitleBar (true);
-            setContentOwned (new MainComponent(), true);
+            setContentOwned (content, true);
 
            #if JUCE_IOS || JUCE_ANDROID
             setFullScreen (true);
@@ -91,7 +210,41 @@ public:
     };
 
 private:
+   #if JUCE_LINUX || JUCE_MAC
+    // returns true if --shm was given and the segment could be created
+    bool openSharedMemory (const juce::String& commandLine, const juce::StringArray& names)
+    {
+        if (! commandLine.contains ("--shm"))
+        {
+            return false;
+        }
+        auto arguments = juce::StringArray::fromTokens (commandLine, true);
+        auto name = arguments[arguments.indexOf ("--shm") + 1];
+        if (! name.startsWith ("/"))
+        {
+            name = CHORDID_SHM_NAME;
+        }
+        if (! sharedMemory.open (name, names))
+        {
+            std::cerr << "Couldn't create shared memory " << name.toStdString() << std::endl;
+            return false;
+        }
+        std::cout << "Publishing chords to shared memory " << name.toStdString() << std::endl;
+        return true;
+    }
+
+    // destroyed after the window, whose publishers write to it
+    SharedMemoryOutput sharedMemory;
+   #endif
+
     std::unique_ptr<MainWindow> mainWindow;
+
+    // written on quit if --trace was given
+    juce::File traceFile;
+
+   #if JUCE_LINUX
+    ChordWebServer webServer;
+   #endif
     
     class CustomFontLookAndFeel : public juce::LookAndFeel_V4
     {
@@ -1,8 +1,11 @@
 #include "MainComponent.h"
+#include "ScoreExporter.h"
+#include "StatisticsComponent.h"
+#include <fstream>
 
 //==============================================================================
 MainComponent::MainComponent()
-  : keyboardComponent (keyboardState, juce::MidiKeyboardComponent::horizontalKeyboard)
+  : keyboardComponent (keyboardState)
 {
     setOpaque (true);
     
@@ -42,18 +45,45 @@ MainComponent::MainComponent()
     
     addAndMakeVisible (keyList);
     keyList.setTextWhenNothingSelected ("--");
-    // add all keys to list
-    for (int i = 0; i < keyArray.size(); ++i)
-    {
-        keyList.addItem (keyArray[i], i + 1);
-        if (i == 15)
-        {
-            keyList.addSeparator();
-        }
-    }
+    ChordComponent::fillKeyList (keyList);
     
     addAndMakeVisible (chordBox);
-    keyList.onChange = [this] { chordBox.setKey(keyList.getSelectedId()); };
+    keyList.onChange = [this]
+    {
+        chordBox.setKey(keyList.getSelectedId());
+        keyboardComponent.setChord ({}, {}, chordBox.getKey());
+        double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+        publisher.publish (now, chordBox.getNotes(), {}, chordBox.getKey(), -1);
+        // closes the time of the chord held in the old key, so it isn't counted in the new one
+        statistics.record (now, {}, static_cast<int>(chordBox.getNotes().size()), chordBox.getKey());
+        progressionLabel.setText ({}, juce::dontSendNotification);
+        secondaryLabel.setText ({}, juce::dontSendNotification);
+        updatePivots();
+    };
+    
+    addAndMakeVisible (progressionLabel);
+    progressionLabel.setJustificationType (juce::Justification::centred);
+    progressionLabel.setColour (juce::Label::textColourId, juce::Colours::cornflowerblue);
+    addAndMakeVisible (pivotLabel);
+    pivotLabel.setJustificationType (juce::Justification::centred);
+    addAndMakeVisible (secondaryLabel);
+    secondaryLabel.setJustificationType (juce::Justification::centred);
+    secondaryLabel.setColour (juce::Label::textColourId, juce::Colours::orange);
+    
+    chordBox.onProgression = [this] (const juce::String& name)
+    {
+        progressionLabel.setText (name, juce::dontSendNotification);
+    };
+    chordBox.onSecondaryFunction = [this] (const juce::String& text)
+    {
+        secondaryLabel.setText (text, juce::dontSendNotification);
+    };
+    // user defined progressions are read from the app data folder if the file exists
+    auto progressionsFile = ChordComponent::getUserProgressionsFile();
+    if (progressionsFile.existsAsFile())
+    {
+        chordBox.loadProgressions (progressionsFile);
+    }
     
     addAndMakeVisible (keyboardComponent);
     keyboardComponent.setOctaveForMiddleC (4);
@@ -61,11 +91,87 @@ MainComponent::MainComponent()
     keyboardComponent.setColour (juce::MidiKeyboardComponent::mouseOverKeyOverlayColourId, juce::Colours::lightsteelblue);
     keyboardState.addListener (this);
     
+    addAndMakeVisible (recordButton);
+    recordButton.onClick = [this]
+    {
+        // starting a new recording discards the previous one
+        if (! recorder.isRecording())
+        {
+            recorder.clear();
+        }
+        recorder.setRecording (! recorder.isRecording());
+        recordButton.setButtonText (recorder.isRecording() ? "Stop" : "Record");
+    };
+    
+    addAndMakeVisible (exportButton);
+    exportButton.onClick = [this]
+    {
+        exportChooser = std::make_unique<juce::FileChooser> ("Export session",
+                                                             juce::File::getSpecialLocation (juce::File::userDocumentsDirectory).getChildFile ("session.musicxml"),
+                                                             "*.musicxml;*.xml;*.ly");
+        exportChooser->launchAsync (juce::FileBrowserComponent::saveMode
+                                    | juce::FileBrowserComponent::canSelectFiles
+                                    | juce::FileBrowserComponent::warnAboutOverwriting,
+                                    [this] (const juce::FileChooser& chooser)
+        {
+            if (chooser.getResult() != juce::File())
+            {
+                exportSession (chooser.getResult());
+            }
+        });
+    };
+    
+    addAndMakeVisible (statisticsButton);
+    statisticsButton.onClick = [this]
+    {
+        if (statisticsWindow != nullptr)
+        {
+            statisticsWindow->toFront (true);
+            return;
+        }
+        statisticsWindow = StatisticsComponent::show ("Session statistics", statistics, [this] { return chordBox.getKey(); });
+    };
+    
+    addAndMakeVisible (predictButton);
+    predictButton.onClick = [this] { chordBox.setPredicting (predictButton.getToggleState()); };
+    
+    addAndMakeVisible (arpeggioButton);
+    arpeggioButton.onClick = [this]
+    {
+        // the notes shown are from the other mode, so start again from nothing
+        arpeggioTimer.stopTimer();
+        arpeggio.reset();
+        chordBox.setNotes ({});
+        keyboardComponent.setChord (chordBox.getNotes(), chordBox.getResult(), chordBox.getKey());
+    };
+    
+    // slower arpeggios need a longer window, but the previous chord lingers for as long
+    addAndMakeVisible (arpeggioWindowSlider);
+    arpeggioWindowSlider.setRange (100.0, 2000.0, 50.0);
+    arpeggioWindowSlider.setTextValueSuffix (" ms");
+    arpeggioWindowSlider.setTextBoxStyle (juce::Slider::TextBoxRight, false, 70, 24);
+    arpeggioWindowSlider.setValue (DEFAULT_ARPEGGIO_WINDOW_MS, juce::dontSendNotification);
+    arpeggioWindowSlider.onValueChange = [this] { arpeggio.setWindow (arpeggioWindowSlider.getValue() * 0.001); };
+    
+    onsetGrouper.setWindow (DEFAULT_ONSET_WINDOW_MS * 0.001);
+    noteGroup.reserve (32);
+    arpeggio.setWindow (DEFAULT_ARPEGGIO_WINDOW_MS * 0.001);
+    arpeggioNotes.reserve (12);
+    // a bend on an MPE master channel can move every held note
+    trackedEvents.reserve (256);
+    
     setSize (600, 400);
 }
 
 MainComponent::~MainComponent()
 {
+    stopTimer();
+    arpeggioTimer.stopTimer();
+    // the dashboard reads our statistics, so it can't outlive us
+    if (statisticsWindow != nullptr)
+    {
+        delete statisticsWindow.getComponent();
+    }
     setLookAndFeel (nullptr);
     keyboardState.removeListener (this);
     deviceManager.removeMidiInputDeviceCallback (juce::MidiInput::getAvailableDevices()[midiInputList.getSelectedItemIndex()].identifier, this);
@@ -73,6 +179,7 @@ MainComponent::~MainComponent()
 
 void MainComponent::paint (juce::Graphics& g)
 {
+    TRACE_SCOPE ("MainComponent::paint");
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
 }
@@ -85,6 +192,12 @@ void MainComponent::resized()
 
     midiInputList.setBounds (80, 0, 120, 24);
     keyList.setBounds (250, 0, 85, 24);
+    recordButton.setBounds (345, 0, 70, 24);
+    exportButton.setBounds (420, 0, 70, 24);
+    statisticsButton.setBounds (495, 0, 60, 24);
+    predictButton.setBounds (5, 28, 90, 24);
+    arpeggioButton.setBounds (100, 28, 90, 24);
+    arpeggioWindowSlider.setBounds (190, 28, 220, 24);
     
     // keyboardComponent takes up 20% of the window
     keyboardComponent.setBoundsRelative (0.0f, 0.8f, 1.0f, 0.2f);
@@ -99,6 +212,27 @@ void MainComponent::resized()
     int boxWidth = static_cast<int>(area.getWidth() * 0.4267);
     int boxHeight = static_cast<int>(area.getHeight() * 0.35);
     chordBox.setBounds (startWidth, startHeight, boxWidth, boxHeight);
+    
+    // above the chord, clear of the buttons
+    int secondaryHeight = static_cast<int>(area.getHeight() * 0.08);
+    secondaryLabel.setBounds (0, chordBox.getY() - secondaryHeight, area.getWidth(), secondaryHeight);
+    secondaryLabel.setFont (juce::Font (secondaryLabel.getHeight() * 0.6f, juce::Font::plain));
+    
+    progressionLabel.setBounds (0, chordBox.getBottom(), area.getWidth(), static_cast<int>(area.getHeight() * 0.1));
+    progressionLabel.setFont (juce::Font (progressionLabel.getHeight() * 0.6f, juce::Font::plain));
+    
+    pivotLabel.setBounds (0, progressionLabel.getBottom(), area.getWidth(), static_cast<int>(area.getHeight() * 0.08));
+    pivotLabel.setFont (juce::Font (pivotLabel.getHeight() * 0.6f, juce::Font::plain));
+}
+
+const ChordPublisher& MainComponent::getPublisher() const
+{
+    return publisher;
+}
+
+void MainComponent::setSharedSlot (chordid_shm_slot* slot)
+{
+    publisher.setSharedSlot (slot);
 }
 
 //==============================================================================
@@ -125,9 +259,13 @@ void MainComponent::setMidiInput (int index)
 // These methods handle callbacks from the midi device + on-screen keyboard..
 void MainComponent::handleIncomingMidiMessage (juce::MidiInput* /*source*/, const juce::MidiMessage& message)
 {
+    if (Trace::isEnabled())
+    {
+        Trace::setThreadName ("MIDI input");
+    }
+    TRACE_SCOPE ("handleIncomingMidiMessage");
     const juce::ScopedValueSetter<bool> scopedInputFlag (isAddingFromMidiInput, true);
-    keyboardState.processNextMidiEvent (message);
-    postMessage (message);
+    trackMessage (message, true);
 }
 
 void MainComponent::handleNoteOn (juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity)
@@ -135,7 +273,8 @@ void MainComponent::handleNoteOn (juce::MidiKeyboardState*, int midiChannel, int
     if (! isAddingFromMidiInput)
     {
         auto m = juce::MidiMessage::noteOn (midiChannel, midiNoteNumber, velocity);
-        postMessage (m);
+        m.setTimeStamp (juce::Time::getMillisecondCounterHiRes() * 0.001);
+        trackMessage (m, false);
     }
 }
 
@@ -144,28 +283,173 @@ void MainComponent::handleNoteOff (juce::MidiKeyboardState*, int midiChannel, in
     if (! isAddingFromMidiInput)
     {
         auto m = juce::MidiMessage::noteOff (midiChannel, midiNoteNumber);
+        m.setTimeStamp (juce::Time::getMillisecondCounterHiRes() * 0.001);
+        trackMessage (m, false);
+    }
+}
+
+void MainComponent::trackMessage (const juce::MidiMessage& message, bool fromInput)
+{
+    const juce::SpinLock::ScopedLockType lock (trackerLock);
+    
+    // pitch bends that stay within a semitone end here, without posting anything
+    trackedEvents.clear();
+    if (! noteTracker.process (message.getRawData(), message.getRawDataSize(), message.getTimeStamp(), trackedEvents))
+    {
+        return;
+    }
+    
+    for (auto& event : trackedEvents)
+    {
+        auto m = event.on ? juce::MidiMessage::noteOn (1, event.note, (juce::uint8) 100)
+                          : juce::MidiMessage::noteOff (1, event.note);
+        m.setTimeStamp (event.time);
+        // the keyboard shows bent notes where they sound
+        if (fromInput)
+        {
+            keyboardState.processNextMidiEvent (m);
+        }
         postMessage (m);
     }
 }
 
 void MainComponent::postMessage (const juce::MidiMessage& message)
 {
-    (new IncomingMessageCallback (this, message))->post();
+    TRACE_SCOPE ("postMessage");
+    uint64_t flow = 0;
+    if (Trace::isEnabled())
+    {
+        flow = Trace::getNextFlowId();
+        Trace::addFlowStart ("note", flow);
+    }
+    (new IncomingMessageCallback (this, message, flow))->post();
 }
 
 void MainComponent::addMessage (const juce::MidiMessage& message)
 {
+    TRACE_SCOPE ("addMessage");
     // return if key is not set
     if (chordBox.getKey() == 0)
     {
         return;
     }
     
-    if (message.isNoteOn())
+    if (! message.isNoteOnOrOff())
+    {
+        return;
+    }
+    
+    // timestamps from the MIDI driver use the same clock as getMillisecondCounterHiRes()
+    NoteEvent event { message.getNoteNumber(), message.isNoteOn(), message.getTimeStamp() };
+    
+    // identified on the next frame, however many notes arrive before it
+    if (arpeggioButton.getToggleState())
+    {
+        arpeggio.add (event);
+        if (! arpeggioTimer.isTimerRunning())
+        {
+            arpeggioTimer.startTimerHz (60);
+        }
+        return;
+    }
+    
+    // an event outside the window of the pending group starts a new group
+    if (onsetGrouper.isDue (event.time))
     {
-        chordBox.addNote (message.getNoteNumber());
-    } else if (message.isNoteOff())
+        flushNotes();
+    }
+    onsetGrouper.add (event);
+    
+    if (onsetGrouper.getWindow() <= 0.0)
+    {
+        flushNotes();
+    } else if (! isTimerRunning())
+    {
+        timerCallback();
+    }
+}
+
+void MainComponent::timerCallback()
+{
+    double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+    if (onsetGrouper.isDue (now))
+    {
+        flushNotes();
+    }
+    
+    if (onsetGrouper.hasPending())
+    {
+        // wake up again when the pending group is due
+        startTimer (juce::jmax (1, juce::roundToInt ((onsetGrouper.getDeadline() - now) * 1000.0)));
+    } else
+    {
+        stopTimer();
+    }
+}
+
+void MainComponent::flushNotes()
+{
+    TRACE_SCOPE ("flushNotes");
+    onsetGrouper.flush (juce::Time::getMillisecondCounterHiRes() * 0.001, noteGroup);
+    chordBox.applyNotes (noteGroup);
+    keyboardComponent.setChord (chordBox.getNotes(), chordBox.getResult(), chordBox.getKey());
+    updatePivots();
+    if (! noteGroup.empty())
+    {
+        statistics.recordOnsets (onsetGrouper);
+        publisher.publish (noteGroup.front().time, chordBox.getNotes(), chordBox.getResult(), chordBox.getKey(), chordBox.getProgression());
+        statistics.record (noteGroup.front().time, chordBox.getResult(), static_cast<int>(chordBox.getNotes().size()), chordBox.getKey());
+        recorder.record (noteGroup.front().time, chordBox.getNotes(), chordBox.getResult(), chordBox.getKey());
+    }
+}
+
+void MainComponent::updateArpeggio()
+{
+    TRACE_SCOPE ("updateArpeggio");
+    double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+    arpeggio.getNotes (now, arpeggioNotes);
+    // nothing left to decay until the next note
+    if (arpeggioNotes.empty())
+    {
+        arpeggioTimer.stopTimer();
+    }
+    if (arpeggioNotes == chordBox.getNotes())
+    {
+        return;
+    }
+    
+    chordBox.setNotes (arpeggioNotes);
+    keyboardComponent.setChord (chordBox.getNotes(), chordBox.getResult(), chordBox.getKey());
+    updatePivots();
+    publisher.publish (now, chordBox.getNotes(), chordBox.getResult(), chordBox.getKey(), chordBox.getProgression());
+    statistics.record (now, chordBox.getResult(), static_cast<int>(chordBox.getNotes().size()), chordBox.getKey());
+    recorder.record (now, chordBox.getNotes(), chordBox.getResult(), chordBox.getKey());
+}
+
+void MainComponent::updatePivots()
+{
+    // one lookup gives the chord in every key, rather than identifying it again for each one
+    auto text = ChordAnalysis::getPivotText (ChordAnalysis::identifyInAllKeys (chordBox.getNotes()), chordBox.getKey());
+    pivotLabel.setText (juce::String (juce::CharPointer_UTF8 (text.c_str())), juce::dontSendNotification);
+}
+
+void MainComponent::exportSession (const juce::File& file)
+{
+    // a large buffer so that long sessions are written with few system calls
+    std::vector<char> buffer (1 << 16);
+    std::ofstream out;
+    out.rdbuf()->pubsetbuf (buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.open (file.getFullPathName().toStdString(), std::ios::binary);
+    
+    ScoreExporter::Options options;
+    options.title = file.getFileNameWithoutExtension().toStdString();
+    
+    bool written = file.hasFileExtension ("ly") ? ScoreExporter::writeLilyPond (recorder.getEntries(), out, options)
+                                                : ScoreExporter::writeMusicXml (recorder.getEntries(), out, options);
+    if (! written)
     {
-        chordBox.removeNote (message.getNoteNumber());
+        juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::WarningIcon, "Export failed",
+                                                recorder.getEntries().empty() ? "Nothing has been recorded yet."
+                                                                              : "Could not write " + file.getFullPathName());
     }
 }
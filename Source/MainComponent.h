@@ -1,11 +1,24 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "ArpeggioAccumulator.h"
 #include "ChordComponent.h"
+#include "ChordKeyboardComponent.h"
+#include "ChordPublisher.h"
+#include "MpeNoteTracker.h"
+#include "SessionRecorder.h"
+#include "SessionStatistics.h"
+#include "Trace.h"
 
 #define DEFAULT_KEYBOARD_WIDTH_PIXELS 1200
 #define DEFAULT_NUM_WHITE_KEYS 75
 
+// notes played within this many milliseconds of each other are identified together
+#define DEFAULT_ONSET_WINDOW_MS 20
+
+// in arpeggio mode, a note counts towards the chord for this many milliseconds after it was released
+#define DEFAULT_ARPEGGIO_WINDOW_MS 750
+
 //==============================================================================
 /*
     This component lives inside our window, and this is where you should put all
@@ -13,7 +26,8 @@
 */
 class MainComponent : public juce::Component,
                       private juce::MidiInputCallback,
-                      private juce::MidiKeyboardStateListener
+                      private juce::MidiKeyboardStateListener,
+                      private juce::Timer
 {
 public:
     //==============================================================================
@@ -24,6 +38,12 @@ public:
     void paint (juce::Graphics& g) override;
 
     void resized() override;
+    
+    // every identified chord is published here, for consumers on other threads
+    const ChordPublisher& getPublisher() const;
+
+    // mirrors them to shared memory as well, see ChordPublisher::setSharedSlot()
+    void setSharedSlot (chordid_shm_slot* slot);
 
 private:
     //==============================================================================
@@ -38,12 +58,14 @@ private:
     class IncomingMessageCallback : public juce::CallbackMessage
     {
     public:
-        IncomingMessageCallback(MainComponent* o, const juce::MidiMessage& m)
-          : owner (o), message (m)
+        IncomingMessageCallback(MainComponent* o, const juce::MidiMessage& m, uint64_t f)
+          : owner (o), message (m), flow (f)
         {}
         
         void messageCallback() override
         {
+            TRACE_SCOPE ("messageCallback");
+            Trace::addFlowEnd ("note", flow);
             if (owner != nullptr)
             {
                 owner->addMessage (message);
@@ -52,12 +74,47 @@ private:
         
         Component::SafePointer<MainComponent> owner;
         juce::MidiMessage message;
+        // links the message in a trace to the callback that posted it
+        uint64_t flow;
     };
     
+    // resolves MPE and pitch bend, posting only changes to the notes that are sounding
+    // fromInput is false for notes played on the on-screen keyboard, which shows them already
+    void trackMessage (const juce::MidiMessage& message, bool fromInput);
+    
     void postMessage (const juce::MidiMessage& message);
     
     void addMessage (const juce::MidiMessage& message);
     
+    void timerCallback() override;
+    
+    // sends the grouped note events to chordBox
+    void flushNotes();
+    
+    // sends the notes heard recently to chordBox, in arpeggio mode
+    void updateArpeggio();
+    
+    class ArpeggioTimer : public juce::Timer
+    {
+    public:
+        explicit ArpeggioTimer (MainComponent& o)
+          : owner (o)
+        {}
+        
+        void timerCallback() override
+        {
+            owner.updateArpeggio();
+        }
+        
+        MainComponent& owner;
+    };
+    
+    // shows the chord read in the keys closely related to the current one
+    void updatePivots();
+    
+    // writes the recording as MusicXML, or LilyPond if file has a .ly extension
+    void exportSession (const juce::File& file);
+    
     // Member variables
     juce::AudioDeviceManager deviceManager;
     juce::ComboBox midiInputList;
@@ -68,45 +125,48 @@ private:
     juce::ComboBox keyList;
     juce::Label keyListLabel;
     
-    // keys from 0-15 are sharp, 16-30 are flat
-    const juce::StringArray keyArray =
-    {
-        juce::String (juce::CharPointer_UTF8 ("C major")),
-        juce::String (juce::CharPointer_UTF8 ("a minor")),
-        juce::String (juce::CharPointer_UTF8 ("G major")),
-        juce::String (juce::CharPointer_UTF8 ("e minor")),
-        juce::String (juce::CharPointer_UTF8 ("D major")),
-        juce::String (juce::CharPointer_UTF8 ("b minor")),
-        juce::String (juce::CharPointer_UTF8 ("A major")),
-        juce::String (juce::CharPointer_UTF8 ("f\xe2\x99\xaf minor")),
-        juce::String (juce::CharPointer_UTF8 ("E major")),
-        juce::String (juce::CharPointer_UTF8 ("c\xe2\x99\xaf minor")),
-        juce::String (juce::CharPointer_UTF8 ("B major")),
-        juce::String (juce::CharPointer_UTF8 ("g\xe2\x99\xaf minor")),
-        juce::String (juce::CharPointer_UTF8 ("F\xe2\x99\xaf major")),
-        juce::String (juce::CharPointer_UTF8 ("d\xe2\x99\xaf minor")),
-        juce::String (juce::CharPointer_UTF8 ("C\xe2\x99\xaf major")),
-        juce::String (juce::CharPointer_UTF8 ("a\xe2\x99\xaf minor")),
-        juce::String (juce::CharPointer_UTF8 ("F major")),
-        juce::String (juce::CharPointer_UTF8 ("d minor")),
-        juce::String (juce::CharPointer_UTF8 ("B\xe2\x99\xad major")),
-        juce::String (juce::CharPointer_UTF8 ("g minor")),
-        juce::String (juce::CharPointer_UTF8 ("E\xe2\x99\xad major")),
-        juce::String (juce::CharPointer_UTF8 ("c minor")),
-        juce::String (juce::CharPointer_UTF8 ("A\xe2\x99\xad major")),
-        juce::String (juce::CharPointer_UTF8 ("f minor")),
-        juce::String (juce::CharPointer_UTF8 ("D\xe2\x99\xad major")),
-        juce::String (juce::CharPointer_UTF8 ("b\xe2\x99\xad minor")),
-        juce::String (juce::CharPointer_UTF8 ("G\xe2\x99\xad major")),
-        juce::String (juce::CharPointer_UTF8 ("e\xe2\x99\xad minor")),
-        juce::String (juce::CharPointer_UTF8 ("C\xe2\x99\xad major")),
-        juce::String (juce::CharPointer_UTF8 ("a\xe2\x99\xad minor"))
-    };
-    
     juce::MidiKeyboardState keyboardState;
-    juce::MidiKeyboardComponent keyboardComponent;
+    ChordKeyboardComponent keyboardComponent;
     
     ChordComponent chordBox;
     
+    // used from the MIDI thread and the message thread (on-screen keyboard)
+    MpeNoteTracker noteTracker;
+    std::vector<NoteEvent> trackedEvents;
+    juce::SpinLock trackerLock;
+    
+    OnsetGrouper onsetGrouper;
+    std::vector<NoteEvent> noteGroup;
+    
+    // arpeggio mode identifies the notes played recently instead of the ones held, once a frame
+    ArpeggioAccumulator arpeggio;
+    std::vector<int> arpeggioNotes;
+    ArpeggioTimer arpeggioTimer { *this };
+    juce::ToggleButton arpeggioButton { "Arpeggio" };
+    juce::Slider arpeggioWindowSlider { juce::Slider::LinearHorizontal, juce::Slider::TextBoxRight };
+    
+    ChordPublisher publisher;
+    
+    SessionStatistics statistics;
+    juce::TextButton statisticsButton { "Stats" };
+    juce::Component::SafePointer<juce::DialogWindow> statisticsWindow;
+    
+    SessionRecorder recorder;
+    juce::TextButton recordButton { "Record" };
+    juce::TextButton exportButton { "Export..." };
+    std::unique_ptr<juce::FileChooser> exportChooser;
+    
+    // shows what a chord being played could become before it is complete
+    juce::ToggleButton predictButton { "Predict" };
+    
+    // shows the cadence or progression completed by the last chord
+    juce::Label progressionLabel;
+    
+    // shows an applied chord once it resolves, e.g. "V⁶⁵/V"
+    juce::Label secondaryLabel;
+    
+    // shows the chord as a pivot, e.g. "vi in C = ii in G"
+    juce::Label pivotLabel;
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
 };
@@ -0,0 +1,290 @@
+#include "MpeNoteTracker.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // default bend ranges from the MPE specification (and the General MIDI default)
+    const double defaultBendRange = 2.0;
+    const double defaultMemberBendRange = 48.0;
+
+    // a note has to be bent this far past the half way point between two semitones before it
+    // changes, so a bend hovering around the boundary doesn't identify the chord over and over
+    const double hysteresis = 0.1;
+
+    // 127 in both bytes of an RPN means none is selected
+    const int nullRpn = 127;
+}
+
+//==============================================================================
+MpeNoteTracker::MpeNoteTracker()
+{
+    reset();
+}
+
+bool MpeNoteTracker::process (const uint8_t* data, int size, double time, std::vector<NoteEvent>& events)
+{
+    if (size < 2 || (data[0] & 0x80) == 0 || data[0] >= 0xf0)
+    {
+        return false;
+    }
+
+    const auto numEvents = events.size();
+    const int channel = data[0] & 0x0f;
+    const int value = size > 2 ? data[2] : 0;
+
+    switch (data[0] & 0xf0)
+    {
+        case 0x90:
+            if (value > 0)
+            {
+                noteOn (channel, data[1], time, events);
+                break;
+            }
+            // a note on with velocity 0 is a note off
+            noteOff (channel, data[1], time, events);
+            break;
+        case 0x80:
+            noteOff (channel, data[1], time, events);
+            break;
+        case 0xe0:
+            bend[static_cast<size_t>(channel)] = ((value << 7) | data[1]) - 8192;
+            bendChanged (channel, time, events);
+            break;
+        case 0xb0:
+            controller (channel, data[1], value, time, events);
+            break;
+        default:
+            break;
+    }
+
+    return events.size() != numEvents;
+}
+
+void MpeNoteTracker::reset()
+{
+    numNotes = 0;
+    effectiveCounts.fill (0);
+    bend.fill (0);
+    bendRange.fill (defaultBendRange);
+    rpnMsb.fill (nullRpn);
+    rpnLsb.fill (nullRpn);
+    lowerMembers = 0;
+    upperMembers = 0;
+}
+
+int MpeNoteTracker::getNumMemberChannels (bool lowerZone) const
+{
+    return lowerZone ? lowerMembers : upperMembers;
+}
+
+//==============================================================================
+int MpeNoteTracker::getMasterChannel (int channel) const
+{
+    if (channel >= 1 && channel <= lowerMembers)
+    {
+        return 0;
+    }
+    if (channel <= 14 && channel >= 15 - upperMembers)
+    {
+        return 15;
+    }
+    return -1;
+}
+
+double MpeNoteTracker::getPitch (int channel, int note) const
+{
+    double pitch = note + bend[static_cast<size_t>(channel)] / 8192.0 * bendRange[static_cast<size_t>(channel)];
+    int master = getMasterChannel (channel);
+    if (master >= 0)
+    {
+        pitch += bend[static_cast<size_t>(master)] / 8192.0 * bendRange[static_cast<size_t>(master)];
+    }
+    return pitch;
+}
+
+void MpeNoteTracker::noteOn (int channel, int note, double time, std::vector<NoteEvent>& events)
+{
+    // a repeated note on is a retrigger of the same note
+    noteOff (channel, note, time, events);
+    if (numNotes == maxNotes)
+    {
+        return;
+    }
+
+    int effective = std::clamp (static_cast<int>(std::lround (getPitch (channel, note))), 0, 127);
+    notes[static_cast<size_t>(numNotes++)] = { static_cast<uint8_t>(channel), static_cast<uint8_t>(note), static_cast<uint8_t>(effective) };
+    addEffective (effective, time, events);
+}
+
+void MpeNoteTracker::noteOff (int channel, int note, double time, std::vector<NoteEvent>& events)
+{
+    for (int i = 0; i < numNotes; ++i)
+    {
+        auto& n = notes[static_cast<size_t>(i)];
+        if (n.channel == channel && n.note == note)
+        {
+            removeEffective (n.effective, time, events);
+            // order doesn't matter, so the last note takes its place
+            n = notes[static_cast<size_t>(--numNotes)];
+            return;
+        }
+    }
+}
+
+void MpeNoteTracker::bendChanged (int channel, double time, std::vector<NoteEvent>& events)
+{
+    const bool isMaster = (channel == 0 && lowerMembers > 0) || (channel == 15 && upperMembers > 0);
+
+    for (int i = 0; i < numNotes; ++i)
+    {
+        auto& n = notes[static_cast<size_t>(i)];
+        if (n.channel != channel && ! (isMaster && getMasterChannel (n.channel) == channel))
+        {
+            continue;
+        }
+
+        double pitch = getPitch (n.channel, n.note);
+        if (std::abs (pitch - n.effective) <= 0.5 + hysteresis)
+        {
+            continue;
+        }
+        int effective = std::clamp (static_cast<int>(std::lround (pitch)), 0, 127);
+        if (effective != n.effective)
+        {
+            removeEffective (n.effective, time, events);
+            n.effective = static_cast<uint8_t>(effective);
+            addEffective (effective, time, events);
+        }
+    }
+}
+
+void MpeNoteTracker::controller (int channel, int number, int value, double time, std::vector<NoteEvent>& events)
+{
+    auto c = static_cast<size_t>(channel);
+    switch (number)
+    {
+        case 101:
+            rpnMsb[c] = value;
+            break;
+        case 100:
+            rpnLsb[c] = value;
+            break;
+        // NRPNs deselect the RPN, so that their data entry isn't taken for it
+        case 98:
+        case 99:
+            rpnMsb[c] = rpnLsb[c] = nullRpn;
+            break;
+        case 6:
+            if (rpnMsb[c] == 0 && rpnLsb[c] == 0)
+            {
+                setBendRange (channel, value);
+            } else if (rpnMsb[c] == 0 && rpnLsb[c] == 6 && (channel == 0 || channel == 15))
+            {
+                setMemberChannels (channel, value);
+            }
+            break;
+        case 38:
+            // cents of the bend range
+            if (rpnMsb[c] == 0 && rpnLsb[c] == 0)
+            {
+                setBendRange (channel, std::floor (bendRange[c]) + value / 100.0);
+            }
+            break;
+        case 121:
+            bend[c] = 0;
+            bendChanged (channel, time, events);
+            break;
+        case 120:
+        case 123:
+            removeNotes (channel, time, events);
+            break;
+        default:
+            break;
+    }
+}
+
+void MpeNoteTracker::setMemberChannels (int masterChannel, int numMembers)
+{
+    // a zone covering all 15 other channels is limited to 14, leaving the other master free
+    numMembers = std::clamp (numMembers, 0, 14);
+    std::array<int, 16> oldMasters;
+    for (int channel = 0; channel < 16; ++channel)
+    {
+        oldMasters[static_cast<size_t>(channel)] = getMasterChannel (channel);
+    }
+    if (masterChannel == 0)
+    {
+        lowerMembers = numMembers;
+        // the zones can't overlap, the one set last wins
+        upperMembers = std::min (upperMembers, 14 - lowerMembers);
+    } else
+    {
+        upperMembers = numMembers;
+        lowerMembers = std::min (lowerMembers, 14 - upperMembers);
+    }
+
+    // a new zone starts with the default bend ranges, and channels that left a zone (this one
+    // shrinking, or the other one giving way to it) are ordinary channels again
+    bendRange[static_cast<size_t>(masterChannel)] = defaultBendRange;
+    for (int channel = 1; channel < 15; ++channel)
+    {
+        const int master = getMasterChannel (channel);
+        if (master == masterChannel)
+        {
+            bendRange[static_cast<size_t>(channel)] = defaultMemberBendRange;
+        } else if (master < 0 && oldMasters[static_cast<size_t>(channel)] >= 0)
+        {
+            bendRange[static_cast<size_t>(channel)] = defaultBendRange;
+        }
+    }
+}
+
+void MpeNoteTracker::setBendRange (int channel, double semitones)
+{
+    // setting the range on any member channel sets it for the whole zone
+    int master = getMasterChannel (channel);
+    if (master < 0)
+    {
+        bendRange[static_cast<size_t>(channel)] = semitones;
+        return;
+    }
+    for (int c = 1; c < 15; ++c)
+    {
+        if (getMasterChannel (c) == master)
+        {
+            bendRange[static_cast<size_t>(c)] = semitones;
+        }
+    }
+}
+
+void MpeNoteTracker::removeNotes (int channel, double time, std::vector<NoteEvent>& events)
+{
+    const bool isMaster = (channel == 0 && lowerMembers > 0) || (channel == 15 && upperMembers > 0);
+    for (int i = numNotes - 1; i >= 0; --i)
+    {
+        auto& n = notes[static_cast<size_t>(i)];
+        if (n.channel == channel || (isMaster && getMasterChannel (n.channel) == channel))
+        {
+            removeEffective (n.effective, time, events);
+            n = notes[static_cast<size_t>(--numNotes)];
+        }
+    }
+}
+
+void MpeNoteTracker::addEffective (int note, double time, std::vector<NoteEvent>& events)
+{
+    if (effectiveCounts[static_cast<size_t>(note)]++ == 0)
+    {
+        events.push_back ({ note, true, time });
+    }
+}
+
+void MpeNoteTracker::removeEffective (int note, double time, std::vector<NoteEvent>& events)
+{
+    auto& count = effectiveCounts[static_cast<size_t>(note)];
+    if (count > 0 && --count == 0)
+    {
+        events.push_back ({ note, false, time });
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "OnsetGrouper.h"
+
+//==============================================================================
+// Turns raw MIDI, including MPE and per-note pitch bend, into the notes that are actually
+// sounding, so that a bent note is identified as the pitch it is bent to.
+//
+// Every held note is kept in a small table with its channel, the note number that was played
+// and the effective note it currently sounds as. A pitch bend only re-evaluates the notes on
+// its channel (or its zone, for an MPE master channel), and produces note events only when an
+// effective note crosses to another semitone, so a stream of pitch bends that stays within a
+// semitone costs a few arithmetic operations and no identification.
+//
+// Without an MPE zone every channel is an ordinary MIDI channel with a bend range of 2
+// semitones. MPE zones are set up by the MPE configuration message (RPN 6) and bend ranges by
+// RPN 0, as the MPE specification describes. Fixed size, never allocates.
+class MpeNoteTracker
+{
+public:
+    MpeNoteTracker();
+
+    // data is one complete MIDI message, changes to the effective notes are appended to events
+    // returns true if any were appended
+    bool process (const uint8_t* data, int size, double time, std::vector<NoteEvent>& events);
+
+    // forgets all notes, zones and bend ranges
+    void reset();
+
+    int getNumMemberChannels (bool lowerZone) const;
+
+private:
+    struct Note
+    {
+        uint8_t channel;
+        uint8_t note;
+        uint8_t effective;
+    };
+
+    // master channel of the zone channel belongs to as a member, -1 if it isn't a member
+    int getMasterChannel (int channel) const;
+
+    // pitch of a note on a channel in semitones, including the bend of the zone's master
+    double getPitch (int channel, int note) const;
+
+    void noteOn (int channel, int note, double time, std::vector<NoteEvent>& events);
+
+    void noteOff (int channel, int note, double time, std::vector<NoteEvent>& events);
+
+    // re-evaluates every note on channel, or in the whole zone if channel is a master
+    void bendChanged (int channel, double time, std::vector<NoteEvent>& events);
+
+    void controller (int channel, int number, int value, double time, std::vector<NoteEvent>& events);
+
+    void setMemberChannels (int masterChannel, int numMembers);
+
+    void setBendRange (int channel, double semitones);
+
+    void removeNotes (int channel, double time, std::vector<NoteEvent>& events);
+
+    // several notes can sound as the same effective note, only the first on and last off are events
+    void addEffective (int note, double time, std::vector<NoteEvent>& events);
+
+    void removeEffective (int note, double time, std::vector<NoteEvent>& events);
+
+    static const int maxNotes = 128;
+
+    std::array<Note, maxNotes> notes;
+    int numNotes = 0;
+    std::array<int, 128> effectiveCounts;
+
+    //-----Per channel state-----
+    std::array<int, 16> bend;
+    std::array<double, 16> bendRange;
+    std::array<int, 16> rpnMsb;
+    std::array<int, 16> rpnLsb;
+
+    // member channels of the lower (master channel 1) and upper (master channel 16) zones
+    int lowerMembers = 0;
+    int upperMembers = 0;
+};
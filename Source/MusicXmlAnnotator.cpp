@@ -0,0 +1,324 @@
+#include "MusicXmlAnnotator.h"
+#include "HarmonicDecoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+    // pitch classes of the steps C-B
+    int getStepPitchClass (char step)
+    {
+        switch (step)
+        {
+            case 'C': return 0;
+            case 'D': return 2;
+            case 'E': return 4;
+            case 'F': return 5;
+            case 'G': return 7;
+            case 'A': return 9;
+            case 'B': return 11;
+            default:  return -1;
+        }
+    }
+
+    const char* const noteNames[12] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+
+    // notes closer than this (in quarter notes) start together, to absorb rounding errors
+    const double epsilon = 1e-6;
+
+    // times are sorted on a grid of epsilon, an exact key so the comparison is a strict weak ordering
+    int64_t getTick (double time)
+    {
+        return std::llround (time / epsilon);
+    }
+}
+
+//==============================================================================
+MusicXmlAnnotator::MusicXmlAnnotator()
+  : parser (*this)
+{
+}
+
+bool MusicXmlAnnotator::feed (const char* data, size_t size)
+{
+    return parser.feed (data, size);
+}
+
+bool MusicXmlAnnotator::finish()
+{
+    if (! parser.finish())
+    {
+        return false;
+    }
+
+    // note offs come before note ons at the same time, so repeated and tied notes keep sounding
+    std::sort (events.begin(), events.end(), [] (const NoteEvent& a, const NoteEvent& b)
+    {
+        const auto tickA = getTick (a.time);
+        const auto tickB = getTick (b.time);
+        if (tickA != tickB)
+        {
+            return tickA < tickB;
+        }
+        return ! a.on && b.on;
+    });
+    auto byTime = [] (const TimedValue& a, const TimedValue& b) { return a.time < b.time; };
+    std::stable_sort (keys.begin(), keys.end(), byTime);
+    std::stable_sort (measures.begin(), measures.end(), byTime);
+
+    // more than one voice can play the same note, so count them
+    int counts[128] = {};
+    uint64_t sounding[2] = {0, 0};
+    uint64_t previous[2] = {0, 0};
+    size_t keyIndex = 0;
+    size_t measureIndex = 0;
+    int key = ChordAnalysis::getKeyFromFifths (0, true);
+    std::vector<int> notes;
+
+    for (size_t i = 0; i < events.size();)
+    {
+        const double time = events[i].time;
+        for (; i < events.size() && events[i].time <= time + epsilon; ++i)
+        {
+            auto& event = events[i];
+            int& count = counts[event.note];
+            count = std::max (0, count + (event.on ? 1 : -1));
+            uint64_t bit = uint64_t (1) << (event.note % 64);
+            sounding[event.note / 64] = count > 0 ? (sounding[event.note / 64] | bit) : (sounding[event.note / 64] & ~bit);
+        }
+
+        while (keyIndex < keys.size() && keys[keyIndex].time <= time + epsilon)
+        {
+            key = keys[keyIndex++].value;
+        }
+        while (measureIndex + 1 < measures.size() && measures[measureIndex + 1].time <= time + epsilon)
+        {
+            ++measureIndex;
+        }
+
+        if (sounding[0] == previous[0] && sounding[1] == previous[1])
+        {
+            continue;
+        }
+        previous[0] = sounding[0];
+        previous[1] = sounding[1];
+        if (sounding[0] == 0 && sounding[1] == 0)
+        {
+            continue;
+        }
+
+        notes.clear();
+        for (int note = 0; note < 128; ++note)
+        {
+            if ((sounding[note / 64] >> (note % 64)) & 1)
+            {
+                notes.push_back (note);
+            }
+        }
+
+        Sonority sonority;
+        sonority.time = time;
+        sonority.measure = measures.empty() ? 1 : measures[measureIndex].value;
+        sonority.beat = time - (measures.empty() ? 0.0 : measures[measureIndex].time) + 1.0;
+        sonority.key = key;
+        sonority.notes[0] = sounding[0];
+        sonority.notes[1] = sounding[1];
+        sonority.result = ChordAnalysis::identify (notes, key);
+        sonorities.push_back (sonority);
+    }
+
+    // the events aren't needed any more
+    std::vector<NoteEvent>().swap (events);
+    return true;
+}
+
+void MusicXmlAnnotator::smooth()
+{
+    HarmonicDecoder decoder;
+    std::vector<ChordResult> results;
+    results.reserve (sonorities.size());
+    for (size_t i = 0; i < sonorities.size(); ++i)
+    {
+        // every pitch class counts for as long as the sonority lasts, however many notes double it
+        auto& sonority = sonorities[i];
+        const double length = i + 1 < sonorities.size() ? sonorities[i + 1].time - sonority.time : 1.0;
+        const float weight = static_cast<float>(std::max (length, 0.0625));
+
+        HarmonicDecoder::Observation observation {};
+        observation.bass = -1;
+        observation.key = sonority.key;
+        for (int note = 127; note >= 0; --note)
+        {
+            if ((sonority.notes[note / 64] >> (note % 64)) & 1)
+            {
+                observation.weights[static_cast<size_t>(note % 12)] = weight;
+                observation.bass = note;
+            }
+        }
+        decoder.push (observation, results);
+    }
+    decoder.finish (results);
+
+    for (size_t i = 0; i < sonorities.size(); ++i)
+    {
+        sonorities[i].result = results[i];
+    }
+}
+
+const std::vector<Sonority>& MusicXmlAnnotator::getSonorities() const
+{
+    return sonorities;
+}
+
+int MusicXmlAnnotator::getNumNotes() const
+{
+    return numNotes;
+}
+
+void MusicXmlAnnotator::writeCsv (const std::vector<Sonority>& sonorities, std::ostream& out)
+{
+    out << "measure,beat,key,numeral,figures,notes\n";
+    for (auto& sonority : sonorities)
+    {
+        std::string figures = sonority.result.figures;
+        std::replace (figures.begin(), figures.end(), '\n', '/');
+
+        out << sonority.measure << ',' << sonority.beat << ',' << ChordAnalysis::getKeyName (sonority.key) << ','
+            << ChordAnalysis::getNumeralText (sonority.result, sonority.key) << ',' << figures << ',';
+        bool first = true;
+        for (int note = 0; note < 128; ++note)
+        {
+            if ((sonority.notes[note / 64] >> (note % 64)) & 1)
+            {
+                out << (first ? "" : " ") << noteNames[note % 12] << note / 12 - 1;
+                first = false;
+            }
+        }
+        out << '\n';
+    }
+}
+
+//==============================================================================
+void MusicXmlAnnotator::startElement (const std::string& name, const SaxParser::Attributes& attributes)
+{
+    elements.push_back (name);
+    text.clear();
+
+    if (name == "part")
+    {
+        ++partIndex;
+        position = 0.0;
+        lastNoteStart = 0.0;
+    } else if (name == "measure" && partIndex == 0)
+    {
+        // measure numbers can be things like "12a", atoi reads the number at the start
+        auto number = SaxParser::getAttribute (attributes, "number");
+        int value = number.empty() ? static_cast<int>(measures.size()) + 1 : std::atoi (number.c_str());
+        measures.push_back ({ position, value });
+    } else if (name == "note")
+    {
+        isChord = isRest = isGrace = isCue = false;
+        step = -1;
+        alter = 0;
+        octave = 4;
+        duration = 0;
+    } else if (name == "chord" && isInside ("note"))
+    {
+        isChord = true;
+    } else if (name == "rest" && isInside ("note"))
+    {
+        isRest = true;
+    } else if (name == "grace")
+    {
+        isGrace = true;
+    } else if (name == "cue")
+    {
+        isCue = true;
+    } else if (name == "key")
+    {
+        fifths = 0;
+        major = true;
+    }
+}
+
+void MusicXmlAnnotator::endElement (const std::string& name)
+{
+    if (! elements.empty())
+    {
+        elements.pop_back();
+    }
+
+    if (name == "divisions")
+    {
+        divisions = std::max (1, std::atoi (text.c_str()));
+    } else if (name == "step" && isInside ("pitch"))
+    {
+        step = text.empty() ? -1 : getStepPitchClass (text[0]);
+    } else if (name == "alter" && isInside ("pitch"))
+    {
+        // microtonal alterations are rounded to the nearest semitone
+        alter = static_cast<int>(std::lround (std::atof (text.c_str())));
+    } else if (name == "octave" && isInside ("pitch"))
+    {
+        octave = std::atoi (text.c_str());
+    } else if (name == "duration")
+    {
+        if (isInside ("note"))
+        {
+            duration = std::atoi (text.c_str());
+        } else if (isInside ("backup"))
+        {
+            position -= static_cast<double>(std::atoi (text.c_str())) / divisions;
+        } else if (isInside ("forward"))
+        {
+            position += static_cast<double>(std::atoi (text.c_str())) / divisions;
+        }
+    } else if (name == "fifths")
+    {
+        fifths = std::atoi (text.c_str());
+    } else if (name == "mode")
+    {
+        major = text != "minor";
+    } else if (name == "key")
+    {
+        int key = ChordAnalysis::getKeyFromFifths (fifths, major);
+        // the first part is enough, as long as it has a key signature
+        if (key != 0 && (partIndex == 0 || keys.empty()))
+        {
+            keys.push_back ({ position, key });
+        }
+    } else if (name == "note")
+    {
+        // grace and cue notes take no time in the score
+        if (isGrace || isCue)
+        {
+            return;
+        }
+        double start = isChord ? lastNoteStart : position;
+        double length = static_cast<double>(duration) / divisions;
+        if (! isChord)
+        {
+            lastNoteStart = position;
+            position += length;
+        }
+
+        int note = (octave + 1) * 12 + step + alter;
+        if (! isRest && step >= 0 && note >= 0 && note < 128 && length > 0.0)
+        {
+            events.push_back ({ start, note, true });
+            events.push_back ({ start + length, note, false });
+            ++numNotes;
+        }
+    }
+}
+
+void MusicXmlAnnotator::characters (const std::string& t)
+{
+    text += t;
+}
+
+bool MusicXmlAnnotator::isInside (const char* element) const
+{
+    return std::find (elements.rbegin(), elements.rend(), element) != elements.rend();
+}
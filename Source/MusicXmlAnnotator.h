@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ChordAnalysis.h"
+#include "SaxParser.h"
+
+//==============================================================================
+// a vertical slice of a score, the notes sounding from time until the next sonority
+struct Sonority
+{
+    // quarter notes from the start of the score
+    double time;
+    // measure number as written in the score
+    int measure;
+    // quarter notes from the start of the measure, counting from 1
+    double beat;
+    int key;
+    // one bit per midi note number
+    uint64_t notes[2];
+    ChordResult result;
+};
+
+//==============================================================================
+// Reads a partwise MusicXML score with SaxParser and identifies every sonority in it, using the
+// key signature of the score as the key.
+//
+// Only the note events (a few bytes per note) are kept while parsing, the document itself is
+// never held in memory.
+class MusicXmlAnnotator : private SaxParser::Handler
+{
+public:
+    MusicXmlAnnotator();
+
+    // returns false once the document is found to be malformed
+    bool feed (const char* data, size_t size);
+
+    // slices the score into sonorities once all of it has been fed
+    // returns false if the document was malformed or cut short
+    bool finish();
+
+    // replaces the result of every sonority with a HarmonicDecoder segmentation of the whole
+    // score, so passing tones and suspensions don't change the chord, call after finish()
+    void smooth();
+
+    const std::vector<Sonority>& getSonorities() const;
+
+    int getNumNotes() const;
+
+    // one line per sonority: measure, beat, key, numeral, figures and notes
+    static void writeCsv (const std::vector<Sonority>& sonorities, std::ostream& out);
+
+private:
+    void startElement (const std::string& name, const SaxParser::Attributes& attributes) override;
+
+    void endElement (const std::string& name) override;
+
+    void characters (const std::string& text) override;
+
+    bool isInside (const char* element) const;
+
+    struct NoteEvent
+    {
+        double time;
+        int note;
+        bool on;
+    };
+
+    struct TimedValue
+    {
+        double time;
+        int value;
+    };
+
+    SaxParser parser;
+
+    // names of the open elements
+    std::vector<std::string> elements;
+    std::string text;
+
+    //-----Position in the current part, in quarter notes-----
+    int partIndex = -1;
+    int divisions = 1;
+    double position = 0.0;
+    double lastNoteStart = 0.0;
+
+    //-----Current note-----
+    bool isChord = false;
+    bool isRest = false;
+    bool isGrace = false;
+    bool isCue = false;
+    int step = -1;
+    int alter = 0;
+    int octave = 4;
+    int duration = 0;
+
+    //-----Current key signature-----
+    int fifths = 0;
+    bool major = true;
+
+    std::vector<NoteEvent> events;
+    std::vector<TimedValue> keys;
+    std::vector<TimedValue> measures;
+    int numNotes = 0;
+
+    std::vector<Sonority> sonorities;
+};
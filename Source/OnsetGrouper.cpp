@@ -0,0 +1,78 @@
+#include "OnsetGrouper.h"
+#include <algorithm>
+
+OnsetGrouper::OnsetGrouper()
+  : window (0.0)
+{
+    // enough for both hands without reallocating
+    pending.reserve (32);
+}
+
+void OnsetGrouper::setWindow (double seconds)
+{
+    window = std::max (0.0, seconds);
+}
+
+double OnsetGrouper::getWindow() const
+{
+    return window;
+}
+
+void OnsetGrouper::add (const NoteEvent& event)
+{
+    pending.push_back (event);
+    ++numEvents;
+}
+
+bool OnsetGrouper::hasPending() const
+{
+    return ! pending.empty();
+}
+
+bool OnsetGrouper::isDue (double time) const
+{
+    return ! pending.empty() && time >= getDeadline();
+}
+
+double OnsetGrouper::getDeadline() const
+{
+    return pending.empty() ? 0.0 : pending.front().time + window;
+}
+
+void OnsetGrouper::flush (double time, std::vector<NoteEvent>& events)
+{
+    events.clear();
+    if (pending.empty())
+    {
+        return;
+    }
+
+    double latency = std::max (0.0, time - pending.front().time);
+    maxLatency = std::max (maxLatency, latency);
+    totalLatency += latency;
+    ++numGroups;
+
+    // swap keeps the capacity of both vectors, so flushing doesn't allocate
+    std::swap (pending, events);
+    pending.clear();
+}
+
+int OnsetGrouper::getNumEvents() const
+{
+    return numEvents;
+}
+
+int OnsetGrouper::getNumGroups() const
+{
+    return numGroups;
+}
+
+double OnsetGrouper::getMaxLatency() const
+{
+    return maxLatency;
+}
+
+double OnsetGrouper::getAverageLatency() const
+{
+    return numGroups > 0 ? totalLatency / numGroups : 0.0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+//==============================================================================
+// a note on or off, time is in seconds using the same clock as juce::MidiMessage timestamps
+struct NoteEvent
+{
+    int note;
+    bool on;
+    double time;
+};
+
+//==============================================================================
+// Groups note events that arrive within a short window of each other, so that a rolled chord
+// (or a chord released a few milliseconds at a time) is identified once instead of once per note.
+//
+// The window starts at the first pending event. Latency added to any event is bounded by the
+// window plus however late the owner flushes, and is recorded so it can be measured.
+class OnsetGrouper
+{
+public:
+    OnsetGrouper();
+
+    // a window of 0 flushes every event on its own
+    void setWindow (double seconds);
+
+    double getWindow() const;
+
+    void add (const NoteEvent& event);
+
+    bool hasPending() const;
+
+    // returns true if the pending events should be flushed by the given time
+    bool isDue (double time) const;
+
+    // time at which the pending events are due
+    double getDeadline() const;
+
+    // moves the pending events into events (which is cleared first)
+    void flush (double time, std::vector<NoteEvent>& events);
+
+    //-----Statistics-----
+    int getNumEvents() const;
+
+    int getNumGroups() const;
+
+    double getMaxLatency() const;
+
+    double getAverageLatency() const;
+
+private:
+    double window;
+    std::vector<NoteEvent> pending;
+
+    int numEvents = 0;
+    int numGroups = 0;
+    double maxLatency = 0.0;
+    double totalLatency = 0.0;
+};
@@ -0,0 +1,508 @@
+#include "ProgressionIndex.h"
+#include "ProgressionMatcher.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    // numeral ids times two modes
+    const int numCoarse = ChordAnalysis::numNumerals * 2;
+    const int gramLength = 3;
+    const int numGrams = numCoarse * numCoarse * numCoarse;
+
+    const char magic[8] = {'C', 'H', 'I', 'D', 'X', '0', '1', 0};
+
+    // numeral and mode of a token, what the n-grams are made of
+    int getCoarse (uint16_t token)
+    {
+        return ProgressionIndex::toResult (token).getNumeralId() * 2 + (token & 1);
+    }
+
+    int getCoarse (const ProgressionIndex::QueryToken& token)
+    {
+        return token.numeral * 2 + (token.minor ? 1 : 0);
+    }
+
+    uint64_t align (uint64_t offset)
+    {
+        return (offset + 7) & ~uint64_t (7);
+    }
+
+    void writeVarint (std::vector<uint8_t>& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back (static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back (static_cast<uint8_t>(value));
+    }
+
+    uint64_t readVarint (const uint8_t*& p)
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            uint8_t byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                break;
+            }
+        }
+        return value;
+    }
+
+    void writePadding (std::ostream& out, uint64_t& position, uint64_t target)
+    {
+        static const char zeros[8] = {};
+        out.write (zeros, static_cast<std::streamsize>(target - position));
+        position = target;
+    }
+
+    template <typename T>
+    void writeArray (std::ostream& out, uint64_t& position, const T* values, size_t count)
+    {
+        out.write (reinterpret_cast<const char*>(values), static_cast<std::streamsize>(count * sizeof (T)));
+        position += count * sizeof (T);
+    }
+}
+
+//==============================================================================
+// the file is written in the byte order of the machine writing it, every section is 8 byte aligned
+struct ProgressionIndex::Header
+{
+    char magic[8];
+    uint64_t numDocuments;
+    uint64_t numTokens;
+    uint64_t documentsOffset;
+    // uint16_t per token
+    uint64_t tokensOffset;
+    // int32_t per token
+    uint64_t measuresOffset;
+    // numGrams + 1 offsets into the postings, so each list ends where the next begins
+    uint64_t gramOffsetsOffset;
+    // uint32_t number of postings per gram
+    uint64_t gramCountsOffset;
+    uint64_t postingsOffset;
+    uint64_t pathsOffset;
+    uint64_t fileSize;
+};
+
+struct ProgressionIndex::DocumentEntry
+{
+    uint64_t firstToken;
+    uint64_t pathOffset;
+    int64_t modificationTime;
+    int64_t size;
+    uint32_t numTokens;
+    uint32_t pathLength;
+};
+
+//==============================================================================
+ProgressionIndex::ProgressionIndex (const void* d, size_t s)
+  : data (static_cast<const uint8_t*>(d)), size (s)
+{
+    if (data == nullptr || size < sizeof (Header))
+    {
+        return;
+    }
+    auto h = reinterpret_cast<const Header*>(data);
+    if (std::memcmp (h->magic, magic, sizeof (magic)) != 0 || h->fileSize != size
+        || h->documentsOffset + h->numDocuments * sizeof (DocumentEntry) > size
+        || h->tokensOffset + h->numTokens * sizeof (uint16_t) > size
+        || h->measuresOffset + h->numTokens * sizeof (int32_t) > size
+        || h->gramOffsetsOffset + (numGrams + 1) * sizeof (uint64_t) > size
+        || h->gramCountsOffset + numGrams * sizeof (uint32_t) > size
+        || h->postingsOffset > size || h->pathsOffset > size)
+    {
+        return;
+    }
+    header = h;
+}
+
+bool ProgressionIndex::isValid() const
+{
+    return header != nullptr;
+}
+
+uint32_t ProgressionIndex::getNumDocuments() const
+{
+    return header != nullptr ? static_cast<uint32_t>(header->numDocuments) : 0;
+}
+
+uint64_t ProgressionIndex::getNumTokens() const
+{
+    return header != nullptr ? header->numTokens : 0;
+}
+
+std::string ProgressionIndex::getDocumentPath (uint32_t document) const
+{
+    auto& entry = getDocument (document);
+    return std::string (reinterpret_cast<const char*>(data + header->pathsOffset + entry.pathOffset), entry.pathLength);
+}
+
+int64_t ProgressionIndex::getDocumentModificationTime (uint32_t document) const
+{
+    return getDocument (document).modificationTime;
+}
+
+int64_t ProgressionIndex::getDocumentSize (uint32_t document) const
+{
+    return getDocument (document).size;
+}
+
+const ProgressionIndex::DocumentEntry& ProgressionIndex::getDocument (uint32_t document) const
+{
+    return reinterpret_cast<const DocumentEntry*>(data + header->documentsOffset)[document];
+}
+
+//==============================================================================
+uint16_t ProgressionIndex::toToken (const ChordResult& result, int key)
+{
+    // tokens are always valid chords, so the valid bit of the packed result holds the mode instead
+    return static_cast<uint16_t>((ChordAnalysis::pack (result) & ~1) | (ChordAnalysis::isMajor (key) ? 0 : 1));
+}
+
+ChordResult ProgressionIndex::toResult (uint16_t token)
+{
+    return ChordAnalysis::unpack (static_cast<uint16_t>(token | 1));
+}
+
+bool ProgressionIndex::parseQuery (const std::string& text, bool major, std::vector<QueryToken>& query)
+{
+    // superscript figures and dashes are rewritten as plain digits and spaces
+    static const std::pair<const char*, const char*> replacements[] =
+    {
+        {"\xe2\x81\xb0", "0"}, {"\xc2\xb9", "1"}, {"\xc2\xb2", "2"}, {"\xc2\xb3", "3"}, {"\xe2\x81\xb4", "4"},
+        {"\xe2\x81\xb5", "5"}, {"\xe2\x81\xb6", "6"}, {"\xe2\x81\xb7", "7"}, {"\xe2\x81\xb8", "8"}, {"\xe2\x81\xb9", "9"},
+        {"\xe2\x80\x93", " "}, {"\xe2\x80\x94", " "}, {"-", " "}, {",", " "}, {"\t", " "}
+    };
+    std::string normalised;
+    for (size_t i = 0; i < text.size();)
+    {
+        bool replaced = false;
+        for (auto& replacement : replacements)
+        {
+            auto length = std::strlen (replacement.first);
+            if (text.compare (i, length, replacement.first) == 0)
+            {
+                normalised += replacement.second;
+                i += length;
+                replaced = true;
+                break;
+            }
+        }
+        if (! replaced)
+        {
+            normalised += text[i++];
+        }
+    }
+
+    query.clear();
+    size_t start = 0;
+    while (start < normalised.size())
+    {
+        auto end = normalised.find (' ', start);
+        if (end == std::string::npos)
+        {
+            end = normalised.size();
+        }
+        auto token = normalised.substr (start, end - start);
+        start = end + 1;
+        if (token.empty())
+        {
+            continue;
+        }
+
+        auto numerals = ProgressionMatcher::parseNumerals (token, major);
+        if (numerals.size() != 1)
+        {
+            return false;
+        }
+
+        // skip the accidentals and numeral, parseNumerals() already read them
+        size_t i = 0;
+        while (i < token.size() && std::string ("b#IViv").find (token[i]) != std::string::npos)
+        {
+            ++i;
+        }
+        while (token.compare (i, 3, "\xe2\x99\xad") == 0 || token.compare (i, 3, "\xe2\x99\xaf") == 0)
+        {
+            i += 3;
+            while (i < token.size() && std::string ("IViv").find (token[i]) != std::string::npos)
+            {
+                ++i;
+            }
+        }
+
+        QueryToken q { numerals[0], ! major, nullptr, nullptr };
+        if (token.compare (i, 2, "\xc3\xb8") == 0)
+        {
+            q.quality = "\xc3\xb8";
+            i += 2;
+        } else if (token.compare (i, 2, "/o") == 0)
+        {
+            q.quality = "\xc3\xb8";
+            i += 2;
+        } else if (token.compare (i, 2, "\xc2\xb0") == 0)
+        {
+            q.quality = "o";
+            i += 2;
+        } else if (i < token.size() && (token[i] == 'o' || token[i] == '+'))
+        {
+            q.quality = token[i] == 'o' ? "o" : "+";
+            ++i;
+        }
+
+        static const std::pair<const char*, const char*> figures[] =
+        {
+            {"53", ""}, {"6", "6"}, {"64", "6\n4"}, {"7", "7"}, {"65", "6\n5"}, {"43", "4\n3"}, {"42", "4\n2"}, {"2", "4\n2"}
+        };
+        auto digits = token.substr (i);
+        if (! digits.empty())
+        {
+            for (auto& f : figures)
+            {
+                if (digits == f.first)
+                {
+                    q.figures = f.second;
+                }
+            }
+            if (q.figures == nullptr)
+            {
+                return false;
+            }
+        }
+        query.push_back (q);
+    }
+    return ! query.empty();
+}
+
+std::vector<ProgressionIndex::Hit> ProgressionIndex::find (const std::vector<QueryToken>& query, size_t maxHits) const
+{
+    std::vector<Hit> hits;
+    if (header == nullptr || query.empty() || maxHits == 0)
+    {
+        return hits;
+    }
+
+    auto tokens = reinterpret_cast<const uint16_t*>(data + header->tokensOffset);
+    auto measures = reinterpret_cast<const int32_t*>(data + header->measuresOffset);
+
+    // too short for the n-grams, every run of every document is tried
+    if (query.size() < static_cast<size_t>(gramLength))
+    {
+        for (uint32_t d = 0; d < getNumDocuments() && hits.size() < maxHits; ++d)
+        {
+            auto& document = getDocument (d);
+            auto first = tokens + document.firstToken;
+            for (uint32_t p = 0; p < document.numTokens && hits.size() < maxHits;)
+            {
+                if (matches (document, p, query))
+                {
+                    hits.push_back ({ d, p, measures[document.firstToken + p] });
+                }
+                for (int c = getCoarse (first[p]); p < document.numTokens && getCoarse (first[p]) == c; ++p) {}
+            }
+        }
+        return hits;
+    }
+
+    // the rarest trigram of the query gives the fewest candidates to check
+    auto gramOffsets = reinterpret_cast<const uint64_t*>(data + header->gramOffsetsOffset);
+    auto gramCounts = reinterpret_cast<const uint32_t*>(data + header->gramCountsOffset);
+    size_t window = 0;
+    uint32_t fewest = std::numeric_limits<uint32_t>::max();
+    int gram = 0;
+    for (size_t w = 0; w + gramLength <= query.size(); ++w)
+    {
+        int g = (getCoarse (query[w]) * numCoarse + getCoarse (query[w + 1])) * numCoarse + getCoarse (query[w + 2]);
+        if (gramCounts[g] < fewest)
+        {
+            fewest = gramCounts[g];
+            window = w;
+            gram = g;
+        }
+    }
+
+    auto p = data + header->postingsOffset + gramOffsets[gram];
+    uint32_t d = 0;
+    uint64_t position = 0;
+    for (uint32_t i = 0; i < fewest && hits.size() < maxHits; ++i)
+    {
+        auto documentDelta = readVarint (p);
+        d += static_cast<uint32_t>(documentDelta);
+        position = documentDelta == 0 ? position + readVarint (p) : readVarint (p);
+
+        // walk back to the run the query starts at
+        auto& document = getDocument (d);
+        auto first = tokens + document.firstToken;
+        uint64_t start = position;
+        size_t k = 0;
+        for (; k < window && start > 0; ++k)
+        {
+            int c = getCoarse (first[--start]);
+            while (start > 0 && getCoarse (first[start - 1]) == c)
+            {
+                --start;
+            }
+        }
+        if (k == window && matches (document, start, query))
+        {
+            hits.push_back ({ d, static_cast<uint32_t>(start), measures[document.firstToken + start] });
+        }
+    }
+    return hits;
+}
+
+bool ProgressionIndex::matches (const DocumentEntry& document, uint64_t position, const std::vector<QueryToken>& query) const
+{
+    auto first = reinterpret_cast<const uint16_t*>(data + header->tokensOffset) + document.firstToken;
+
+    // each query token has to match one chord in a run of the same numeral
+    for (auto& q : query)
+    {
+        if (position >= document.numTokens)
+        {
+            return false;
+        }
+        const int c = getCoarse (first[position]);
+        if (c != getCoarse (q))
+        {
+            return false;
+        }
+        bool found = false;
+        for (; position < document.numTokens && getCoarse (first[position]) == c; ++position)
+        {
+            auto result = toResult (first[position]);
+            found = found || ((q.figures == nullptr || std::strcmp (q.figures, result.figures) == 0)
+                              && (q.quality == nullptr || std::strcmp (q.quality, result.quality) == 0));
+        }
+        if (! found)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//==============================================================================
+void ProgressionIndex::Builder::addDocument (const std::string& path, int64_t modificationTime, int64_t size,
+                                             const std::vector<uint16_t>& documentTokens, const std::vector<int32_t>& documentMeasures)
+{
+    Document document { tokens.size(), 0, paths.size(), static_cast<uint32_t>(path.size()), modificationTime, size };
+    for (size_t i = 0; i < documentTokens.size(); ++i)
+    {
+        if (i > 0 && documentTokens[i] == documentTokens[i - 1])
+        {
+            continue;
+        }
+        tokens.push_back (documentTokens[i]);
+        measures.push_back (i < documentMeasures.size() ? documentMeasures[i] : 0);
+        ++document.numTokens;
+    }
+    paths += path;
+    documents.push_back (document);
+}
+
+void ProgressionIndex::Builder::addDocument (const ProgressionIndex& index, uint32_t document)
+{
+    auto& entry = index.getDocument (document);
+    auto first = reinterpret_cast<const uint16_t*>(index.data + index.header->tokensOffset) + entry.firstToken;
+    auto firstMeasure = reinterpret_cast<const int32_t*>(index.data + index.header->measuresOffset) + entry.firstToken;
+    addDocument (index.getDocumentPath (document), entry.modificationTime, entry.size,
+                 std::vector<uint16_t> (first, first + entry.numTokens), std::vector<int32_t> (firstMeasure, firstMeasure + entry.numTokens));
+}
+
+uint32_t ProgressionIndex::Builder::getNumDocuments() const
+{
+    return static_cast<uint32_t>(documents.size());
+}
+
+bool ProgressionIndex::Builder::write (std::ostream& out) const
+{
+    // posting lists are encoded as they are built, documents are added in order so each list is sorted
+    std::vector<std::vector<uint8_t>> postings (numGrams);
+    std::vector<uint32_t> counts (numGrams, 0);
+    std::vector<uint32_t> lastDocument (numGrams, 0);
+    std::vector<uint64_t> lastPosition (numGrams, 0);
+    std::vector<uint32_t> runs;
+
+    for (uint32_t d = 0; d < documents.size(); ++d)
+    {
+        auto& document = documents[d];
+        auto first = tokens.data() + document.firstToken;
+
+        runs.clear();
+        for (uint32_t p = 0; p < document.numTokens; ++p)
+        {
+            if (p == 0 || getCoarse (first[p]) != getCoarse (first[p - 1]))
+            {
+                runs.push_back (p);
+            }
+        }
+
+        for (size_t r = 0; r + gramLength <= runs.size(); ++r)
+        {
+            int g = (getCoarse (first[runs[r]]) * numCoarse + getCoarse (first[runs[r + 1]])) * numCoarse + getCoarse (first[runs[r + 2]]);
+            auto& list = postings[static_cast<size_t>(g)];
+            const uint32_t documentDelta = d - lastDocument[static_cast<size_t>(g)];
+            writeVarint (list, documentDelta);
+            writeVarint (list, documentDelta == 0 ? runs[r] - lastPosition[static_cast<size_t>(g)] : runs[r]);
+            lastDocument[static_cast<size_t>(g)] = d;
+            lastPosition[static_cast<size_t>(g)] = runs[r];
+            ++counts[static_cast<size_t>(g)];
+        }
+    }
+
+    std::vector<uint64_t> gramOffsets (numGrams + 1, 0);
+    for (int g = 0; g < numGrams; ++g)
+    {
+        gramOffsets[static_cast<size_t>(g + 1)] = gramOffsets[static_cast<size_t>(g)] + postings[static_cast<size_t>(g)].size();
+    }
+
+    Header header {};
+    std::memcpy (header.magic, magic, sizeof (magic));
+    header.numDocuments = documents.size();
+    header.numTokens = tokens.size();
+    header.documentsOffset = align (sizeof (Header));
+    header.tokensOffset = align (header.documentsOffset + documents.size() * sizeof (DocumentEntry));
+    header.measuresOffset = align (header.tokensOffset + tokens.size() * sizeof (uint16_t));
+    header.gramOffsetsOffset = align (header.measuresOffset + measures.size() * sizeof (int32_t));
+    header.gramCountsOffset = align (header.gramOffsetsOffset + gramOffsets.size() * sizeof (uint64_t));
+    header.postingsOffset = align (header.gramCountsOffset + counts.size() * sizeof (uint32_t));
+    header.pathsOffset = align (header.postingsOffset + gramOffsets.back());
+    header.fileSize = header.pathsOffset + paths.size();
+
+    uint64_t position = 0;
+    writeArray (out, position, &header, 1);
+
+    writePadding (out, position, header.documentsOffset);
+    for (auto& document : documents)
+    {
+        DocumentEntry entry { document.firstToken, document.pathOffset, document.modificationTime, document.size,
+                              document.numTokens, document.pathLength };
+        writeArray (out, position, &entry, 1);
+    }
+
+    writePadding (out, position, header.tokensOffset);
+    writeArray (out, position, tokens.data(), tokens.size());
+    writePadding (out, position, header.measuresOffset);
+    writeArray (out, position, measures.data(), measures.size());
+    writePadding (out, position, header.gramOffsetsOffset);
+    writeArray (out, position, gramOffsets.data(), gramOffsets.size());
+    writePadding (out, position, header.gramCountsOffset);
+    writeArray (out, position, counts.data(), counts.size());
+    writePadding (out, position, header.postingsOffset);
+    for (auto& list : postings)
+    {
+        writeArray (out, position, list.data(), list.size());
+    }
+    writePadding (out, position, header.pathsOffset);
+    writeArray (out, position, paths.data(), paths.size());
+
+    out.flush();
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ChordAnalysis.h"
+
+//==============================================================================
+// Inverted n-gram index over the chord sequences of an analysed corpus, for queries like
+// "every ii65 V7 I in major keys" across a whole archive.
+//
+// Each piece is stored as a sequence of 16 bit tokens (a packed ChordResult plus the mode of
+// the key, with repeated chords removed). Trigrams of numerals (degree, case and mode) point
+// to delta and varint compressed posting lists of (piece, position), and every candidate
+// found through them is checked against the tokens, so queries can also constrain inversions
+// and qualities.
+//
+// The index is a single flat file read in place: ProgressionIndex only keeps a pointer to the
+// (memory mapped) data, so opening it costs nothing and a query only touches the posting
+// lists and tokens it needs. Builder writes new files, and can copy pieces out of an existing
+// index so that updating it doesn't need the pieces to be analysed again.
+class ProgressionIndex
+{
+public:
+    // data must stay valid (mapped) for the lifetime of the index
+    ProgressionIndex (const void* data, size_t size);
+
+    // false if the data isn't an index written by this version
+    bool isValid() const;
+
+    uint32_t getNumDocuments() const;
+
+    uint64_t getNumTokens() const;
+
+    std::string getDocumentPath (uint32_t document) const;
+
+    // modification time and size of the source when it was analysed, to tell if it changed
+    int64_t getDocumentModificationTime (uint32_t document) const;
+
+    int64_t getDocumentSize (uint32_t document) const;
+
+    //-----Tokens-----
+    // result must be valid
+    static uint16_t toToken (const ChordResult& result, int key);
+
+    static ChordResult toResult (uint16_t token);
+
+    //-----Queries-----
+    struct QueryToken
+    {
+        int numeral;
+        bool minor;
+        // nullptr matches any figures or quality
+        const char* figures;
+        const char* quality;
+    };
+
+    // parses numerals with optional quality and figures, e.g. "ii65 V7 I" or "ii⁶⁵–V⁷–I"
+    // a numeral without figures matches any inversion, returns false if text could not be parsed
+    static bool parseQuery (const std::string& text, bool major, std::vector<QueryToken>& query);
+
+    struct Hit
+    {
+        uint32_t document;
+        // index of the first token of the match in the document
+        uint32_t position;
+        // measure it starts in
+        int32_t measure;
+    };
+
+    // hits in order of document and position, at most maxHits of them
+    std::vector<Hit> find (const std::vector<QueryToken>& query, size_t maxHits) const;
+
+    //==============================================================================
+    class Builder
+    {
+    public:
+        // tokens and measures have one entry per token, repeated tokens are removed
+        void addDocument (const std::string& path, int64_t modificationTime, int64_t size,
+                          const std::vector<uint16_t>& tokens, const std::vector<int32_t>& measures);
+
+        // copies a document of an existing index as it is
+        void addDocument (const ProgressionIndex& index, uint32_t document);
+
+        uint32_t getNumDocuments() const;
+
+        // returns false if the stream failed
+        bool write (std::ostream& out) const;
+
+    private:
+        struct Document
+        {
+            uint64_t firstToken;
+            uint32_t numTokens;
+            uint64_t pathOffset;
+            uint32_t pathLength;
+            int64_t modificationTime;
+            int64_t size;
+        };
+
+        std::vector<Document> documents;
+        std::vector<uint16_t> tokens;
+        std::vector<int32_t> measures;
+        std::string paths;
+    };
+
+private:
+    struct Header;
+    struct DocumentEntry;
+
+    const DocumentEntry& getDocument (uint32_t document) const;
+
+    // true if the query matches the runs of numerals starting at position
+    bool matches (const DocumentEntry& document, uint64_t position, const std::vector<QueryToken>& query) const;
+
+    const uint8_t* data;
+    size_t size;
+    const Header* header = nullptr;
+};
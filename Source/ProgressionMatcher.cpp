@@ -0,0 +1,321 @@
+#include "ProgressionMatcher.h"
+#include <cctype>
+#include <queue>
+
+namespace
+{
+    // chromatic degrees of the numerals I-VII without accidentals
+    // minor keys use the leading tone, matching how ChordAnalysis::spell() draws vii
+    const int majorScale[7] = {0, 2, 4, 5, 7, 9, 11};
+    const int minorScale[7] = {0, 2, 3, 5, 7, 8, 11};
+
+    // returns -1 if token is not a roman numeral
+    int parseNumeral (const std::string& token, bool major)
+    {
+        size_t i = 0;
+        int accidental = 0;
+        while (i < token.size())
+        {
+            if (token[i] == 'b')
+            {
+                --accidental;
+                ++i;
+            } else if (token[i] == '#')
+            {
+                ++accidental;
+                ++i;
+            } else if (token.compare (i, 3, "\xe2\x99\xad") == 0)
+            {
+                --accidental;
+                i += 3;
+            } else if (token.compare (i, 3, "\xe2\x99\xaf") == 0)
+            {
+                ++accidental;
+                i += 3;
+            } else
+            {
+                break;
+            }
+        }
+
+        size_t start = i;
+        std::string letters;
+        while (i < token.size() && (token[i] == 'I' || token[i] == 'V' || token[i] == 'i' || token[i] == 'v'))
+        {
+            letters += static_cast<char>(std::toupper (static_cast<unsigned char>(token[i])));
+            ++i;
+        }
+        if (letters.empty())
+        {
+            return -1;
+        }
+        // anything after the numeral (figures, o, +) doesn't change the numeral id
+
+        static const char* const numerals[7] = {"I", "II", "III", "IV", "V", "VI", "VII"};
+        for (int degree = 0; degree < 7; ++degree)
+        {
+            if (letters == numerals[degree])
+            {
+                const bool capital = std::isupper (static_cast<unsigned char>(token[start]));
+                const int* scale = major ? majorScale : minorScale;
+                int chromaticDegree = (scale[degree] + accidental + 12) % 12;
+                // an accidental that lands on another degree of the scale (bVI in minor is V) is a mistake
+                for (int other = 0; accidental != 0 && other < 7; ++other)
+                {
+                    if (scale[other] == chromaticDegree)
+                    {
+                        return -1;
+                    }
+                }
+                return chromaticDegree * 2 + (capital ? 1 : 0);
+            }
+        }
+        return -1;
+    }
+}
+
+//==============================================================================
+ProgressionMatcher::ProgressionMatcher()
+{
+    trie.emplace_back (ChordAnalysis::numNumerals, -1);
+    trieOutput.push_back (-1);
+    compile();
+}
+
+bool ProgressionMatcher::addPattern (const std::string& name, const std::string& numerals, bool major)
+{
+    auto ids = parseNumerals (numerals, major);
+    if (ids.empty())
+    {
+        return false;
+    }
+    addPattern (name, ids);
+    return true;
+}
+
+void ProgressionMatcher::addPattern (const std::string& name, const std::vector<int>& numerals)
+{
+    int node = 0;
+    for (auto numeral : numerals)
+    {
+        if (trie[node][numeral] < 0)
+        {
+            trie[node][numeral] = static_cast<int>(trie.size());
+            trie.emplace_back (ChordAnalysis::numNumerals, -1);
+            trieOutput.push_back (-1);
+        }
+        node = trie[node][numeral];
+    }
+    // keep the first pattern if the same sequence is added twice
+    if (trieOutput[node] < 0)
+    {
+        trieOutput[node] = static_cast<int>(patterns.size());
+    }
+    patterns.push_back ({name, numerals});
+}
+
+int ProgressionMatcher::addPatterns (const std::string& lines, bool major)
+{
+    auto trim = [] (const std::string& s)
+    {
+        auto start = s.find_first_not_of (" \t\r");
+        auto end = s.find_last_not_of (" \t\r");
+        return start == std::string::npos ? std::string() : s.substr (start, end - start + 1);
+    };
+
+    int numAdded = 0;
+    size_t lineStart = 0;
+    while (lineStart < lines.size())
+    {
+        auto lineEnd = lines.find ('\n', lineStart);
+        if (lineEnd == std::string::npos)
+        {
+            lineEnd = lines.size();
+        }
+        auto line = lines.substr (lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        auto colon = line.find (':');
+        if (colon == std::string::npos || trim (line).rfind ("#", 0) == 0)
+        {
+            continue;
+        }
+        auto name = trim (line.substr (0, colon));
+        if (! name.empty() && addPattern (name, trim (line.substr (colon + 1)), major))
+        {
+            ++numAdded;
+        }
+    }
+    return numAdded;
+}
+
+void ProgressionMatcher::compile()
+{
+    const int numNodes = static_cast<int>(trie.size());
+    const int n = ChordAnalysis::numNumerals;
+
+    transitions.assign (static_cast<size_t>(numNodes * n), 0);
+    output = trieOutput;
+    std::vector<int> fail (static_cast<size_t>(numNodes), 0);
+
+    // breadth first so that failure links always point to nodes that are already complete
+    std::queue<int> queue;
+    for (int c = 0; c < n; ++c)
+    {
+        int child = trie[0][c];
+        if (child >= 0)
+        {
+            transitions[c] = child;
+            queue.push (child);
+        }
+    }
+
+    while (! queue.empty())
+    {
+        int node = queue.front();
+        queue.pop();
+
+        // a shorter pattern ending here counts if no longer one does
+        if (output[node] < 0)
+        {
+            output[node] = output[fail[node]];
+        }
+
+        for (int c = 0; c < n; ++c)
+        {
+            int child = trie[node][c];
+            int fallback = transitions[fail[node] * n + c];
+            if (child >= 0)
+            {
+                fail[child] = fallback;
+                transitions[node * n + c] = child;
+                queue.push (child);
+            } else
+            {
+                transitions[node * n + c] = fallback;
+            }
+        }
+    }
+}
+
+int ProgressionMatcher::getNumPatterns() const
+{
+    return static_cast<int>(patterns.size());
+}
+
+const ProgressionMatcher::Pattern& ProgressionMatcher::getPattern (int index) const
+{
+    return patterns[index];
+}
+
+bool ProgressionMatcher::feed (State& state, const ChordResult& chord) const
+{
+    return feed (state, chord.getNumeralId());
+}
+
+bool ProgressionMatcher::feed (State& state, int numeralId) const
+{
+    if (numeralId < 0 || numeralId == state.lastNumeral)
+    {
+        return false;
+    }
+    state.lastNumeral = numeralId;
+    state.node = transitions[state.node * ChordAnalysis::numNumerals + numeralId];
+    state.match = output[state.node];
+    return true;
+}
+
+std::vector<ProgressionMatcher::Match> ProgressionMatcher::scan (const std::vector<int>& numeralIds) const
+{
+    std::vector<Match> matches;
+    State state;
+    for (size_t i = 0; i < numeralIds.size(); ++i)
+    {
+        if (feed (state, numeralIds[i]) && state.match >= 0)
+        {
+            matches.push_back ({i, state.match});
+        }
+    }
+    return matches;
+}
+
+ProgressionMatcher ProgressionMatcher::createDefault (bool major)
+{
+    ProgressionMatcher matcher;
+    if (major)
+    {
+        matcher.addPattern ("Authentic cadence", "V I", true);
+        matcher.addPattern ("Authentic cadence", "vii I", true);
+        matcher.addPattern ("Half cadence", "I V", true);
+        matcher.addPattern ("Half cadence", "ii V", true);
+        matcher.addPattern ("Half cadence", "IV V", true);
+        matcher.addPattern ("Half cadence", "vi V", true);
+        matcher.addPattern ("Plagal cadence", "IV I", true);
+        matcher.addPattern ("Deceptive cadence", "V vi", true);
+        matcher.addPattern ("ii-V-I", "ii V I", true);
+        matcher.addPattern ("Circle of fifths", "vi ii V I", true);
+        matcher.addPattern ("Circle of fifths", "iii vi ii V I", true);
+    } else
+    {
+        matcher.addPattern ("Authentic cadence", "V i", false);
+        matcher.addPattern ("Authentic cadence", "vii i", false);
+        matcher.addPattern ("Half cadence", "i V", false);
+        matcher.addPattern ("Half cadence", "ii V", false);
+        matcher.addPattern ("Half cadence", "iv V", false);
+        matcher.addPattern ("Half cadence", "VI V", false);
+        matcher.addPattern ("Plagal cadence", "iv i", false);
+        matcher.addPattern ("Deceptive cadence", "V VI", false);
+        matcher.addPattern ("ii-V-i", "ii V i", false);
+        matcher.addPattern ("Circle of fifths", "VI ii V i", false);
+        matcher.addPattern ("Circle of fifths", "III VI ii V i", false);
+    }
+    matcher.compile();
+    return matcher;
+}
+
+std::vector<int> ProgressionMatcher::parseNumerals (const std::string& numerals, bool major)
+{
+    std::vector<int> ids;
+    std::string token;
+
+    auto endToken = [&ids, &token, major]
+    {
+        if (token.empty())
+        {
+            return true;
+        }
+        int id = parseNumeral (token, major);
+        token.clear();
+        if (id < 0)
+        {
+            return false;
+        }
+        ids.push_back (id);
+        return true;
+    };
+
+    for (size_t i = 0; i < numerals.size(); ++i)
+    {
+        const char c = numerals[i];
+        if (c == ' ' || c == '\t' || c == '-' || c == ',' || numerals.compare (i, 3, "\xe2\x80\x93") == 0)
+        {
+            if (! endToken())
+            {
+                return {};
+            }
+            // skip the rest of the en dash
+            if (c == '\xe2')
+            {
+                i += 2;
+            }
+        } else
+        {
+            token += c;
+        }
+    }
+    if (! endToken())
+    {
+        return {};
+    }
+    return ids;
+}
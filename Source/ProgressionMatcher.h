@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ChordAnalysis.h"
+
+//==============================================================================
+// Recognises cadences and progression patterns in a stream of roman numerals.
+//
+// Patterns are sequences of numeral ids (see ChordResult::getNumeralId()) compiled into a single
+// Aho-Corasick automaton, so each new chord advances the state with one table lookup no matter
+// how many patterns are loaded. The compiled matcher is read-only, and each stream of chords
+// keeps its own State, so one matcher can be shared by any number of streams.
+class ProgressionMatcher
+{
+public:
+    struct Pattern
+    {
+        std::string name;
+        std::vector<int> numerals;
+    };
+
+    // position of a stream being matched
+    struct State
+    {
+        int node = 0;
+        int lastNumeral = -1;
+        // pattern ending on the last chord, -1 if none
+        int match = -1;
+    };
+
+    // a pattern found by scan(), ending at the chord with index position
+    struct Match
+    {
+        size_t position;
+        int pattern;
+    };
+
+    ProgressionMatcher();
+
+    // adds a pattern written as roman numerals separated by spaces or dashes, e.g. "ii V I"
+    // numerals are read in the context of a major or minor key, and accidentals (b or #) are allowed
+    // returns false if the pattern could not be parsed
+    bool addPattern (const std::string& name, const std::string& numerals, bool major);
+
+    void addPattern (const std::string& name, const std::vector<int>& numerals);
+
+    // adds patterns written one per line in the form "name: ii V I", lines starting with # are skipped
+    // returns the number of patterns added
+    int addPatterns (const std::string& lines, bool major);
+
+    // builds the automaton, must be called after adding patterns and before matching
+    void compile();
+
+    int getNumPatterns() const;
+
+    const Pattern& getPattern (int index) const;
+
+    // advances state by one chord, repeated numerals and unidentified chords are ignored
+    // returns true if the state moved, in which case state.match holds the pattern that was
+    // completed (or -1)
+    bool feed (State& state, const ChordResult& chord) const;
+
+    bool feed (State& state, int numeralId) const;
+
+    // finds every pattern in a whole sequence of numeral ids, for batch analysis
+    std::vector<Match> scan (const std::vector<int>& numeralIds) const;
+
+    // cadences and common progressions
+    static ProgressionMatcher createDefault (bool major);
+
+    // converts a pattern string to numeral ids, returns an empty vector if it could not be parsed
+    static std::vector<int> parseNumerals (const std::string& numerals, bool major);
+
+private:
+    std::vector<Pattern> patterns;
+
+    // goto function with failure links already folded in, numNumerals entries per node
+    std::vector<int> transitions;
+
+    // longest pattern ending at each node (including through failure links), -1 if none
+    std::vector<int> output;
+
+    // trie built by addPattern(), turned into transitions by compile()
+    std::vector<std::vector<int>> trie;
+    std::vector<int> trieOutput;
+};
@@ -0,0 +1,263 @@
+#include "SaxParser.h"
+#include <cstdlib>
+
+namespace
+{
+    bool isSpace (char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    // appends a unicode code point as UTF-8
+    void appendUtf8 (std::string& s, unsigned long c)
+    {
+        if (c < 0x80)
+        {
+            s += static_cast<char>(c);
+        } else if (c < 0x800)
+        {
+            s += static_cast<char>(0xc0 | (c >> 6));
+            s += static_cast<char>(0x80 | (c & 0x3f));
+        } else if (c < 0x10000)
+        {
+            s += static_cast<char>(0xe0 | (c >> 12));
+            s += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+            s += static_cast<char>(0x80 | (c & 0x3f));
+        } else
+        {
+            s += static_cast<char>(0xf0 | (c >> 18));
+            s += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+            s += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+            s += static_cast<char>(0x80 | (c & 0x3f));
+        }
+    }
+}
+
+//==============================================================================
+SaxParser::SaxParser (Handler& h)
+  : handler (h)
+{
+}
+
+bool SaxParser::feed (const char* data, size_t size)
+{
+    if (failed)
+    {
+        return false;
+    }
+    buffer.append (data, size);
+
+    size_t position = 0;
+    while (position < buffer.size())
+    {
+        if (buffer[position] != '<')
+        {
+            // text runs up to the next tag, wait for more data if it isn't here yet
+            auto tag = buffer.find ('<', position);
+            if (tag == std::string::npos)
+            {
+                break;
+            }
+            handler.characters (decode (buffer.substr (position, tag - position)));
+            position = tag;
+            continue;
+        }
+
+        // find where this markup ends
+        size_t end;
+        size_t skip;
+        if (buffer.compare (position, 4, "<!--") == 0)
+        {
+            end = buffer.find ("-->", position + 4);
+            skip = 3;
+        } else if (buffer.compare (position, 9, "<![CDATA[") == 0)
+        {
+            end = buffer.find ("]]>", position + 9);
+            skip = 3;
+        } else if ((buffer.size() - position < 4 && buffer.compare (position, 2, "<!") == 0)
+                   || (buffer.size() - position < 9 && buffer.compare (position, 3, "<![") == 0))
+        {
+            // can't tell if this is a comment or CDATA until more data arrives
+            break;
+        } else
+        {
+            // '>' can't appear unescaped inside markup other than in attribute values, which MusicXML doesn't do
+            end = buffer.find ('>', position + 1);
+            skip = 1;
+        }
+        if (end == std::string::npos)
+        {
+            break;
+        }
+
+        if (! parseMarkup (position, end + skip))
+        {
+            failed = true;
+            return false;
+        }
+        position = end + skip;
+    }
+
+    buffer.erase (0, position);
+    return true;
+}
+
+bool SaxParser::finish()
+{
+    if (failed)
+    {
+        return false;
+    }
+    // trailing whitespace is fine, anything else means the document was cut short
+    for (auto c : buffer)
+    {
+        if (! isSpace (c))
+        {
+            return false;
+        }
+    }
+    buffer.clear();
+    return true;
+}
+
+std::string SaxParser::getAttribute (const Attributes& attributes, const std::string& name)
+{
+    for (auto& attribute : attributes)
+    {
+        if (attribute.first == name)
+        {
+            return attribute.second;
+        }
+    }
+    return {};
+}
+
+bool SaxParser::parseMarkup (size_t start, size_t end)
+{
+    const std::string& b = buffer;
+
+    if (b.compare (start, 9, "<![CDATA[") == 0)
+    {
+        handler.characters (b.substr (start + 9, end - 3 - (start + 9)));
+        return true;
+    }
+    // comments, processing instructions and the DOCTYPE
+    if (b[start + 1] == '!' || b[start + 1] == '?')
+    {
+        return true;
+    }
+
+    if (b[start + 1] == '/')
+    {
+        size_t i = start + 2;
+        name.clear();
+        while (i < end - 1 && ! isSpace (b[i]))
+        {
+            name += b[i++];
+        }
+        if (name.empty())
+        {
+            return false;
+        }
+        handler.endElement (name);
+        return true;
+    }
+
+    const bool selfClosing = b[end - 2] == '/';
+    const size_t last = selfClosing ? end - 2 : end - 1;
+
+    size_t i = start + 1;
+    name.clear();
+    while (i < last && ! isSpace (b[i]))
+    {
+        name += b[i++];
+    }
+    if (name.empty())
+    {
+        return false;
+    }
+
+    attributes.clear();
+    while (i < last)
+    {
+        while (i < last && isSpace (b[i]))
+        {
+            ++i;
+        }
+        if (i >= last)
+        {
+            break;
+        }
+        auto equals = b.find ('=', i);
+        if (equals == std::string::npos || equals >= last)
+        {
+            return false;
+        }
+        size_t nameEnd = equals;
+        while (nameEnd > i && isSpace (b[nameEnd - 1]))
+        {
+            --nameEnd;
+        }
+        size_t quote = equals + 1;
+        while (quote < last && isSpace (b[quote]))
+        {
+            ++quote;
+        }
+        if (quote >= last || (b[quote] != '"' && b[quote] != '\''))
+        {
+            return false;
+        }
+        auto valueEnd = b.find (b[quote], quote + 1);
+        if (valueEnd == std::string::npos || valueEnd >= last)
+        {
+            return false;
+        }
+        attributes.emplace_back (b.substr (i, nameEnd - i), decode (b.substr (quote + 1, valueEnd - quote - 1)));
+        i = valueEnd + 1;
+    }
+
+    handler.startElement (name, attributes);
+    if (selfClosing)
+    {
+        handler.endElement (name);
+    }
+    return true;
+}
+
+std::string SaxParser::decode (const std::string& text)
+{
+    if (text.find ('&') == std::string::npos)
+    {
+        return text;
+    }
+
+    std::string decoded;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        auto semicolon = text[i] == '&' ? text.find (';', i) : std::string::npos;
+        if (semicolon == std::string::npos)
+        {
+            decoded += text[i];
+            continue;
+        }
+
+        auto entity = text.substr (i + 1, semicolon - i - 1);
+        if (entity == "amp")        decoded += '&';
+        else if (entity == "lt")    decoded += '<';
+        else if (entity == "gt")    decoded += '>';
+        else if (entity == "quot")  decoded += '"';
+        else if (entity == "apos")  decoded += '\'';
+        else if (entity.size() > 1 && entity[0] == '#')
+        {
+            const bool hex = entity[1] == 'x' || entity[1] == 'X';
+            appendUtf8 (decoded, std::strtoul (entity.c_str() + (hex ? 2 : 1), nullptr, hex ? 16 : 10));
+        }
+        else
+        {
+            // unknown entities are kept as they are
+            decoded += text.substr (i, semicolon - i + 1);
+        }
+        i = semicolon;
+    }
+    return decoded;
+}
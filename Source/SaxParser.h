@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+//==============================================================================
+// Minimal streaming XML parser.
+//
+// Data is pushed in chunks of any size with feed(), and elements and text are reported to a
+// Handler as soon as they are complete, so a document is never held in memory as a whole.
+// Only what is needed to read MusicXML is supported: elements, attributes, text and the
+// predefined and numeric entities. Comments, processing instructions, CDATA and the DOCTYPE
+// are skipped (CDATA text is reported as characters).
+class SaxParser
+{
+public:
+    using Attributes = std::vector<std::pair<std::string, std::string>>;
+
+    class Handler
+    {
+    public:
+        virtual ~Handler() = default;
+
+        virtual void startElement (const std::string& name, const Attributes& attributes) = 0;
+
+        virtual void endElement (const std::string& name) = 0;
+
+        // text between tags, possibly split over several calls
+        virtual void characters (const std::string& text) = 0;
+    };
+
+    explicit SaxParser (Handler& h);
+
+    // returns false once the document is found to be malformed
+    bool feed (const char* data, size_t size);
+
+    // returns false if the document ended in the middle of markup
+    bool finish();
+
+    // value of an attribute, or an empty string if it isn't there
+    static std::string getAttribute (const Attributes& attributes, const std::string& name);
+
+private:
+    // returns false if the markup is malformed
+    bool parseMarkup (size_t start, size_t end);
+
+    static std::string decode (const std::string& text);
+
+    Handler& handler;
+
+    // unparsed data, always starting at a '<' or at text
+    std::string buffer;
+    bool failed = false;
+
+    // reused between calls so that parsing doesn't allocate for every element
+    Attributes attributes;
+    std::string name;
+};
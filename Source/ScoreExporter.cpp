@@ -0,0 +1,550 @@
+#include "ScoreExporter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // divisions per quarter note, so the grid is a sixteenth note
+    const int divisions = 4;
+
+    // durations in divisions that can be written as a single note, longest first
+    const int noteDurations[8] = {16, 12, 8, 6, 4, 3, 2, 1};
+
+    const char* const sharpSteps[12] = {"C", "C", "D", "D", "E", "F", "F", "G", "G", "A", "A", "B"};
+    const int sharpAlters[12] = {0, 1, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0};
+    const char* const flatSteps[12] = {"C", "D", "D", "E", "E", "F", "G", "G", "A", "A", "B", "B"};
+    const int flatAlters[12] = {0, -1, 0, -1, 0, 0, -1, 0, -1, 0, -1, 0};
+
+    const char* const lilySharpNames[12] = {"c", "cis", "d", "dis", "e", "f", "fis", "g", "gis", "a", "ais", "b"};
+    const char* const lilyFlatNames[12] = {"c", "des", "d", "ees", "e", "f", "ges", "g", "aes", "a", "bes", "b"};
+
+    // a quantised part of an entry that can be written as one note (or chord) without crossing a barline
+    struct Piece
+    {
+        int64_t measure;
+        int start;
+        int duration;
+        // nullptr for rests
+        const SessionRecorder::Entry* entry;
+        bool tieStop;
+        bool tieStart;
+        // first piece of the entry, where its numeral is written
+        bool chordStart;
+    };
+
+    int getLongestDuration (int available)
+    {
+        for (auto duration : noteDurations)
+        {
+            if (duration <= available)
+            {
+                return duration;
+            }
+        }
+        return 1;
+    }
+
+    void getNoteType (int duration, const char*& type, int& dots)
+    {
+        dots = (duration == 12 || duration == 6 || duration == 3) ? 1 : 0;
+        switch (dots ? duration * 2 / 3 : duration)
+        {
+            case 16: type = "whole"; break;
+            case 8:  type = "half"; break;
+            case 4:  type = "quarter"; break;
+            case 2:  type = "eighth"; break;
+            default: type = "16th"; break;
+        }
+    }
+
+    const char* getLilyDuration (int duration)
+    {
+        switch (duration)
+        {
+            case 16: return "1";
+            case 12: return "2.";
+            case 8:  return "2";
+            case 6:  return "4.";
+            case 4:  return "4";
+            case 3:  return "8.";
+            case 2:  return "8";
+            default: return "16";
+        }
+    }
+
+    std::string escapeXml (const std::string& s)
+    {
+        std::string escaped;
+        for (auto c : s)
+        {
+            switch (c)
+            {
+                case '&': escaped += "&amp;"; break;
+                case '<': escaped += "&lt;"; break;
+                case '>': escaped += "&gt;"; break;
+                case '"': escaped += "&quot;"; break;
+                default:  escaped += c; break;
+            }
+        }
+        return escaped;
+    }
+
+    // figures from the top down, e.g. {"6", "4"}
+    std::vector<std::string> getFigures (const ChordResult& result)
+    {
+        std::vector<std::string> figures;
+        std::string figure;
+        for (const char* c = result.figures; *c != 0; ++c)
+        {
+            if (*c == '\n')
+            {
+                figures.push_back (figure);
+                figure.clear();
+            } else
+            {
+                figure += *c;
+            }
+        }
+        if (! figure.empty())
+        {
+            figures.push_back (figure);
+        }
+        return figures;
+    }
+
+    // splits the recording into pieces and passes them in order to callback, rests included
+    template <typename Callback>
+    void forEachPiece (const std::vector<SessionRecorder::Entry>& entries, const ScoreExporter::Options& options, Callback&& callback)
+    {
+        const int measureLength = options.beatsPerMeasure * divisions;
+
+        // the score starts with the first note
+        auto first = std::find_if (entries.begin(), entries.end(), [] (const SessionRecorder::Entry& e) { return ! e.isEmpty(); });
+        if (first == entries.end())
+        {
+            return;
+        }
+        const double startTime = first->time;
+        auto quantise = [&] (double time)
+        {
+            return static_cast<int64_t>(std::llround ((time - startTime) / options.secondsPerBeat * divisions));
+        };
+
+        for (auto it = first; it != entries.end(); ++it)
+        {
+            int64_t start = quantise (it->time);
+            int64_t end = start;
+            if (it + 1 != entries.end())
+            {
+                end = quantise ((it + 1)->time);
+            } else if (! it->isEmpty())
+            {
+                // nothing says how long the last chord was held, so give it a beat
+                end = start + divisions;
+            }
+
+            // entries shorter than the grid (e.g. a chord still being rolled) are dropped
+            const SessionRecorder::Entry* entry = it->isEmpty() ? nullptr : &*it;
+            for (int64_t position = start; position < end;)
+            {
+                int within = static_cast<int>(position % measureLength);
+                int available = static_cast<int>(std::min<int64_t> (end - position, measureLength - within));
+                int duration = getLongestDuration (available);
+
+                callback (Piece { position / measureLength, within, duration, entry,
+                                  entry != nullptr && position != start,
+                                  entry != nullptr && position + duration < end,
+                                  position == start });
+                position += duration;
+            }
+        }
+    }
+
+    //==============================================================================
+    class MusicXmlWriter
+    {
+    public:
+        MusicXmlWriter (std::ostream& o, const ScoreExporter::Options& opts)
+          : out (o), options (opts), measureLength (opts.beatsPerMeasure * divisions)
+        {
+            // a measure never has more pieces than grid positions
+            pieces.reserve (static_cast<size_t>(measureLength));
+
+            out << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
+                << "<!DOCTYPE score-partwise PUBLIC \"-//Recordare//DTD MusicXML 3.1 Partwise//EN\" \"http://www.musicxml.org/dtds/partwise.dtd\">\n"
+                << "<score-partwise version=\"3.1\">\n"
+                << "  <work><work-title>" << escapeXml (options.title) << "</work-title></work>\n"
+                << "  <identification><encoding><software>Chord Identifier</software></encoding></identification>\n"
+                << "  <part-list><score-part id=\"P1\"><part-name>Piano</part-name></score-part></part-list>\n"
+                << "  <part id=\"P1\">\n";
+        }
+
+        void add (const Piece& piece)
+        {
+            if (piece.measure != measure)
+            {
+                flushMeasure();
+                measure = piece.measure;
+            }
+            pieces.push_back (piece);
+        }
+
+        void finish()
+        {
+            flushMeasure();
+            out << "  </part>\n"
+                << "</score-partwise>\n";
+        }
+
+    private:
+        void flushMeasure()
+        {
+            if (pieces.empty())
+            {
+                return;
+            }
+
+            out << "    <measure number=\"" << measure + 1 << "\">\n";
+
+            // key changes are written at the start of the measure they happen in
+            int key = currentKey;
+            for (auto& piece : pieces)
+            {
+                if (piece.entry != nullptr && piece.entry->key != 0)
+                {
+                    key = piece.entry->key;
+                    break;
+                }
+            }
+            if (measure == 0)
+            {
+                currentKey = key;
+                out << "      <attributes>\n"
+                    << "        <divisions>" << divisions << "</divisions>\n";
+                writeKey();
+                out << "        <time><beats>" << options.beatsPerMeasure << "</beats><beat-type>4</beat-type></time>\n"
+                    << "        <staves>2</staves>\n"
+                    << "        <clef number=\"1\"><sign>G</sign><line>2</line></clef>\n"
+                    << "        <clef number=\"2\"><sign>F</sign><line>4</line></clef>\n"
+                    << "      </attributes>\n";
+            } else if (key != currentKey)
+            {
+                currentKey = key;
+                out << "      <attributes>\n";
+                writeKey();
+                out << "      </attributes>\n";
+            }
+
+            // treble staff takes middle C and above
+            for (auto& piece : pieces)
+            {
+                writePiece (piece, 1);
+            }
+            padMeasure (1);
+            out << "      <backup><duration>" << measureLength << "</duration></backup>\n";
+            for (auto& piece : pieces)
+            {
+                writePiece (piece, 2);
+            }
+            padMeasure (2);
+
+            out << "    </measure>\n";
+            pieces.clear();
+        }
+
+        void writeKey()
+        {
+            out << "        <key><fifths>" << ChordAnalysis::getFifths (currentKey) << "</fifths><mode>"
+                << (ChordAnalysis::isMajor (currentKey) ? "major" : "minor") << "</mode></key>\n";
+        }
+
+        void writePiece (const Piece& piece, int staff)
+        {
+            const int low = staff == 1 ? 60 : 0;
+            const int high = staff == 1 ? 128 : 60;
+            ChordResult result;
+            int key = currentKey;
+            if (piece.entry != nullptr)
+            {
+                result = ChordAnalysis::unpack (piece.entry->result);
+                key = piece.entry->key;
+            }
+            const bool labelled = staff == 2 && piece.chordStart && result.valid;
+
+            // figured bass comes before the note it belongs to
+            if (labelled && *result.figures != 0)
+            {
+                out << "      <figured-bass>";
+                for (auto& figure : getFigures (result))
+                {
+                    out << "<figure><figure-number>" << figure << "</figure-number></figure>";
+                }
+                out << "<duration>" << piece.duration << "</duration></figured-bass>\n";
+            }
+
+            bool first = true;
+            if (piece.entry != nullptr)
+            {
+                for (int note = low; note < high; ++note)
+                {
+                    if (piece.entry->hasNote (note))
+                    {
+                        writeNote (note, piece, staff, first, labelled ? ChordAnalysis::getNumeralText (result, key) : std::string());
+                        first = false;
+                    }
+                }
+            }
+            if (first)
+            {
+                writeRest (piece.duration, staff, labelled ? ChordAnalysis::getNumeralText (result, key) : std::string());
+            }
+            position[staff - 1] = piece.start + piece.duration;
+        }
+
+        void writeNote (int note, const Piece& piece, int staff, bool first, const std::string& lyric)
+        {
+            const bool sharps = ChordAnalysis::getFifths (currentKey) >= 0;
+            const int pitchClass = note % 12;
+            const int alter = sharps ? sharpAlters[pitchClass] : flatAlters[pitchClass];
+            const char* type;
+            int dots;
+            getNoteType (piece.duration, type, dots);
+
+            out << "      <note>";
+            if (! first)
+            {
+                out << "<chord/>";
+            }
+            out << "<pitch><step>" << (sharps ? sharpSteps[pitchClass] : flatSteps[pitchClass]) << "</step>";
+            if (alter != 0)
+            {
+                out << "<alter>" << alter << "</alter>";
+            }
+            out << "<octave>" << note / 12 - 1 << "</octave></pitch>"
+                << "<duration>" << piece.duration << "</duration>";
+            if (piece.tieStop)
+            {
+                out << "<tie type=\"stop\"/>";
+            }
+            if (piece.tieStart)
+            {
+                out << "<tie type=\"start\"/>";
+            }
+            out << "<voice>" << staff << "</voice><type>" << type << "</type>";
+            for (int i = 0; i < dots; ++i)
+            {
+                out << "<dot/>";
+            }
+            out << "<staff>" << staff << "</staff>";
+            if (piece.tieStop || piece.tieStart)
+            {
+                out << "<notations>";
+                if (piece.tieStop)
+                {
+                    out << "<tied type=\"stop\"/>";
+                }
+                if (piece.tieStart)
+                {
+                    out << "<tied type=\"start\"/>";
+                }
+                out << "</notations>";
+            }
+            if (first && ! lyric.empty())
+            {
+                out << "<lyric><syllabic>single</syllabic><text>" << escapeXml (lyric) << "</text></lyric>";
+            }
+            out << "</note>\n";
+        }
+
+        void writeRest (int duration, int staff, const std::string& lyric)
+        {
+            const char* type;
+            int dots;
+            getNoteType (duration, type, dots);
+
+            out << "      <note><rest/><duration>" << duration << "</duration>"
+                << "<voice>" << staff << "</voice><type>" << type << "</type>";
+            for (int i = 0; i < dots; ++i)
+            {
+                out << "<dot/>";
+            }
+            out << "<staff>" << staff << "</staff>";
+            if (! lyric.empty())
+            {
+                out << "<lyric><syllabic>single</syllabic><text>" << escapeXml (lyric) << "</text></lyric>";
+            }
+            out << "</note>\n";
+        }
+
+        // fills the rest of the last measure
+        void padMeasure (int staff)
+        {
+            int& filled = position[staff - 1];
+            while (filled < measureLength)
+            {
+                int duration = getLongestDuration (measureLength - filled);
+                writeRest (duration, staff, {});
+                filled += duration;
+            }
+            filled = 0;
+        }
+
+        std::ostream& out;
+        const ScoreExporter::Options& options;
+        const int measureLength;
+
+        std::vector<Piece> pieces;
+        int64_t measure = 0;
+        int currentKey = 1;
+        int position[2] = {0, 0};
+    };
+
+    //==============================================================================
+    class LilyPondWriter
+    {
+    public:
+        LilyPondWriter (std::ostream& o, const ScoreExporter::Options& opts)
+          : out (o), measureLength (opts.beatsPerMeasure * divisions)
+        {
+            std::string title;
+            for (auto c : opts.title)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    title += '\\';
+                }
+                title += c;
+            }
+
+            out << "\\version \"2.22.0\"\n"
+                << "\\header { title = \"" << title << "\" tagline = ##f }\n"
+                << "\\new Staff {\n"
+                << "  \\clef treble\n"
+                << "  \\time " << opts.beatsPerMeasure << "/4\n";
+        }
+
+        void add (const Piece& piece)
+        {
+            if (piece.entry == nullptr)
+            {
+                out << "  r" << getLilyDuration (piece.duration);
+            } else
+            {
+                if (piece.entry->key != 0 && piece.entry->key != currentKey)
+                {
+                    currentKey = piece.entry->key;
+                    writeKey();
+                }
+                writeChord (piece);
+            }
+            // one measure per line keeps the file readable
+            if (piece.start + piece.duration == measureLength)
+            {
+                out << " |\n";
+            } else
+            {
+                out << "\n";
+            }
+        }
+
+        void finish()
+        {
+            out << "  \\bar \"|.\"\n"
+                << "}\n";
+        }
+
+    private:
+        void writeKey()
+        {
+            int tonic = ChordAnalysis::getTonic (currentKey);
+            const bool sharps = ChordAnalysis::getFifths (currentKey) >= 0;
+            // C flat major is the only key whose tonic isn't spelled by the flat names
+            const char* name = currentKey == 29 ? "ces" : (sharps ? lilySharpNames[tonic] : lilyFlatNames[tonic]);
+            out << "  \\key " << name << (ChordAnalysis::isMajor (currentKey) ? " \\major" : " \\minor") << "\n";
+        }
+
+        void writeChord (const Piece& piece)
+        {
+            const bool sharps = ChordAnalysis::getFifths (currentKey) >= 0;
+            out << "  <";
+            bool first = true;
+            for (int note = 0; note < 128; ++note)
+            {
+                if (! piece.entry->hasNote (note))
+                {
+                    continue;
+                }
+                if (! first)
+                {
+                    out << ' ';
+                }
+                first = false;
+                out << (sharps ? lilySharpNames[note % 12] : lilyFlatNames[note % 12]);
+                // c without marks is the octave below middle C
+                for (int octave = note / 12 - 1; octave > 3; --octave)
+                {
+                    out << '\'';
+                }
+                for (int octave = note / 12 - 1; octave < 3; ++octave)
+                {
+                    out << ',';
+                }
+            }
+            out << '>' << getLilyDuration (piece.duration);
+            if (piece.tieStart)
+            {
+                out << '~';
+            }
+
+            auto result = ChordAnalysis::unpack (piece.entry->result);
+            if (piece.chordStart && result.valid)
+            {
+                out << "_\\markup \\concat { \"" << ChordAnalysis::getNumeralText (result, piece.entry->key) << "\"";
+                auto figures = getFigures (result);
+                if (! figures.empty())
+                {
+                    out << " \\raise #1 \\teeny \\column {";
+                    for (auto& figure : figures)
+                    {
+                        out << ' ' << figure;
+                    }
+                    out << " }";
+                }
+                out << " }";
+            }
+        }
+
+        std::ostream& out;
+        const int measureLength;
+        int currentKey = 0;
+    };
+}
+
+//==============================================================================
+bool ScoreExporter::writeMusicXml (const std::vector<SessionRecorder::Entry>& entries, std::ostream& out, const Options& options)
+{
+    MusicXmlWriter writer (out, options);
+    bool any = false;
+    forEachPiece (entries, options, [&] (const Piece& piece)
+    {
+        writer.add (piece);
+        any = true;
+    });
+    writer.finish();
+    out.flush();
+    return any && out.good();
+}
+
+bool ScoreExporter::writeLilyPond (const std::vector<SessionRecorder::Entry>& entries, std::ostream& out, const Options& options)
+{
+    LilyPondWriter writer (out, options);
+    bool any = false;
+    forEachPiece (entries, options, [&] (const Piece& piece)
+    {
+        writer.add (piece);
+        any = true;
+    });
+    writer.finish();
+    out.flush();
+    return any && out.good();
+}
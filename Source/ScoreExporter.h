@@ -0,0 +1,30 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "SessionRecorder.h"
+
+//==============================================================================
+// Writes a recorded session as a score, with the roman numeral of each chord as a lyric under
+// the bass and its figured bass alongside, matching what ChordComponent displays.
+//
+// Entries are quantised to a sixteenth note grid and written in a single pass, holding at most
+// one measure at a time, so the memory used doesn't depend on the length of the session.
+namespace ScoreExporter
+{
+    struct Options
+    {
+        // tempo used to quantise the recording, a beat is a quarter note
+        double secondsPerBeat = 0.5;
+        int beatsPerMeasure = 4;
+        std::string title = "Chord Identifier session";
+    };
+
+    // MusicXML partwise score on a grand staff
+    // returns false if there was nothing to write or the stream failed
+    bool writeMusicXml (const std::vector<SessionRecorder::Entry>& entries, std::ostream& out, const Options& options);
+
+    // LilyPond score on a single staff, with numerals and figures as markups
+    bool writeLilyPond (const std::vector<SessionRecorder::Entry>& entries, std::ostream& out, const Options& options);
+}
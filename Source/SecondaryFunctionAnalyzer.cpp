@@ -0,0 +1,357 @@
+#include "SecondaryFunctionAnalyzer.h"
+
+namespace
+{
+    // degrees an applied chord can tonicize (the major and minor triads of the key), indexed by
+    // chromatic degree: 1 for a major target, 0 for a minor one, -1 if it isn't one
+    const int majorTargets[12] = {-1, -1, 0, -1, 0, 1, -1, 1, -1, 0, -1, -1};
+    const int minorTargets[12] = {-1, -1, -1, 1, -1, 0, -1, 1, 1, -1, 1, -1};
+
+    // pitch classes of the key above the tonic, minor keys have both the natural and the harmonic
+    // minor seventh so that mixture chords (III and VII in minor) aren't taken for applied ones
+    const int majorScale = 0xab5;
+    const int minorScale = 0xdad;
+
+    bool isInKey (uint16_t pitchClasses, int key)
+    {
+        const int tonic = ChordAnalysis::getTonic (key);
+        const int relative = ((pitchClasses >> tonic) | (pitchClasses << (12 - tonic))) & 0xfff;
+        return (relative & ~(ChordAnalysis::isMajor (key) ? majorScale : minorScale)) == 0;
+    }
+
+    // superscript digits in UTF-8, indexed by digit
+    const char* const superscripts[10] =
+    {
+        "\xe2\x81\xb0", "\xc2\xb9", "\xc2\xb2", "\xc2\xb3", "\xe2\x81\xb4",
+        "\xe2\x81\xb5", "\xe2\x81\xb6", "\xe2\x81\xb7", "\xe2\x81\xb8", "\xe2\x81\xb9"
+    };
+
+    // key number with the tonic on pitch class, the first one found if it has two spellings
+    int getKeyWithTonic (int pitchClass, bool major)
+    {
+        for (int k = 1; k <= ChordAnalysis::numKeys; ++k)
+        {
+            if (ChordAnalysis::getTonic (k) == pitchClass && ChordAnalysis::isMajor (k) == major)
+            {
+                return k;
+            }
+        }
+        return 0;
+    }
+
+    // key of the target, spelled on the same side of the circle of fifths as the key
+    int getTargetKey (int key, int target, bool major)
+    {
+        // fifths from the relative major of the key to the relative major of the target
+        int relative = 7 * (target + (major ? 0 : 3)) - 7 * (ChordAnalysis::isMajor (key) ? 0 : 3);
+        int delta = (relative % 12 + 12) % 12;
+        if (delta > 6)
+        {
+            delta -= 12;
+        }
+        int fifths = ChordAnalysis::getFifths (key) + delta;
+        if (fifths > 7)
+        {
+            fifths -= 12;
+        } else if (fifths < -7)
+        {
+            fifths += 12;
+        }
+        return ChordAnalysis::getKeyFromFifths (fifths, major);
+    }
+
+    void appendFigures (std::string& text, const char* figures)
+    {
+        for (auto figure = figures; *figure != 0; ++figure)
+        {
+            if (*figure >= '0' && *figure <= '9')
+            {
+                text += superscripts[*figure - '0'];
+            }
+        }
+    }
+}
+
+// degrees a chord type over a bass (relative to the tonic) can tonicize in major or minor keys
+struct SecondaryFunctionAnalyzer::Entry
+{
+    // bit i is set if the chord can resolve to a chord on chromatic degree i, bit 0 only for a
+    // diminished seventh, which is the leading tone chord of the key itself when it goes to i
+    uint16_t targets = 0;
+
+    // the chord read in the key of each target, packed, 0 where it isn't applied
+    std::array<uint16_t, 12> applied {};
+
+    // target assumed when the chord doesn't resolve, -1 if it could be more than one
+    int fallback = -1;
+};
+
+const SecondaryFunctionAnalyzer::Entry& SecondaryFunctionAnalyzer::getEntry (bool major, int chordType, int bassDegree)
+{
+    using EntryTable = std::array<std::array<std::array<Entry, 12>, ChordAnalysis::numChordTypes>, 2>;
+
+    static const EntryTable table = []
+    {
+        EntryTable t {};
+
+        // an interval mask for every chord type
+        std::array<int, ChordAnalysis::numChordTypes> masks;
+        masks.fill (-1);
+        for (int mask = 0; mask < 4096; ++mask)
+        {
+            int type = ChordAnalysis::getChordType (static_cast<uint16_t>(mask));
+            if (type >= 0 && masks[static_cast<size_t>(type)] < 0)
+            {
+                masks[static_cast<size_t>(type)] = mask;
+            }
+        }
+
+        for (int minor = 0; minor < 2; ++minor)
+        {
+            auto& targets = minor ? minorTargets : majorTargets;
+            for (int type = 0; type < ChordAnalysis::numChordTypes; ++type)
+            {
+                auto mask = static_cast<uint16_t>(masks[static_cast<size_t>(type)]);
+                for (int bass = 0; bass < 12; ++bass)
+                {
+                    auto& entry = t[static_cast<size_t>(minor)][static_cast<size_t>(type)][static_cast<size_t>(bass)];
+
+                    // roots that make the chord a dominant (a fifth above the target) or a
+                    // leading tone chord (a semitone below it)
+                    std::vector<int> roots;
+                    bool leadingTone = true;
+                    bool needsMajorTarget = false;
+                    switch (static_cast<Chord>(type))
+                    {
+                        case Chord::MajTriadRoot:
+                        case Chord::MajTriadFirst:
+                        case Chord::SeventhRoot:
+                        case Chord::SeventhFirst:
+                        case Chord::SeventhSecond:
+                        case Chord::SeventhThird:
+                            // identified in C major, the root is the degree
+                            roots.push_back (ChordAnalysis::identify (mask, bass, 1).chromaticDegree);
+                            leadingTone = false;
+                            break;
+                        case Chord::HalfDimSeventhRoot:
+                        case Chord::HalfDimSeventhFirst:
+                        case Chord::HalfDimSeventhSecond:
+                        case Chord::HalfDimSeventhThird:
+                            // viiø7 only leads to a major chord
+                            needsMajorTarget = true;
+                            roots.push_back (ChordAnalysis::identify (mask, bass, 1).chromaticDegree);
+                            break;
+                        case Chord::DimTriadRoot:
+                        case Chord::DimTriadFirst:
+                            roots.push_back (ChordAnalysis::identify (mask, bass, 1).chromaticDegree);
+                            break;
+                        case Chord::DimSeventh:
+                            // symmetrical, any of its notes can be the root
+                            for (int root = bass; root < bass + 12; root += 3)
+                            {
+                                roots.push_back (root % 12);
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+
+                    int numApplied = 0;
+                    for (auto root : roots)
+                    {
+                        int target = (root + (leadingTone ? 1 : 5)) % 12;
+                        if (target == 0 && static_cast<Chord>(type) == Chord::DimSeventh)
+                        {
+                            entry.targets |= 1;
+                            continue;
+                        }
+                        int capital = targets[target];
+                        if (capital < 0 || (needsMajorTarget && capital == 0))
+                        {
+                            continue;
+                        }
+                        // read in the key of the target the chord is diatonic, e.g. V7 or viio7
+                        auto result = ChordAnalysis::identify (mask, bass, getKeyWithTonic (target, capital == 1));
+                        if (result.valid)
+                        {
+                            entry.targets |= static_cast<uint16_t>(1 << target);
+                            entry.applied[static_cast<size_t>(target)] = ChordAnalysis::pack (result);
+                            entry.fallback = target;
+                            ++numApplied;
+                        }
+                    }
+                    if (numApplied != 1 || static_cast<Chord>(type) == Chord::DimSeventh)
+                    {
+                        entry.fallback = -1;
+                    }
+                }
+            }
+        }
+        return t;
+    }();
+    return table[major ? 0 : 1][static_cast<size_t>(chordType)][static_cast<size_t>(bassDegree)];
+}
+
+//==============================================================================
+SecondaryFunctionAnalyzer::SecondaryFunctionAnalyzer (size_t l)
+  : lookahead (l < 1 ? 1 : (l > maxLookahead ? maxLookahead : l))
+{
+    // build the table before the first chord arrives
+    getEntry (true, 0, 0);
+}
+
+void SecondaryFunctionAnalyzer::setKey (int k)
+{
+    key = k;
+    first = 0;
+    numPending = 0;
+    pendingPitchClasses = 0;
+}
+
+int SecondaryFunctionAnalyzer::getKey() const
+{
+    return key;
+}
+
+void SecondaryFunctionAnalyzer::add (const std::vector<int>& notes, std::vector<Label>& labels)
+{
+    if (notes.size() < 3)
+    {
+        return;
+    }
+    add (ChordAnalysis::getIntervalMask (notes), notes[0], labels);
+}
+
+void SecondaryFunctionAnalyzer::add (uint16_t intervalMask, int bassNote, std::vector<Label>& labels)
+{
+    if (key < 1 || key > ChordAnalysis::numKeys || bassNote < 0)
+    {
+        return;
+    }
+
+    Pending chord;
+    chord.result = ChordAnalysis::identify (intervalMask, bassNote, key);
+    int type = ChordAnalysis::getChordType (intervalMask);
+    if (type >= 0)
+    {
+        int bass = (bassNote - ChordAnalysis::getTonic (key) + 12) % 12;
+        chord.entry = &getEntry (ChordAnalysis::isMajor (key), type, bass);
+    }
+
+    // pitch classes relative to the bass, rotated up to it
+    uint16_t intervals = static_cast<uint16_t>((intervalMask & 0xfff) | 1);
+    int shift = bassNote % 12;
+    auto pitchClasses = static_cast<uint16_t>(((intervals << shift) | (intervals >> (12 - shift))) & 0xfff);
+
+    if (numPending > 0)
+    {
+        if (pitchClasses == pendingPitchClasses)
+        {
+            // the same chord again, or reinverted, still waiting for its resolution
+            // an inversion without a chord type (e.g. a second inversion diminished triad) has
+            // the same pitch classes, so it takes the targets of the chord held
+            if (chord.entry == nullptr)
+            {
+                chord.entry = pending[first].entry;
+            }
+            if (numPending == lookahead)
+            {
+                decide (pending[first], pending[first].entry->fallback, false, labels);
+                first = (first + 1) % maxLookahead;
+                --numPending;
+            }
+            pending[(first + numPending) % maxLookahead] = chord;
+            ++numPending;
+            return;
+        }
+
+        // every chord held back has the same pitch classes, so the same targets
+        int degree = chord.result.chromaticDegree;
+        bool resolved = chord.result.valid && ((pending[first].entry->targets >> degree) & 1) != 0;
+        for (size_t i = 0; i < numPending; ++i)
+        {
+            auto& held = pending[(first + i) % maxLookahead];
+            decide (held, resolved ? degree : held.entry->fallback, resolved, labels);
+        }
+        first = 0;
+        numPending = 0;
+    }
+
+    // only chromatic chords are applied, a diminished seventh is always held back as it is
+    // spelled from the chord it goes to
+    bool dimSeventh = type == static_cast<int>(Chord::DimSeventh);
+    if (chord.entry != nullptr && chord.entry->targets != 0 && (dimSeventh || ! isInKey (pitchClasses, key)))
+    {
+        pending[0] = chord;
+        numPending = 1;
+        pendingPitchClasses = pitchClasses;
+        return;
+    }
+    decide (chord, -1, false, labels);
+}
+
+void SecondaryFunctionAnalyzer::flush (std::vector<Label>& labels)
+{
+    for (size_t i = 0; i < numPending; ++i)
+    {
+        auto& held = pending[(first + i) % maxLookahead];
+        decide (held, held.entry->fallback, false, labels);
+    }
+    first = 0;
+    numPending = 0;
+}
+
+bool SecondaryFunctionAnalyzer::checkReinversions()
+{
+    // C#-E-G, then G-C#-E (which has no chord type), then C in C major
+    SecondaryFunctionAnalyzer analyzer;
+    analyzer.setKey (ChordAnalysis::getKeyFromFifths (0, true));
+    std::vector<Label> labels;
+    for (auto& notes : std::vector<std::vector<int>> { {61, 64, 67}, {55, 61, 64}, {60, 64, 67} })
+    {
+        analyzer.add (notes, labels);
+    }
+    analyzer.flush (labels);
+    return labels.size() == 3;
+}
+
+size_t SecondaryFunctionAnalyzer::getNumPending() const
+{
+    return numPending;
+}
+
+std::string SecondaryFunctionAnalyzer::getText (const Label& label, int key)
+{
+    std::string text;
+    if (label.applied)
+    {
+        text = ChordAnalysis::getNumeralText (label.appliedResult, label.targetKey);
+        appendFigures (text, label.appliedResult.figures);
+        auto spelling = ChordAnalysis::spell (label.target, label.targetCapital, key);
+        text += "/";
+        text += spelling.accidental;
+        text += spelling.numeral;
+    } else if (label.result.valid)
+    {
+        text = ChordAnalysis::getNumeralText (label.result, key);
+        appendFigures (text, label.result.figures);
+    }
+    return text;
+}
+
+//==============================================================================
+void SecondaryFunctionAnalyzer::decide (const Pending& chord, int target, bool resolved, std::vector<Label>& labels) const
+{
+    Label label;
+    label.result = chord.result;
+    if (chord.entry != nullptr && target > 0 && chord.entry->applied[static_cast<size_t>(target)] != 0)
+    {
+        label.applied = true;
+        label.resolved = resolved;
+        label.appliedResult = ChordAnalysis::unpack (chord.entry->applied[static_cast<size_t>(target)]);
+        label.target = target;
+        label.targetCapital = (ChordAnalysis::isMajor (key) ? majorTargets : minorTargets)[target] == 1;
+        label.targetKey = getTargetKey (key, target, label.targetCapital);
+    }
+    labels.push_back (label);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ChordAnalysis.h"
+
+//==============================================================================
+// Labels applied chords (secondary dominants and leading tone chords, e.g. V65/V or viio7/ii)
+// from how they resolve.
+//
+// A chromatic chord (with a tone outside the major scale, or outside both the natural and
+// harmonic minor) that could tonicize a degree of the key is held back until the next
+// different chord arrives, and labelled as applied to it if it is the chord it tonicizes. A
+// diminished seventh can tonicize four degrees, so only its resolution says which of them it
+// belongs to (and how it is spelled). The degrees each chord can tonicize, and how it reads in
+// each of their keys, come from a table built once for every chord type over every bass in
+// major and minor keys, so deciding a chord is a lookup and a bit test. At most lookahead
+// chords are held back (a chord repeated or reinverted before it resolves), the oldest is
+// decided unresolved once the buffer is full. The buffer is fixed size.
+class SecondaryFunctionAnalyzer
+{
+public:
+    static const size_t defaultLookahead = 4;
+    static const size_t maxLookahead = 8;
+
+    // how a chord was decided
+    struct Label
+    {
+        // the chord as identify() reads it in the key (not valid for e.g. a diminished seventh
+        // that isn't on the leading tone)
+        ChordResult result;
+
+        // set if the chord is an applied chord
+        bool applied = false;
+
+        // set if it went on to the chord it tonicizes, otherwise it is the only degree it could
+        bool resolved = false;
+
+        // the chord read in the key of its target, e.g. V65 for V65/V
+        ChordResult appliedResult;
+
+        // the degree it tonicizes, in the key
+        int target = 0;
+        bool targetCapital = false;
+
+        // key number of the target
+        int targetKey = 0;
+    };
+
+    explicit SecondaryFunctionAnalyzer (size_t lookahead = defaultLookahead);
+
+    // forgets the chords held back
+    void setKey (int key);
+
+    int getKey() const;
+
+    // adds the next chord (notes sorted in ascending order), appending every chord this decides
+    // to labels, in the order they were added
+    void add (const std::vector<int>& notes, std::vector<Label>& labels);
+
+    void add (uint16_t intervalMask, int bassNote, std::vector<Label>& labels);
+
+    // decides the chords held back as unresolved, e.g. at the end of a piece
+    void flush (std::vector<Label>& labels);
+
+    size_t getNumPending() const;
+
+    // returns true if a held chord reinverted into an inversion with no chord type, then
+    // followed by another chord, is decided like any other
+    static bool checkReinversions();
+
+    // e.g. "V⁶⁵/V" for an applied chord, "vii°⁷" otherwise, empty if the chord wasn't identified
+    static std::string getText (const Label& label, int key);
+
+private:
+    struct Entry;
+
+    struct Pending
+    {
+        ChordResult result;
+        const Entry* entry = nullptr;
+    };
+
+    // degrees a chord type over a bass (relative to the tonic) can tonicize, from a table of
+    // every chord type over every bass in major and minor keys
+    static const Entry& getEntry (bool major, int chordType, int bassDegree);
+
+    void decide (const Pending& chord, int target, bool resolved, std::vector<Label>& labels) const;
+
+    int key = 0;
+    size_t lookahead;
+
+    // chords held back, all with the same pitch classes
+    std::array<Pending, maxLookahead> pending;
+    size_t first = 0;
+    size_t numPending = 0;
+    uint16_t pendingPitchClasses = 0;
+};
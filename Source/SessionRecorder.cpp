@@ -0,0 +1,65 @@
+#include "SessionRecorder.h"
+
+bool SessionRecorder::Entry::hasNote (int note) const
+{
+    return note >= 0 && note < 128 && ((notes[note / 64] >> (note % 64)) & 1) != 0;
+}
+
+bool SessionRecorder::Entry::isEmpty() const
+{
+    return notes[0] == 0 && notes[1] == 0;
+}
+
+//==============================================================================
+SessionRecorder::SessionRecorder()
+{
+    // about an hour of steady playing before the first reallocation
+    entries.reserve (8192);
+}
+
+void SessionRecorder::setRecording (bool shouldRecord)
+{
+    recording = shouldRecord;
+}
+
+bool SessionRecorder::isRecording() const
+{
+    return recording;
+}
+
+void SessionRecorder::record (double time, const std::vector<int>& notes, const ChordResult& result, int key)
+{
+    if (! recording)
+    {
+        return;
+    }
+
+    Entry entry { time, {0, 0}, ChordAnalysis::pack (result), static_cast<uint8_t>(key) };
+    for (auto note : notes)
+    {
+        if (note >= 0 && note < 128)
+        {
+            entry.notes[note / 64] |= uint64_t (1) << (note % 64);
+        }
+    }
+
+    if (! entries.empty())
+    {
+        auto& last = entries.back();
+        if (last.notes[0] == entry.notes[0] && last.notes[1] == entry.notes[1] && last.key == entry.key)
+        {
+            return;
+        }
+    }
+    entries.push_back (entry);
+}
+
+const std::vector<SessionRecorder::Entry>& SessionRecorder::getEntries() const
+{
+    return entries;
+}
+
+void SessionRecorder::clear()
+{
+    entries.clear();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ChordAnalysis.h"
+
+//==============================================================================
+// Records the history of a session, one entry every time the held notes change, so that
+// it can be exported as a score afterwards.
+//
+// Each entry is 32 bytes, so even hours of playing only take a few megabytes.
+class SessionRecorder
+{
+public:
+    struct Entry
+    {
+        // seconds, using the same clock as NoteEvent
+        double time;
+        // one bit per midi note number
+        uint64_t notes[2];
+        // ChordResult packed with ChordAnalysis::pack()
+        uint16_t result;
+        uint8_t key;
+
+        bool hasNote (int note) const;
+        bool isEmpty() const;
+    };
+
+    SessionRecorder();
+
+    void setRecording (bool shouldRecord);
+
+    bool isRecording() const;
+
+    // notes must be sorted in ascending order, entries that don't change the notes or key are skipped
+    void record (double time, const std::vector<int>& notes, const ChordResult& result, int key);
+
+    const std::vector<Entry>& getEntries() const;
+
+    void clear();
+
+private:
+    bool recording = false;
+    std::vector<Entry> entries;
+};
@@ -0,0 +1,134 @@
+#include "SessionStatistics.h"
+
+namespace
+{
+    uint64_t toMicroseconds (double seconds)
+    {
+        return seconds > 0.0 ? static_cast<uint64_t>(seconds * 1e6) : 0;
+    }
+}
+
+//==============================================================================
+SessionStatistics::SessionStatistics()
+{
+    clear();
+}
+
+void SessionStatistics::record (double time, const ChordResult& result, int numNotes, int key)
+{
+    // the previous chord lasted until now
+    const auto elapsed = toMicroseconds (time - lastTime);
+    if (lastSymbol >= 0)
+    {
+        increment (symbolMicroseconds[static_cast<size_t>(lastSymbol)], elapsed);
+        increment (numeralMicroseconds[static_cast<size_t>(lastNumeral)], elapsed);
+    }
+    if (lastKey >= 1 && lastKey <= ChordAnalysis::numKeys)
+    {
+        increment (keyMicroseconds[static_cast<size_t>(lastKey - 1)], elapsed);
+    }
+    increment (updates, 1u);
+
+    // the same chord identified again (a note doubled or released) only adds to its time
+    const int heldKey = numNotes > 0 ? key : 0;
+    const bool changed = result.getSymbolId() != lastSymbol || heldKey != lastKey;
+    lastTime = time;
+    lastSymbol = result.getSymbolId();
+    lastNumeral = result.getNumeralId();
+    lastKey = heldKey;
+
+    if (! changed || numNotes < 3 || key < 1 || key > ChordAnalysis::numKeys)
+    {
+        return;
+    }
+    if (! result.valid)
+    {
+        increment (unidentified, 1u);
+        return;
+    }
+
+    increment (identified, 1u);
+    increment (symbolCounts[static_cast<size_t>(lastSymbol)], 1u);
+    increment (numeralCounts[static_cast<size_t>(lastNumeral)], 1u);
+    increment (inversionCounts[static_cast<size_t>(ChordAnalysis::getInversion (result))], 1u);
+    increment (keyCounts[static_cast<size_t>(key - 1)], 1u);
+}
+
+void SessionStatistics::recordOnsets (const OnsetGrouper& grouper)
+{
+    onsetEvents.store (static_cast<uint32_t>(grouper.getNumEvents()), std::memory_order_relaxed);
+    onsetGroups.store (static_cast<uint32_t>(grouper.getNumGroups()), std::memory_order_relaxed);
+    averageOnsetMicroseconds.store (toMicroseconds (grouper.getAverageLatency()), std::memory_order_relaxed);
+    maxOnsetMicroseconds.store (toMicroseconds (grouper.getMaxLatency()), std::memory_order_relaxed);
+    increment (updates, 1u);
+}
+
+SessionStatistics::Snapshot SessionStatistics::getSnapshot() const
+{
+    Snapshot snapshot;
+    for (size_t i = 0; i < symbolCounts.size(); ++i)
+    {
+        snapshot.symbolCounts[i] = symbolCounts[i].load (std::memory_order_relaxed);
+        snapshot.symbolSeconds[i] = static_cast<double>(symbolMicroseconds[i].load (std::memory_order_relaxed)) * 1e-6;
+    }
+    for (size_t i = 0; i < numeralCounts.size(); ++i)
+    {
+        snapshot.numeralCounts[i] = numeralCounts[i].load (std::memory_order_relaxed);
+        snapshot.numeralSeconds[i] = static_cast<double>(numeralMicroseconds[i].load (std::memory_order_relaxed)) * 1e-6;
+    }
+    for (size_t i = 0; i < inversionCounts.size(); ++i)
+    {
+        snapshot.inversionCounts[i] = inversionCounts[i].load (std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < keyCounts.size(); ++i)
+    {
+        snapshot.keyCounts[i] = keyCounts[i].load (std::memory_order_relaxed);
+        snapshot.keySeconds[i] = static_cast<double>(keyMicroseconds[i].load (std::memory_order_relaxed)) * 1e-6;
+    }
+    snapshot.identified = identified.load (std::memory_order_relaxed);
+    snapshot.unidentified = unidentified.load (std::memory_order_relaxed);
+    snapshot.onsetEvents = onsetEvents.load (std::memory_order_relaxed);
+    snapshot.onsetGroups = onsetGroups.load (std::memory_order_relaxed);
+    snapshot.averageOnsetLatency = static_cast<double>(averageOnsetMicroseconds.load (std::memory_order_relaxed)) * 1e-6;
+    snapshot.maxOnsetLatency = static_cast<double>(maxOnsetMicroseconds.load (std::memory_order_relaxed)) * 1e-6;
+    snapshot.updates = updates.load (std::memory_order_relaxed);
+    return snapshot;
+}
+
+void SessionStatistics::clear()
+{
+    for (auto& counter : symbolCounts)         counter.store (0, std::memory_order_relaxed);
+    for (auto& counter : symbolMicroseconds)   counter.store (0, std::memory_order_relaxed);
+    for (auto& counter : numeralCounts)        counter.store (0, std::memory_order_relaxed);
+    for (auto& counter : numeralMicroseconds)  counter.store (0, std::memory_order_relaxed);
+    for (auto& counter : inversionCounts)      counter.store (0, std::memory_order_relaxed);
+    for (auto& counter : keyCounts)            counter.store (0, std::memory_order_relaxed);
+    for (auto& counter : keyMicroseconds)      counter.store (0, std::memory_order_relaxed);
+    identified.store (0, std::memory_order_relaxed);
+    unidentified.store (0, std::memory_order_relaxed);
+    onsetEvents.store (0, std::memory_order_relaxed);
+    onsetGroups.store (0, std::memory_order_relaxed);
+    averageOnsetMicroseconds.store (0, std::memory_order_relaxed);
+    maxOnsetMicroseconds.store (0, std::memory_order_relaxed);
+    updates.store (0, std::memory_order_relaxed);
+    lastSymbol = -1;
+    lastNumeral = -1;
+    lastKey = 0;
+}
+
+//==============================================================================
+double SessionStatistics::Snapshot::getUnidentifiedRate() const
+{
+    const auto total = identified + unidentified;
+    return total > 0 ? static_cast<double>(unidentified) / total : 0.0;
+}
+
+int SessionStatistics::Snapshot::getNumKeysUsed() const
+{
+    int used = 0;
+    for (auto count : keyCounts)
+    {
+        used += count > 0 ? 1 : 0;
+    }
+    return used;
+}
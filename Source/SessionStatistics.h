@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include "ChordAnalysis.h"
+#include "OnsetGrouper.h"
+
+//==============================================================================
+// Running statistics of a session for assessment: how often each chord symbol (numeral,
+// quality and inversion) was played and for how long, how many chords were not identified,
+// and how much of the session was spent in each key.
+//
+// Counters are fixed size arrays of atomics indexed by the symbol and key ids, written by the
+// one thread that identifies chords with plain relaxed stores (no read-modify-write, no locks)
+// and read by a dashboard taking periodic snapshots. A snapshot taken during an update can be
+// one chord behind in some counters, which doesn't matter for statistics.
+class SessionStatistics
+{
+public:
+    SessionStatistics();
+
+    //-----Writer side, the thread identifying chords-----
+
+    // records the chord now held, with numNotes notes, and closes the time of the previous one
+    // time is in seconds, on the clock of the note events
+    // a chord is only counted when its symbol or key changes, otherwise its time goes on
+    void record (double time, const ChordResult& result, int numNotes, int key);
+
+    // copies the latency added by the onset window of the grouper that feeds record()
+    void recordOnsets (const OnsetGrouper& grouper);
+
+    //-----Reader side, any thread-----
+    struct Snapshot
+    {
+        std::array<uint32_t, ChordAnalysis::numSymbols> symbolCounts {};
+        std::array<double, ChordAnalysis::numSymbols> symbolSeconds {};
+        // the same by numeral only (degree and case), in any quality and inversion
+        std::array<uint32_t, ChordAnalysis::numNumerals> numeralCounts {};
+        std::array<double, ChordAnalysis::numNumerals> numeralSeconds {};
+        // root position, then first to third inversion
+        std::array<uint32_t, 4> inversionCounts {};
+        std::array<uint32_t, ChordAnalysis::numKeys> keyCounts {};
+        std::array<double, ChordAnalysis::numKeys> keySeconds {};
+        // chords of 3 or more notes
+        uint32_t identified = 0;
+        uint32_t unidentified = 0;
+        // note events grouped by the onset window, and the latency it added to each group
+        uint32_t onsetEvents = 0;
+        uint32_t onsetGroups = 0;
+        double averageOnsetLatency = 0.0;
+        double maxOnsetLatency = 0.0;
+        // number of updates, so a reader can tell if anything changed
+        uint32_t updates = 0;
+
+        // fraction of chords of 3 or more notes that weren't identified
+        double getUnidentifiedRate() const;
+
+        // number of keys that were used for at least one identified chord
+        int getNumKeysUsed() const;
+    };
+
+    Snapshot getSnapshot() const;
+
+private:
+    void clear();
+
+    // single writer, so a load and a store is enough and cheaper than fetch_add
+    template <typename T>
+    static void increment (std::atomic<T>& counter, T amount)
+    {
+        counter.store (counter.load (std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    // times are counted in microseconds, so they can be atomic integers too
+    std::array<std::atomic<uint32_t>, ChordAnalysis::numSymbols> symbolCounts;
+    std::array<std::atomic<uint64_t>, ChordAnalysis::numSymbols> symbolMicroseconds;
+    std::array<std::atomic<uint32_t>, ChordAnalysis::numNumerals> numeralCounts;
+    std::array<std::atomic<uint64_t>, ChordAnalysis::numNumerals> numeralMicroseconds;
+    std::array<std::atomic<uint32_t>, 4> inversionCounts;
+    std::array<std::atomic<uint32_t>, ChordAnalysis::numKeys> keyCounts;
+    std::array<std::atomic<uint64_t>, ChordAnalysis::numKeys> keyMicroseconds;
+    std::atomic<uint32_t> identified { 0 };
+    std::atomic<uint32_t> unidentified { 0 };
+    std::atomic<uint32_t> onsetEvents { 0 };
+    std::atomic<uint32_t> onsetGroups { 0 };
+    std::atomic<uint64_t> averageOnsetMicroseconds { 0 };
+    std::atomic<uint64_t> maxOnsetMicroseconds { 0 };
+    std::atomic<uint32_t> updates { 0 };
+
+    //-----Writer state-----
+    double lastTime = 0.0;
+    int lastSymbol = -1;
+    int lastNumeral = -1;
+    int lastKey = 0;
+};
@@ -0,0 +1,93 @@
+#include "SharedMemoryOutput.h"
+
+#if JUCE_LINUX || JUCE_MAC
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+
+SharedMemoryOutput::~SharedMemoryOutput()
+{
+    close();
+}
+
+bool SharedMemoryOutput::open (const juce::String& segmentName, const juce::StringArray& names)
+{
+    close();
+    const int numSlots = juce::jmin (names.size(), CHORDID_SHM_MAX_SLOTS);
+
+    // a segment left by a crash is replaced, readers still mapping it see it was never closed
+    shm_unlink (segmentName.toRawUTF8());
+    const int descriptor = shm_open (segmentName.toRawUTF8(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (descriptor < 0)
+    {
+        return false;
+    }
+    const size_t segmentSize = sizeof (chordid_shm_header) + static_cast<size_t>(numSlots) * sizeof (chordid_shm_slot);
+    void* mapped = MAP_FAILED;
+    if (ftruncate (descriptor, static_cast<off_t>(segmentSize)) == 0)
+    {
+        mapped = mmap (nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    }
+    ::close (descriptor);
+    if (mapped == MAP_FAILED)
+    {
+        shm_unlink (segmentName.toRawUTF8());
+        return false;
+    }
+    name = segmentName;
+    memory = mapped;
+    size = segmentSize;
+
+    // the segment starts zeroed, so only the header and the names are written
+    auto& header = *static_cast<chordid_shm_header*>(memory);
+    header.layout_version = CHORDID_SHM_LAYOUT_VERSION;
+    header.header_size = sizeof (chordid_shm_header);
+    header.slot_size = sizeof (chordid_shm_slot);
+    header.num_slots = static_cast<uint32_t>(numSlots);
+    header.writer_pid = static_cast<uint32_t>(getpid());
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto& slot = *getSlot (i);
+        slot.symbol_id = -1;
+        slot.numeral_id = -1;
+        slot.progression = -1;
+        names[i].copyToUTF8 (slot.name, sizeof (slot.name));
+    }
+
+    // magic last, so a reader that sees it sees the rest of the header too
+    reinterpret_cast<std::atomic<uint64_t>&>(header.magic).store (CHORDID_SHM_MAGIC, std::memory_order_release);
+    return true;
+}
+
+void SharedMemoryOutput::close()
+{
+    if (memory == nullptr)
+    {
+        return;
+    }
+    auto& header = *static_cast<chordid_shm_header*>(memory);
+    reinterpret_cast<std::atomic<uint64_t>&>(header.magic).store (0, std::memory_order_release);
+    munmap (memory, size);
+    shm_unlink (name.toRawUTF8());
+    memory = nullptr;
+    size = 0;
+}
+
+int SharedMemoryOutput::getNumSlots() const
+{
+    return memory == nullptr ? 0 : static_cast<int>(static_cast<const chordid_shm_header*>(memory)->num_slots);
+}
+
+chordid_shm_slot* SharedMemoryOutput::getSlot (int index)
+{
+    if (index < 0 || index >= getNumSlots())
+    {
+        return nullptr;
+    }
+    return reinterpret_cast<chordid_shm_slot*>(static_cast<char*>(memory) + sizeof (chordid_shm_header)) + index;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_LINUX || JUCE_MAC
+
+#include <cstddef>
+#include "chordid_shm.h"
+
+//==============================================================================
+/*
+    POSIX shared memory segment that ChordPublishers mirror their results to, so that other
+    programs on the same machine (recording or grading tools) can map it read only and poll
+    the live chord without any system call or copy on the way. The layout is described by
+    chordid_shm.h, which is all a reader needs.
+*/
+class SharedMemoryOutput
+{
+public:
+    SharedMemoryOutput() = default;
+    ~SharedMemoryOutput();
+
+    // creates the segment with a slot per name (at most CHORDID_SHM_MAX_SLOTS), replacing any
+    // left behind by an app that didn't quit cleanly, segmentName starts with a slash
+    bool open (const juce::String& segmentName, const juce::StringArray& names);
+
+    // tells readers the segment is gone, then unlinks and unmaps it
+    // nothing may still be publishing to its slots
+    void close();
+
+    int getNumSlots() const;
+
+    // to pass to ChordPublisher::setSharedSlot()
+    chordid_shm_slot* getSlot (int index);
+
+private:
+    juce::String name;
+    void* memory = nullptr;
+    size_t size = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedMemoryOutput)
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "StatisticsComponent.h"
+
+namespace
+{
+    juce::String formatSeconds (double seconds)
+    {
+        return seconds < 60.0 ? juce::String (seconds, 1) + " s"
+                              : juce::String (static_cast<int>(seconds / 60.0)) + " min " + juce::String (static_cast<int>(seconds) % 60) + " s";
+    }
+}
+
+//==============================================================================
+StatisticsComponent::StatisticsComponent (const SessionStatistics& s, std::function<int()> getKey)
+  : statistics (s), keyFunction (std::move (getKey))
+{
+    setOpaque (true);
+    setSize (520, 720);
+    timerCallback();
+    startTimerHz (2);
+}
+
+StatisticsComponent::~StatisticsComponent()
+{
+    stopTimer();
+}
+
+juce::DialogWindow* StatisticsComponent::show (const juce::String& title, const SessionStatistics& statistics, std::function<int()> getKey)
+{
+    juce::DialogWindow::LaunchOptions options;
+    options.dialogTitle = title;
+    options.dialogBackgroundColour = juce::Desktop::getInstance().getDefaultLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId);
+    options.content.setOwned (new StatisticsComponent (statistics, std::move (getKey)));
+    options.escapeKeyTriggersCloseButton = true;
+    options.useNativeTitleBar = true;
+    options.resizable = true;
+    return options.launchAsync();
+}
+
+void StatisticsComponent::timerCallback()
+{
+    auto latest = statistics.getSnapshot();
+    if (hasSnapshot && latest.updates == snapshot.updates)
+    {
+        return;
+    }
+    snapshot = latest;
+    hasSnapshot = true;
+    repaint();
+}
+
+void StatisticsComponent::paint (juce::Graphics& g)
+{
+    auto& lf = getLookAndFeel();
+    g.fillAll (lf.findColour (juce::ResizableWindow::backgroundColourId));
+
+    auto area = getLocalBounds().reduced (10);
+    const int total = static_cast<int>(snapshot.identified + snapshot.unidentified);
+
+    g.setColour (lf.findColour (juce::Label::textColourId));
+    g.setFont (juce::Font (16.0f));
+    g.drawText (juce::String (total) + " chords, " + juce::String (snapshot.getUnidentifiedRate() * 100.0, 1) + "% unidentified, "
+                + juce::String (snapshot.getNumKeysUsed()) + " of " + juce::String (ChordAnalysis::numKeys) + " keys used",
+                area.removeFromTop (24), juce::Justification::centredLeft);
+    if (snapshot.onsetGroups > 0)
+    {
+        g.setFont (juce::Font (14.0f));
+        g.drawText ("Onset window: " + juce::String (snapshot.onsetEvents) + " notes in " + juce::String (snapshot.onsetGroups) + " groups, "
+                    + juce::String (snapshot.averageOnsetLatency * 1000.0, 1) + " ms average, "
+                    + juce::String (snapshot.maxOnsetLatency * 1000.0, 1) + " ms max latency",
+                    area.removeFromTop (20), juce::Justification::centredLeft);
+    }
+
+    int key = keyFunction != nullptr ? keyFunction() : 0;
+    if (key < 1 || key > ChordAnalysis::numKeys)
+    {
+        key = 1;
+    }
+
+    // numerals that were played, in order of degree
+    juce::StringArray labels, valueTexts;
+    juce::Array<double> values;
+    for (int numeral = 0; numeral < ChordAnalysis::numNumerals; ++numeral)
+    {
+        auto count = snapshot.numeralCounts[static_cast<size_t>(numeral)];
+        if (count == 0)
+        {
+            continue;
+        }
+        auto spelling = ChordAnalysis::spell (numeral / 2, numeral % 2, key);
+        labels.add (juce::String (juce::CharPointer_UTF8 (spelling.accidental)) + spelling.numeral);
+        values.add (count);
+        valueTexts.add (juce::String (count) + "  (" + formatSeconds (snapshot.numeralSeconds[static_cast<size_t>(numeral)]) + ")");
+    }
+    drawBars (g, area.removeFromTop (area.getHeight() * 3 / 10), "Numerals", labels, values, valueTexts);
+
+    // chord symbols, which tell the inversions of a numeral apart (V7 and V65)
+    labels.clear();
+    values.clear();
+    valueTexts.clear();
+    for (int symbol = 0; symbol < ChordAnalysis::numSymbols; ++symbol)
+    {
+        auto count = snapshot.symbolCounts[static_cast<size_t>(symbol)];
+        if (count == 0)
+        {
+            continue;
+        }
+        auto result = ChordAnalysis::fromSymbolId (symbol);
+        labels.add (juce::String::fromUTF8 (ChordAnalysis::getNumeralText (result, key).c_str())
+                    + juce::String (result.figures).removeCharacters ("\n"));
+        values.add (count);
+        valueTexts.add (juce::String (count) + "  (" + formatSeconds (snapshot.symbolSeconds[static_cast<size_t>(symbol)]) + ")");
+    }
+    drawBars (g, area.removeFromTop (area.getHeight() * 3 / 7), "Chords", labels, values, valueTexts);
+
+    static const char* const inversionNames[4] = {"Root", "1st", "2nd", "3rd"};
+    labels.clear();
+    values.clear();
+    valueTexts.clear();
+    for (size_t i = 0; i < snapshot.inversionCounts.size(); ++i)
+    {
+        labels.add (inversionNames[i]);
+        values.add (snapshot.inversionCounts[i]);
+        valueTexts.add (juce::String (snapshot.inversionCounts[i]));
+    }
+    drawBars (g, area.removeFromTop (area.getHeight() * 2 / 5), "Inversions", labels, values, valueTexts);
+
+    labels.clear();
+    values.clear();
+    valueTexts.clear();
+    for (int k = 1; k <= ChordAnalysis::numKeys; ++k)
+    {
+        auto count = snapshot.keyCounts[static_cast<size_t>(k - 1)];
+        if (count == 0)
+        {
+            continue;
+        }
+        labels.add (juce::String (juce::CharPointer_UTF8 (ChordAnalysis::getKeyName (k))));
+        values.add (snapshot.keySeconds[static_cast<size_t>(k - 1)]);
+        valueTexts.add (juce::String (count) + "  (" + formatSeconds (snapshot.keySeconds[static_cast<size_t>(k - 1)]) + ")");
+    }
+    drawBars (g, area, "Keys", labels, values, valueTexts);
+}
+
+void StatisticsComponent::drawBars (juce::Graphics& g, juce::Rectangle<int> area, const juce::String& title,
+                                    const juce::StringArray& labels, const juce::Array<double>& values, const juce::StringArray& valueTexts)
+{
+    auto textColour = getLookAndFeel().findColour (juce::Label::textColourId);
+    g.setColour (textColour);
+    g.setFont (juce::Font (15.0f, juce::Font::bold));
+    g.drawText (title, area.removeFromTop (22), juce::Justification::centredLeft);
+
+    if (labels.isEmpty())
+    {
+        return;
+    }
+
+    double largest = 0.0;
+    for (auto value : values)
+    {
+        largest = juce::jmax (largest, value);
+    }
+
+    const int rowHeight = juce::jmin (20, area.getHeight() / labels.size());
+    if (rowHeight < 4)
+    {
+        return;
+    }
+    g.setFont (juce::Font (rowHeight * 0.75f));
+    for (int i = 0; i < labels.size(); ++i)
+    {
+        auto row = area.removeFromTop (rowHeight);
+        g.setColour (textColour);
+        g.drawText (labels[i], row.removeFromLeft (90), juce::Justification::centredLeft);
+        auto text = row.removeFromRight (110);
+        g.drawText (valueTexts[i], text, juce::Justification::centredRight);
+
+        auto width = largest > 0.0 ? static_cast<int>(row.getWidth() * values[i] / largest) : 0;
+        g.setColour (juce::Colours::cornflowerblue);
+        g.fillRect (row.removeFromLeft (width).reduced (0, 2));
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include "SessionStatistics.h"
+
+//==============================================================================
+/*
+    Dashboard of a SessionStatistics: histograms of the numerals and inversions played, the
+    time spent on each numeral, the unidentified chord rate, the keys used and the latency added
+    by the onset window.
+
+    The statistics are only read on a slow timer, as a snapshot, and only repainted when
+    something was recorded since the last one, so the dashboard costs nothing on the note path.
+*/
+class StatisticsComponent : public juce::Component,
+                            private juce::Timer
+{
+public:
+    // getKey returns the key used to spell the numerals, statistics must outlive the component
+    StatisticsComponent (const SessionStatistics& s, std::function<int()> getKey);
+    ~StatisticsComponent() override;
+
+    void paint (juce::Graphics& g) override;
+
+    // opens the dashboard in its own window, which the caller should delete when statistics goes away
+    static juce::DialogWindow* show (const juce::String& title, const SessionStatistics& statistics, std::function<int()> getKey);
+
+private:
+    void timerCallback() override;
+
+    // horizontal bars, one row per label, scaled to the largest value
+    void drawBars (juce::Graphics& g, juce::Rectangle<int> area, const juce::String& title,
+                   const juce::StringArray& labels, const juce::Array<double>& values, const juce::StringArray& valueTexts);
+
+    const SessionStatistics& statistics;
+    std::function<int()> keyFunction;
+
+    SessionStatistics::Snapshot snapshot;
+    bool hasSnapshot = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StatisticsComponent)
+};
@@ -0,0 +1,218 @@
+#include "Trace.h"
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // Chrome trace event phases
+    const char slicePhase = 'X';
+    const char flowStartPhase = 's';
+    const char flowEndPhase = 'f';
+
+    // written by the thread that owns the ring, read by write(), hence relaxed atomics
+    struct Event
+    {
+        std::atomic<const char*> name { nullptr };
+        std::atomic<char> phase { 0 };
+        std::atomic<int64_t> start { 0 };
+        std::atomic<int64_t> duration { 0 };
+        std::atomic<uint64_t> id { 0 };
+    };
+
+    struct Ring
+    {
+        std::array<Event, Trace::ringSize> events;
+        // events claimed, bumped before a slot is overwritten so write() can tell
+        std::atomic<uint64_t> claimed { 0 };
+        // events completely written
+        std::atomic<uint64_t> head { 0 };
+        std::atomic<const char*> threadName { nullptr };
+        int threadId = 0;
+    };
+
+    // rings are only added, so a thread can keep a pointer to its own for good
+    std::mutex ringsLock;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    std::atomic<uint64_t> nextFlowId { 1 };
+
+    thread_local Ring* threadRing = nullptr;
+
+    Ring& getRing()
+    {
+        if (threadRing == nullptr)
+        {
+            auto ring = std::make_unique<Ring>();
+            std::lock_guard<std::mutex> lock (ringsLock);
+            ring->threadId = static_cast<int>(rings.size()) + 1;
+            threadRing = ring.get();
+            rings.push_back (std::move (ring));
+        }
+        return *threadRing;
+    }
+
+    void record (const char* name, char phase, int64_t start, int64_t duration, uint64_t id)
+    {
+        auto& ring = getRing();
+        auto index = ring.head.load (std::memory_order_relaxed);
+        ring.claimed.store (index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+
+        auto& event = ring.events[index % Trace::ringSize];
+        event.name.store (name, std::memory_order_relaxed);
+        event.phase.store (phase, std::memory_order_relaxed);
+        event.start.store (start, std::memory_order_relaxed);
+        event.duration.store (duration, std::memory_order_relaxed);
+        event.id.store (id, std::memory_order_relaxed);
+        ring.head.store (index + 1, std::memory_order_release);
+    }
+
+    void writeString (std::ostream& out, const char* s)
+    {
+        out << '"';
+        for (; *s != 0; ++s)
+        {
+            if (*s == '"' || *s == '\\')
+            {
+                out << '\\';
+            }
+            out << *s;
+        }
+        out << '"';
+    }
+
+    struct EventCopy
+    {
+        const char* name;
+        char phase;
+        int64_t start;
+        int64_t duration;
+        uint64_t id;
+    };
+}
+
+std::atomic<bool> Trace::enabled { false };
+
+//==============================================================================
+void Trace::setEnabled (bool shouldBeEnabled)
+{
+    enabled.store (shouldBeEnabled, std::memory_order_relaxed);
+}
+
+int64_t Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::setThreadName (const char* name)
+{
+    getRing().threadName.store (name, std::memory_order_relaxed);
+}
+
+void Trace::addSlice (const char* name, int64_t start, int64_t end)
+{
+    if (isEnabled())
+    {
+        record (name, slicePhase, start, end - start, 0);
+    }
+}
+
+void Trace::addFlowStart (const char* name, uint64_t id)
+{
+    if (isEnabled())
+    {
+        record (name, flowStartPhase, now(), 0, id);
+    }
+}
+
+void Trace::addFlowEnd (const char* name, uint64_t id)
+{
+    if (isEnabled())
+    {
+        record (name, flowEndPhase, now(), 0, id);
+    }
+}
+
+uint64_t Trace::getNextFlowId()
+{
+    return nextFlowId.fetch_add (1, std::memory_order_relaxed);
+}
+
+bool Trace::write (std::ostream& out)
+{
+    std::vector<Ring*> snapshot;
+    {
+        std::lock_guard<std::mutex> lock (ringsLock);
+        for (auto& ring : rings)
+        {
+            snapshot.push_back (ring.get());
+        }
+    }
+
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    auto separate = [&out, &first]
+    {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    std::vector<EventCopy> events;
+    for (auto ring : snapshot)
+    {
+        // copy the ring, then keep only what wasn't overwritten while copying
+        auto head = ring->head.load (std::memory_order_acquire);
+        auto begin = head > static_cast<uint64_t>(ringSize) ? head - ringSize : 0;
+        events.clear();
+        for (auto i = begin; i < head; ++i)
+        {
+            auto& event = ring->events[i % ringSize];
+            events.push_back ({ event.name.load (std::memory_order_relaxed), event.phase.load (std::memory_order_relaxed),
+                                event.start.load (std::memory_order_relaxed), event.duration.load (std::memory_order_relaxed),
+                                event.id.load (std::memory_order_relaxed) });
+        }
+        std::atomic_thread_fence (std::memory_order_acquire);
+        auto claimed = ring->claimed.load (std::memory_order_relaxed);
+        auto valid = claimed > static_cast<uint64_t>(ringSize) ? claimed - ringSize : 0;
+
+        separate();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadId << ",\"args\":{\"name\":";
+        auto threadName = ring->threadName.load (std::memory_order_relaxed);
+        if (threadName != nullptr)
+        {
+            writeString (out, threadName);
+        } else
+        {
+            out << "\"Thread " << ring->threadId << "\"";
+        }
+        out << "}}";
+
+        for (size_t i = valid > begin ? static_cast<size_t>(valid - begin) : 0; i < events.size(); ++i)
+        {
+            auto& event = events[i];
+            separate();
+            out << "{\"name\":";
+            writeString (out, event.name);
+            out << ",\"cat\":\"chordid\",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << ring->threadId
+                << ",\"ts\":" << event.start / 1000 << '.' << event.start % 1000 / 100;
+            if (event.phase == slicePhase)
+            {
+                out << ",\"dur\":" << event.duration / 1000 << '.' << event.duration % 1000 / 100;
+            } else
+            {
+                out << ",\"id\":" << event.id;
+                // bind the end of a flow to the slice enclosing it, not the next one
+                if (event.phase == flowEndPhase)
+                {
+                    out << ",\"bp\":\"e\"";
+                }
+            }
+            out << "}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(out);
+}
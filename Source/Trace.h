@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+//==============================================================================
+// Scoped trace points for finding where the time between a note and the pixels it changes
+// goes, written out in the Chrome trace event format that Perfetto and chrome://tracing open.
+//
+// Each thread writes its events into its own ring buffer (allocated the first time it records
+// one, and kept until exit), so recording takes no lock: the slot is filled and the head
+// published with a release store. write() copies every ring while they are written to, and
+// drops the events that were overwritten during the copy. The newest ringSize events of each
+// thread are kept. While disabled a trace point costs one relaxed atomic load.
+//
+// Names must be string literals (or otherwise outlive the trace), only the pointer is stored.
+namespace Trace
+{
+    const int ringSize = 1 << 14;
+
+    void setEnabled (bool shouldBeEnabled);
+
+    inline bool isEnabled();
+
+    // nanoseconds on a monotonic clock
+    int64_t now();
+
+    // names the calling thread in the trace, e.g. "MIDI input"
+    void setThreadName (const char* name);
+
+    // a slice from start to end (both from now()) on the calling thread
+    void addSlice (const char* name, int64_t start, int64_t end);
+
+    // an arrow from the slice enclosing the start to the slice enclosing the end, which can be
+    // on another thread, e.g. from the MIDI callback to the message thread handling the note
+    void addFlowStart (const char* name, uint64_t id);
+
+    void addFlowEnd (const char* name, uint64_t id);
+
+    // a new id for a flow
+    uint64_t getNextFlowId();
+
+    // every event recorded so far as a Chrome trace JSON document, returns false if the
+    // stream failed
+    bool write (std::ostream& out);
+
+    //==============================================================================
+    // records the time from construction to destruction as a slice, if enabled when constructed
+    class ScopedTrace
+    {
+    public:
+        explicit ScopedTrace (const char* n)
+          : name (n), start (isEnabled() ? now() : -1)
+        {}
+
+        ~ScopedTrace()
+        {
+            if (start >= 0)
+            {
+                addSlice (name, start, now());
+            }
+        }
+
+        ScopedTrace (const ScopedTrace&) = delete;
+        ScopedTrace& operator= (const ScopedTrace&) = delete;
+
+    private:
+        const char* name;
+        int64_t start;
+    };
+
+    //==============================================================================
+    extern std::atomic<bool> enabled;
+
+    inline bool isEnabled()
+    {
+        return enabled.load (std::memory_order_relaxed);
+    }
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+// traces the rest of the enclosing scope, e.g. TRACE_SCOPE ("identify")
+#define TRACE_SCOPE(name) Trace::ScopedTrace TRACE_CONCAT(traceScope, __LINE__) (name)
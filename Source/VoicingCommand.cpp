@@ -0,0 +1,129 @@
+#include "VoicingCommand.h"
+#include "VoicingGenerator.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    // a midi note number, or a name like "Eb3", "F#4" or "B♭2" (middle C is C4), -1 if it isn't one
+    int parseNote (const juce::String& text)
+    {
+        if (text.containsOnly ("0123456789"))
+        {
+            return text.isEmpty() ? -1 : text.getIntValue();
+        }
+        static const int letters[7] = {9, 11, 0, 2, 4, 5, 7};
+        auto letter = juce::CharacterFunctions::toUpperCase (text[0]);
+        if (letter < 'A' || letter > 'G')
+        {
+            return -1;
+        }
+        int note = letters[letter - 'A'];
+        int i = 1;
+        for (; i < text.length(); ++i)
+        {
+            if (text[i] == 'b' || text[i] == 0x266d)
+            {
+                --note;
+            } else if (text[i] == '#' || text[i] == 0x266f)
+            {
+                ++note;
+            } else
+            {
+                break;
+            }
+        }
+        auto octave = text.substring (i);
+        if (! octave.trimCharactersAtStart ("-").containsOnly ("0123456789") || octave.isEmpty())
+        {
+            return -1;
+        }
+        return note + (octave.getIntValue() + 1) * 12;
+    }
+}
+
+int VoicingCommand::runFromCommandLine (const juce::String& commandLine)
+{
+    auto arguments = juce::StringArray::fromTokens (commandLine, true);
+    juce::String text, from;
+    size_t maxVoicings = 10;
+    int numThreads = juce::SystemStats::getNumCpus();
+    bool verify = false;
+
+    for (int i = 0; i < arguments.size(); ++i)
+    {
+        auto argument = arguments[i].unquoted();
+        if (argument == "--voicings" && i + 1 < arguments.size())
+        {
+            text = arguments[++i].unquoted();
+        } else if (argument == "--from" && i + 1 < arguments.size())
+        {
+            from = arguments[++i].unquoted();
+        } else if (argument == "--max" && i + 1 < arguments.size())
+        {
+            maxVoicings = static_cast<size_t>(juce::jmax (0, arguments[++i].getIntValue()));
+        } else if (argument == "--threads" && i + 1 < arguments.size())
+        {
+            numThreads = arguments[++i].getIntValue();
+        } else if (argument == "--verify")
+        {
+            verify = true;
+        }
+    }
+
+    ChordResult result;
+    int key = 0;
+    if (text.isEmpty() || ! VoicingGenerator::parse (text.toStdString(), result, key))
+    {
+        std::cerr << "Usage: --voicings \"<numeral> in <key>\" [--from \"<4 notes>\"] [--max <n>] [--threads <n>] [--verify]" << std::endl;
+        return 1;
+    }
+
+    VoicingGenerator::Voicing previous;
+    if (from.isNotEmpty())
+    {
+        auto notes = juce::StringArray::fromTokens (from, " ,", "");
+        notes.removeEmptyStrings();
+        if (notes.size() != 4)
+        {
+            std::cerr << "--from needs the 4 notes of the previous chord, bass first" << std::endl;
+            return 1;
+        }
+        for (int i = 0; i < 4; ++i)
+        {
+            previous.notes[static_cast<size_t>(i)] = parseNote (notes[i]);
+            if (previous.notes[static_cast<size_t>(i)] < 0)
+            {
+                std::cerr << "Couldn't read the note " << notes[i].toStdString() << std::endl;
+                return 1;
+            }
+        }
+        std::sort (previous.notes.begin(), previous.notes.end());
+    }
+
+    const double start = juce::Time::getMillisecondCounterHiRes();
+    auto generated = VoicingGenerator::generate (result, key, from.isNotEmpty() ? &previous : nullptr, maxVoicings, numThreads, verify);
+    const double milliseconds = juce::Time::getMillisecondCounterHiRes() - start;
+
+    // spelled with the accidentals of the key signature
+    const bool sharps = ChordAnalysis::getFifths (key) >= 0;
+    for (size_t i = 0; i < generated.voicings.size(); ++i)
+    {
+        auto& voicing = generated.voicings[i];
+        juce::StringArray names;
+        for (auto note : voicing.notes)
+        {
+            names.add (juce::MidiMessage::getMidiNoteName (note, sharps, true, 4));
+        }
+        std::cout << (i + 1) << ". " << names.joinIntoString (" ").toStdString() << "  (" << voicing.cost << ")" << std::endl;
+    }
+
+    auto label = ChordAnalysis::getNumeralText (result, key) + juce::String (result.figures).removeCharacters ("\n").toStdString();
+    std::cout << generated.voicings.size() << " of " << generated.numCandidates << " voicings of " << label << " in "
+              << ChordAnalysis::getKeyName (key) << " in " << juce::String (milliseconds, 2).toStdString() << " ms" << std::endl;
+    if (verify)
+    {
+        std::cout << generated.numMismatches << " identified as another chord" << std::endl;
+    }
+    return generated.numMismatches > 0 || generated.voicings.empty() ? 1 : 0;
+}
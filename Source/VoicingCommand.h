@@ -0,0 +1,16 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Batch mode: prints the SATB voicings of a roman numeral from VoicingGenerator, best first,
+    without opening a window, e.g. for exercises and answer keys.
+*/
+namespace VoicingCommand
+{
+    // handles "--voicings <numeral in key> [--from <notes>] [--max <n>] [--threads <n>] [--verify]",
+    // e.g. --voicings "V65 in Eb major" --from "Eb3 G3 Bb3 Eb4", where the notes of the previous
+    // chord are names or midi note numbers, and returns the exit code
+    int runFromCommandLine (const juce::String& commandLine);
+}
@@ -0,0 +1,354 @@
+#include "VoicingGenerator.h"
+#include "ProgressionIndex.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <tuple>
+
+namespace
+{
+    // lowest and highest note of the bass, tenor, alto and soprano
+    const int ranges[4][2] = {{40, 60}, {48, 67}, {55, 74}, {60, 79}};
+
+    // widest gap between the bass and tenor, and between adjacent upper voices
+    const int maxBassSpacing = 19;
+    const int maxUpperSpacing = 12;
+
+    //-----Penalties-----
+    const int parallelPenalty = 20;
+    const int overlapPenalty = 4;
+    const int leapPenalty = 5;
+    const int leadingToneDoublingPenalty = 8;
+    const int thirdDoublingPenalty = 3;
+    const int fifthDoublingPenalty = 1;
+
+    // pitch classes and bass of a chord, inverting identify()
+    struct Spelling
+    {
+        uint16_t pitchClasses = 0;
+        int bass = -1;
+        // the result it is identified as
+        uint16_t packed = 0;
+    };
+
+    // the inversion is part of the index as a diminished seventh is one symbol in any inversion
+    using SpellingTable = std::array<std::array<std::array<Spelling, 4>, ChordAnalysis::numSymbols>, ChordAnalysis::numKeys>;
+
+    // every chord type over every bass, indexed by key, the symbol id it is identified as and
+    // its inversion
+    const SpellingTable& getSpellingTable()
+    {
+        static const SpellingTable table = []
+        {
+            SpellingTable t {};
+            for (int mask = 0; mask < 4096; ++mask)
+            {
+                if (ChordAnalysis::getChordType (static_cast<uint16_t>(mask)) < 0)
+                {
+                    continue;
+                }
+                for (int k = 1; k <= ChordAnalysis::numKeys; ++k)
+                {
+                    for (int bass = 0; bass < 12; ++bass)
+                    {
+                        // a cadential 6-4 is identified as V64 too, which is spelled over the fifth of V
+                        auto result = ChordAnalysis::identify (static_cast<uint16_t>(mask), bass, k);
+                        bool cadential = result.chord == Chord::MajTriadSecond && (bass - ChordAnalysis::getTonic (k) + 12) % 12 == 7;
+                        if (! result.valid || cadential)
+                        {
+                            continue;
+                        }
+                        auto& spelling = t[static_cast<size_t>(k - 1)][static_cast<size_t>(result.getSymbolId())]
+                                          [static_cast<size_t>(ChordAnalysis::getInversion (result))];
+                        if (spelling.bass >= 0)
+                        {
+                            continue;
+                        }
+                        auto intervals = static_cast<uint16_t>(mask | 1);
+                        spelling.pitchClasses = static_cast<uint16_t>(((intervals << bass) | (intervals >> (12 - bass))) & 0xfff);
+                        spelling.bass = bass;
+                        spelling.packed = ChordAnalysis::pack (result);
+                    }
+                }
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    const Spelling& getSpelling (const ChordResult& result, int key)
+    {
+        return getSpellingTable()[static_cast<size_t>(key - 1)][static_cast<size_t>(result.getSymbolId())]
+                                 [static_cast<size_t>(ChordAnalysis::getInversion (result))];
+    }
+
+    int countPitchClasses (uint16_t pitchClasses)
+    {
+        int count = 0;
+        for (; pitchClasses != 0; pitchClasses &= static_cast<uint16_t>(pitchClasses - 1))
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    bool isBetter (const VoicingGenerator::Voicing& a, const VoicingGenerator::Voicing& b)
+    {
+        return std::tie (a.cost, a.notes) < std::tie (b.cost, b.notes);
+    }
+
+    // keeps the best maxVoicings of voicings, 0 keeps them all
+    void keepBest (std::vector<VoicingGenerator::Voicing>& voicings, size_t maxVoicings)
+    {
+        if (maxVoicings > 0 && voicings.size() > maxVoicings)
+        {
+            std::nth_element (voicings.begin(), voicings.begin() + static_cast<std::ptrdiff_t>(maxVoicings), voicings.end(), isBetter);
+            voicings.resize (maxVoicings);
+        }
+    }
+
+    // the voicings one thread enumerates and scores, keeping its best maxVoicings
+    struct Search
+    {
+        ChordResult result;
+        int key;
+        const VoicingGenerator::Voicing* previous;
+        uint16_t pitchClasses;
+        size_t maxVoicings;
+        bool verify;
+
+        std::vector<VoicingGenerator::Voicing> best;
+        size_t numCandidates = 0;
+        size_t numMismatches = 0;
+
+        void run (VoicingGenerator::Voicing& voicing, int voice, uint16_t covered)
+        {
+            if (voice == 4)
+            {
+                if (covered != pitchClasses)
+                {
+                    return;
+                }
+                add (voicing);
+                return;
+            }
+            // prune once the voices left can't complete the chord
+            if (countPitchClasses (static_cast<uint16_t>(pitchClasses & ~covered)) > 4 - voice)
+            {
+                return;
+            }
+            int below = voicing.notes[static_cast<size_t>(voice - 1)];
+            int low = std::max (ranges[voice][0], below);
+            int high = std::min (ranges[voice][1], below + (voice == 1 ? maxBassSpacing : maxUpperSpacing));
+            for (int note = low; note <= high; ++note)
+            {
+                if (((pitchClasses >> (note % 12)) & 1) == 0)
+                {
+                    continue;
+                }
+                voicing.notes[static_cast<size_t>(voice)] = note;
+                run (voicing, voice + 1, static_cast<uint16_t>(covered | 1 << (note % 12)));
+            }
+        }
+
+        void add (VoicingGenerator::Voicing voicing)
+        {
+            ++numCandidates;
+            if (verify)
+            {
+                auto identified = ChordAnalysis::identify (std::vector<int> (voicing.notes.begin(), voicing.notes.end()), key);
+                if (identified.getSymbolId() != result.getSymbolId() || std::strcmp (identified.figures, result.figures) != 0)
+                {
+                    ++numMismatches;
+                }
+            }
+            voicing.cost = VoicingGenerator::score (voicing, previous, result, key);
+            best.push_back (voicing);
+            // trimming to k every k voicings keeps this linear
+            if (maxVoicings > 0 && best.size() >= 2 * maxVoicings)
+            {
+                keepBest (best, maxVoicings);
+            }
+        }
+    };
+}
+
+//==============================================================================
+bool VoicingGenerator::parse (const std::string& text, ChordResult& result, int& key)
+{
+    auto split = text.find (" in ");
+    if (split == std::string::npos)
+    {
+        return false;
+    }
+    key = ChordAnalysis::getKeyFromName (text.substr (split + 4));
+    return key != 0 && parseNumeral (text.substr (0, split), key, result);
+}
+
+bool VoicingGenerator::parseNumeral (const std::string& numeral, int key, ChordResult& result)
+{
+    std::vector<ProgressionIndex::QueryToken> query;
+    if (key < 1 || key > ChordAnalysis::numKeys || ! ProgressionIndex::parseQuery (numeral, ChordAnalysis::isMajor (key), query)
+        || query.size() != 1)
+    {
+        return false;
+    }
+    auto& token = query.front();
+    // no figures is a root position triad, no quality prefers the chord diatonic to the key
+    const char* figures = token.figures != nullptr ? token.figures : "";
+    auto& spellings = getSpellingTable()[static_cast<size_t>(key - 1)];
+    bool found = false;
+    for (int type = 0; type < ChordAnalysis::numChordTypes; ++type)
+    {
+        for (auto& spelling : spellings[static_cast<size_t>(token.numeral / 2 * ChordAnalysis::numChordTypes + type)])
+        {
+            auto candidate = ChordAnalysis::unpack (spelling.packed);
+            if (! candidate.valid || candidate.getNumeralId() != token.numeral || std::strcmp (candidate.figures, figures) != 0
+                || (token.quality != nullptr && std::strcmp (candidate.quality, token.quality) != 0))
+            {
+                continue;
+            }
+            if (! found || (ChordAnalysis::isDiatonic (candidate, key) && ! ChordAnalysis::isDiatonic (result, key)))
+            {
+                result = candidate;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+VoicingGenerator::Result VoicingGenerator::generate (const ChordResult& result, int key, const Voicing* previous, size_t maxVoicings, int numThreads, bool verify)
+{
+    Result generated;
+    if (! result.valid || key < 1 || key > ChordAnalysis::numKeys)
+    {
+        return generated;
+    }
+    auto& spelling = getSpelling (result, key);
+    if (spelling.bass < 0)
+    {
+        return generated;
+    }
+
+    // every bass and tenor in range, shared out between the threads
+    std::vector<Voicing> starts;
+    for (int bass = ranges[0][0]; bass <= ranges[0][1]; ++bass)
+    {
+        if (bass % 12 != spelling.bass)
+        {
+            continue;
+        }
+        for (int tenor = std::max (ranges[1][0], bass); tenor <= std::min (ranges[1][1], bass + maxBassSpacing); ++tenor)
+        {
+            if ((spelling.pitchClasses >> (tenor % 12)) & 1)
+            {
+                Voicing start;
+                start.notes = {{ bass, tenor, 0, 0 }};
+                starts.push_back (start);
+            }
+        }
+    }
+    numThreads = std::max (1, std::min (numThreads, static_cast<int>(starts.size())));
+
+    std::vector<Search> searches (static_cast<size_t>(numThreads),
+                                  Search { result, key, previous, spelling.pitchClasses, maxVoicings, verify, {}, 0, 0 });
+    std::atomic<size_t> nextStart { 0 };
+    auto work = [&starts, &nextStart] (Search& search)
+    {
+        for (auto i = nextStart++; i < starts.size(); i = nextStart++)
+        {
+            auto voicing = starts[i];
+            search.run (voicing, 2, static_cast<uint16_t>(1 << (voicing.notes[0] % 12) | 1 << (voicing.notes[1] % 12)));
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < searches.size(); ++i)
+    {
+        threads.emplace_back (work, std::ref (searches[i]));
+    }
+    work (searches[0]);
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (auto& search : searches)
+    {
+        generated.voicings.insert (generated.voicings.end(), search.best.begin(), search.best.end());
+        generated.numCandidates += search.numCandidates;
+        generated.numMismatches += search.numMismatches;
+    }
+    keepBest (generated.voicings, maxVoicings);
+    std::sort (generated.voicings.begin(), generated.voicings.end(), isBetter);
+    return generated;
+}
+
+int VoicingGenerator::score (const Voicing& voicing, const Voicing* previous, const ChordResult& result, int key)
+{
+    int cost = 0;
+    auto& notes = voicing.notes;
+
+    // doubling, only triads have a doubled note
+    const int leadingTone = (ChordAnalysis::getTonic (key) + 11) % 12;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = i + 1; j < 4; ++j)
+        {
+            if (notes[i] % 12 != notes[j] % 12)
+            {
+                continue;
+            }
+            auto function = ChordAnalysis::getToneFunction (result, key, notes[i] % 12);
+            if (notes[i] % 12 == leadingTone)
+            {
+                cost += leadingToneDoublingPenalty;
+            } else if (function == ChordAnalysis::ToneFunction::third)
+            {
+                cost += thirdDoublingPenalty;
+            } else if (function == ChordAnalysis::ToneFunction::fifth)
+            {
+                cost += fifthDoublingPenalty;
+            }
+        }
+    }
+
+    if (previous == nullptr)
+    {
+        // without a chord to lead from, prefer the middle of each range
+        for (size_t i = 0; i < 4; ++i)
+        {
+            cost += std::abs (notes[i] - (ranges[i][0] + ranges[i][1]) / 2) / 2;
+        }
+        return cost;
+    }
+
+    auto& from = previous->notes;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        int motion = std::abs (notes[i] - from[i]);
+        cost += motion;
+        // the bass can leap an octave, the upper voices a fifth
+        if (motion > (i == 0 ? 12 : 7))
+        {
+            cost += leapPenalty;
+        }
+        // moving past where the neighbouring voice just was
+        if ((i > 0 && notes[i] < from[i - 1]) || (i < 3 && notes[i] > from[i + 1]))
+        {
+            cost += overlapPenalty;
+        }
+        for (size_t j = i + 1; j < 4; ++j)
+        {
+            int before = (from[j] - from[i]) % 12;
+            int after = (notes[j] - notes[i]) % 12;
+            if (before == after && (after == 0 || after == 7) && notes[i] != from[i] && notes[j] != from[j])
+            {
+                cost += parallelPenalty;
+            }
+        }
+    }
+    return cost;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "ChordAnalysis.h"
+
+//==============================================================================
+// The reverse of identification: every SATB voicing of a roman numeral, ranked by how smoothly
+// it follows the previous chord, for exercises and answer keys.
+//
+// The numeral is turned into pitch classes and a bass with a table of every chord in every key
+// built from identify(), so that a label means exactly what it would be identified as. Voicings
+// are enumerated by backtracking from the bass up, within the vocal ranges, without voice
+// crossing, with at most an octave between adjacent upper voices, and pruned as soon as the
+// voices left can't complete the chord. The pairs of bass and tenor notes are shared out
+// between threads, each scoring its voicings and keeping its own best k, which are merged at
+// the end.
+namespace VoicingGenerator
+{
+    // midi note numbers of the bass, tenor, alto and soprano, in that order
+    struct Voicing
+    {
+        std::array<int, 4> notes {};
+        // lower is smoother, see score()
+        int cost = 0;
+    };
+
+    // a numeral with optional figures and quality, e.g. "V65", "viio7", "ii⁶⁵" or "♭VI",
+    // followed by " in " and a key name, e.g. "V⁶⁵ in E♭ major"
+    // returns false if either part couldn't be parsed or the chord can't be spelled in the key
+    bool parse (const std::string& text, ChordResult& result, int& key);
+
+    // just the numeral, in a known key (no figures means root position)
+    bool parseNumeral (const std::string& numeral, int key, ChordResult& result);
+
+    struct Result
+    {
+        // lowest cost first
+        std::vector<Voicing> voicings;
+
+        // every voicing found, before keeping the best
+        size_t numCandidates = 0;
+
+        // voicings that identify() reads as another chord, only checked if verifying
+        size_t numMismatches = 0;
+    };
+
+    // the maxVoicings voicings of result with the lowest cost (all of them if it is 0), leading
+    // from previous if it isn't nullptr
+    // verify identifies every voicing found and counts the ones that don't come back as result
+    Result generate (const ChordResult& result, int key, const Voicing* previous, size_t maxVoicings, int numThreads, bool verify);
+
+    // semitones every voice moves from previous, plus penalties for parallel fifths and octaves,
+    // overlapping voices, large leaps and poor doubling (only the doubling without a previous chord)
+    int score (const Voicing& voicing, const Voicing* previous, const ChordResult& result, int key);
+}
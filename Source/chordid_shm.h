@@ -0,0 +1,138 @@
+/*
+    Layout of the shared memory segment the app publishes the live chords to (--shm).
+
+    This is a C header so that other programs can read the segment without any other part of
+    the app: open it with shm_open (CHORDID_SHM_NAME, O_RDONLY, 0), mmap it PROT_READ, check
+    the header, and read the slots with chordid_shm_read().
+
+    The segment is a header followed by one slot per source (the keyboard, or each keyboard in
+    classroom mode), each on its own cache lines. Every slot is a seqlock: the writer makes the
+    sequence odd, writes the slot and makes it even again, and readers copy the slot and retry
+    if the sequence changed meanwhile. The writer never waits for readers.
+
+    When the app quits, magic is set to 0 and the segment is unlinked, so a reader seeing
+    magic change should unmap it and open it again. If the app crashed, magic stays set, but
+    writer_pid is no longer running (kill (writer_pid, 0) fails), and the next instance of the
+    app replaces the segment.
+*/
+
+#ifndef CHORDID_SHM_H
+#define CHORDID_SHM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHORDID_SHM_NAME "/chord-identifier"
+
+/* "CHORDSHM" */
+#define CHORDID_SHM_MAGIC 0x4d485344524f4843ULL
+
+/* incremented whenever the layout changes */
+#define CHORDID_SHM_LAYOUT_VERSION 1
+
+#define CHORDID_SHM_MAX_SLOTS 64
+
+/* header and slots start on a cache line (C11 or C++11) */
+#ifdef __cplusplus
+ #define CHORDID_SHM_ALIGNED alignas (64)
+#else
+ #define CHORDID_SHM_ALIGNED _Alignas (64)
+#endif
+
+typedef struct chordid_shm_header
+{
+    /* CHORDID_SHM_MAGIC once the segment is ready, 0 after the writer has closed it */
+    CHORDID_SHM_ALIGNED uint64_t magic;
+    uint32_t layout_version;
+    uint32_t header_size;
+    uint32_t slot_size;
+    uint32_t num_slots;
+    /* process id of the app writing the segment */
+    uint32_t writer_pid;
+    uint8_t reserved[36];
+} chordid_shm_header;
+
+typedef struct chordid_shm_slot
+{
+    /* odd while the slot is being written, the number of results published is sequence / 2 */
+    CHORDID_SHM_ALIGNED uint64_t sequence;
+    /* seconds, on the clock of the note events */
+    double time;
+    /* bit (n % 64) of notes[n / 64] is set if midi note n is sounding */
+    uint64_t notes[2];
+
+    /* 0 if the notes weren't identified as a chord, and then the fields up to numeral are unset */
+    int8_t valid;
+    /* key 1-30: odd keys are major, 1-16 have sharps and 17-30 flats, 0 until a key is chosen */
+    int8_t key;
+    /* distance of the root from the tonic in semitones (0-11) */
+    int8_t chromatic_degree;
+    /* 1 if the numeral is upper case (the chord has a major third) */
+    int8_t capital;
+    /* chord type, as the Chord enum in ChordAnalysis.h */
+    int8_t chord;
+    /* 0 for root position, 1-3 for first to third inversion */
+    int8_t inversion;
+    /* degree * 21 + chord, unique to numeral, quality and inversion, -1 if not valid */
+    int16_t symbol_id;
+    /* degree * 2 + capital, -1 if not valid */
+    int16_t numeral_id;
+    /* index of the cadence or progression just completed, -1 if none */
+    int16_t progression;
+    /* the result as packed by ChordAnalysis::pack() */
+    uint16_t packed;
+
+    /* UTF-8, NUL terminated: accidental, numeral and quality, e.g. "viiø" */
+    char numeral[16];
+    /* figured bass on one line, e.g. "65" */
+    char figures[8];
+
+    /* name of the source, set when the segment is created and never changed */
+    char name[48];
+    uint8_t reserved[10];
+} chordid_shm_slot;
+
+#if defined (__GNUC__)
+
+static inline const chordid_shm_slot* chordid_shm_get_slots (const chordid_shm_header* header)
+{
+    return (const chordid_shm_slot*) ((const char*) header + header->header_size);
+}
+
+/* copies a consistent snapshot of slot to copy, and returns its version (sequence / 2) */
+static inline uint64_t chordid_shm_read (const chordid_shm_slot* slot, chordid_shm_slot* copy)
+{
+    for (;;)
+    {
+        uint64_t before = __atomic_load_n (&slot->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1)
+        {
+            continue;
+        }
+        memcpy (copy, (const void*) slot, sizeof (*copy));
+        __atomic_thread_fence (__ATOMIC_ACQUIRE);
+        if (__atomic_load_n (&slot->sequence, __ATOMIC_RELAXED) == before)
+        {
+            copy->sequence = before;
+            return before / 2;
+        }
+    }
+}
+
+/* version of the latest result in the slot, to poll for changes without copying it */
+static inline uint64_t chordid_shm_get_version (const chordid_shm_slot* slot)
+{
+    return __atomic_load_n (&slot->sequence, __ATOMIC_ACQUIRE) / 2;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif